@@ -2,16 +2,29 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include "logger.h"
 #include "lzss.h"
 
 typedef struct {
   LogWriter writer;
+  LogWriterReserve reserve; // NULL unless the entries are formatted into the memory of the writer
+  LogWriterCommit commit;
   LogSeverity severity;
+  const LogIdMask *ids; // ids that are written whatever their severity, NULL for none
   bool is_encoded;
+  uint32_t last_timestamp; // claimed with an atomic exchange by every timestamped entry
+  uint32_t anchor;         // the next timestamped entry has the absolute time
+  uint32_t timed_entries;  // timestamped entries, for the anchor interval
 } LogWriterInfo;
 
+typedef struct {
+  uint32_t now;   // written by text writers and by encoded writers for an anchor
+  uint32_t delta; // ticks since the previous entry of the writer, written by encoded writers
+  bool absolute;  // the entry is an anchor
+} LogTimestamp;
+
 typedef struct {
   LogEntry *entries;
   size_t count;
@@ -32,6 +45,63 @@ typedef struct {
  * entries are supported by the logger.
  *
  * to add a new log entry add it to 'logger.def' file.
+ *
+ * when a clock is set with logger_set_clock, every entry is timestamped.
+ * text writers get the absolute tick count after the id ([0x8012][@1234]) and
+ * encoded writers get the ticks since their previous entry as hexadecimal
+ * digits in the header (\n8012:1F4|...|\n). the decoder adds up the deltas
+ * to reconstruct the absolute tick counts. the deltas are claimed with an
+ * atomic exchange, so every tick is in the delta of one entry when threads
+ * log at the same time, and are signed, as a thread may claim its delta after
+ * a thread that read the clock later. a log that does not start with the
+ * first entry of the writer, like a flight recorder that wraps, a rotated
+ * file or a query of an index, only has relative times until its first
+ * anchor: an entry with the absolute tick count of the clock
+ * (\n8012@5DC|...|\n). anchors are written every given number of entries
+ * with logger_set_time_anchor_interval and to the next entry of every
+ * writer after logger_anchor_time.
+ *
+ * the logger counts the entries, bytes, truncations, formatting errors and
+ * entries filtered by severity of every writer and of the first
+ * LOGGER_STATS_MAX_IDS ids that are logged. the counters are updated with
+ * relaxed atomic operations and logger_get_stats takes a snapshot of them.
+ * when a cycle counter is set, the time spent formatting and writing is
+ * added to a histogram of every writer.
+ *
+ * when printf interning is enabled with logger_set_printf_interning, the
+ * format of logger_printf gets a dynamic id from LOGGER_DYNAMIC_ID_FIRST the
+ * first time it is seen, keyed by its pointer and checked with a hash of its
+ * content. encoded writers get a definition entry (\n1004|F000|format|\n)
+ * before the first entry of the id and then only the parameters like entries
+ * of logger_log, but with the precision of doubles so the values are the same
+ * as without interning. the decoder learns the definitions in the
+ * LoggerFormats of the log it decodes, which the caller or a LoggerDecoder
+ * owns, and does not write them. formats with unsupported specifiers, length modifiers or "%%" keep the
+ * LOGGER_PRINTF id. with logger_set_definition_interval the definitions are
+ * written again periodically, for logs that lose their beginning. the ids and
+ * the definitions that writers got are claimed with atomic operations, so
+ * threads can log formats at the same time.
+ *
+ * a decoder that runs on another machine than the firmware can set a
+ * LogFormatResolver (see logger_formatdb.h) that is asked for the format of
+ * an id before the registered entries, so it decodes the ids of the firmware
+ * that wrote the log instead of the ids it was built with. a LoggerDecoder
+ * can have its own resolver to decode logs of several firmwares at once.
+ *
+ * entries that are metrics logged every control cycle can be aggregated with
+ * logger_set_aggregation. the numeric parameters of the id, found from the
+ * specifiers of its format, are summarized over a window of entries and one
+ * LOGGER_AGGREGATE entry with the count, minimum, maximum and mean is written
+ * per parameter when the window is full, instead of every entry. every
+ * sample-th entry is still written as it is. the window of an aggregation is
+ * updated under a spinlock, so threads can log the id at the same time.
+ *
+ * ids and ranges of ids can be disabled at runtime with logger_enable_ids.
+ * the entries of a disabled id are dropped with one bit test before anything
+ * else is done with them. a writer can also be given a mask of ids with
+ * logger_set_writer_id_mask that are written even if their severity is
+ * below the threshold of the writer, to turn on the debug entries of a few
+ * ids without the rest.
  */
 
 /*
@@ -45,7 +115,7 @@ typedef struct {
  *
  */
 
-#define MAX_LOG_WRITERS ((int) 4)
+#define MAX_LOG_WRITERS ((int) LOGGER_MAX_WRITERS)
 #define MAX_LOG_ENTRIES ((int) 6)
 #define MAX_LOG_FORMATTING_SIZE ((int) 12) // %[flag][flag][flag][flag][digit][digit].[digit][digit][specifier]\0
 
@@ -71,6 +141,66 @@ static LogEntry all_log_entries[] = {
 
 static bool initialized = false;
 
+static LogClock log_clock = NULL;
+
+static LogCycleCounter log_cycle_counter = NULL;
+
+static LogStats log_stats;
+static uint32_t log_stats_keys[LOGGER_STATS_MAX_IDS]; // id + 1 or zero if the slot is free
+static LogIdMask log_stats_untracked_ids; // ids that were not found when the table was full
+static uint32_t log_stats_interval = 0;
+static uint32_t log_stats_countdown = 0;
+static uint32_t log_stats_logging = 0; // claimed with an atomic exchange
+
+static LogFormatResolver decoder_resolver = NULL;
+static void *decoder_resolver_context = NULL;
+
+// the slots are claimed in order with atomic operations, so threads that log
+// different formats at the same time get different ids
+typedef struct {
+  const char *format; // NULL while the slot is free
+  uint32_t hash;
+  uint32_t ready;     // the hash is set and the id can be used
+  uint32_t defined;   // bit i is set when writer i got the definition
+  uint32_t defined_at[MAX_LOG_WRITERS]; // entries of writer i when it got the definition
+} LogDynamicFormat;
+
+static LogDynamicFormat log_dynamic_formats[LOGGER_MAX_DYNAMIC_IDS]; // index = id - LOGGER_DYNAMIC_ID_FIRST
+static bool log_printf_interning = false;
+static uint32_t log_definition_interval = 0;
+static uint32_t log_time_anchor_interval = 0;
+
+typedef struct {
+  double min;
+  double max;
+  double sum;
+} LogAggregate;
+
+typedef struct {
+  uint32_t count;
+  LogSeverity severity;
+  LogAggregate values[LOGGER_AGGREGATION_MAX_PARAMETERS];
+} LogAggregationWindow;
+
+typedef struct {
+  uint32_t lock;       // held while the window is updated or taken
+  LogId id;
+  uint32_t window;     // entries summarized by one summary
+  uint32_t sample;     // every sample-th entry is written as it is, 0 for none
+  uint32_t count;      // entries in the current window
+  uint32_t total;      // entries since the aggregation was set
+  LogSeverity severity; // of the last entry, the summaries are written with it
+  size_t parameter_count;
+  char specifiers[LOGGER_AGGREGATION_MAX_PARAMETERS];
+  LogAggregate values[LOGGER_AGGREGATION_MAX_PARAMETERS];
+} LogAggregation;
+
+static LogIdMask log_disabled_ids; // all ids are enabled initially
+
+static LogAggregation log_aggregations[LOGGER_MAX_AGGREGATIONS];
+static unsigned int log_aggregations_count = 0;
+
+
 
 
 #define MINIMUM(_a_,_b_) (((_a_) <= (_b_)) ? (_a_) : (_b_))
@@ -98,6 +228,91 @@ static long memnmcpy(char *dst, const char *src, long n, long max) {
 
 
 
+#if defined(__GNUC__)
+#define STATS_ADD(_counter_, _n_) __atomic_fetch_add(&(_counter_), (_n_), __ATOMIC_RELAXED)
+#define STATS_SUB(_counter_, _n_) __atomic_sub_fetch(&(_counter_), (_n_), __ATOMIC_RELAXED)
+#define STATS_LOAD(_counter_) __atomic_load_n(&(_counter_), __ATOMIC_RELAXED)
+#define STATS_OR(_counter_, _n_) __atomic_fetch_or(&(_counter_), (_n_), __ATOMIC_RELAXED)
+#define STATS_AND(_counter_, _n_) __atomic_fetch_and(&(_counter_), (_n_), __ATOMIC_RELAXED)
+#define STATS_CLAIM(_slot_, _key_) ({ uint32_t _free_ = 0; __atomic_compare_exchange_n(&(_slot_), &_free_, (_key_), false, __ATOMIC_RELAXED, __ATOMIC_RELAXED); })
+#define FORMAT_CLAIM(_slot_, _format_) ({ const char *_free_ = NULL; __atomic_compare_exchange_n(&(_slot_), &_free_, (_format_), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE); })
+#define FORMAT_LOAD(_field_) __atomic_load_n(&(_field_), __ATOMIC_ACQUIRE)
+#define FORMAT_STORE(_field_, _value_) __atomic_store_n(&(_field_), (_value_), __ATOMIC_RELEASE)
+#define STATS_EXCHANGE(_field_, _value_) __atomic_exchange_n(&(_field_), (_value_), __ATOMIC_RELAXED)
+#define STATS_NEXT(_counter_) __atomic_add_fetch(&(_counter_), 1, __ATOMIC_RELAXED)
+#define LOCK_TAKE(_lock_) do { while(__atomic_exchange_n(&(_lock_), 1, __ATOMIC_ACQUIRE)) { } } while(0)
+#define LOCK_GIVE(_lock_) __atomic_store_n(&(_lock_), 0, __ATOMIC_RELEASE)
+#else
+static uint32_t logger_exchange(uint32_t *field, uint32_t value) {
+  uint32_t previous = *field;
+  *field = value;
+  return previous;
+}
+
+#define STATS_ADD(_counter_, _n_) ((_counter_) += (_n_))
+#define STATS_SUB(_counter_, _n_) ((_counter_) -= (_n_))
+#define STATS_LOAD(_counter_) (_counter_)
+#define STATS_OR(_counter_, _n_) ((_counter_) |= (_n_))
+#define STATS_AND(_counter_, _n_) ((_counter_) &= (_n_))
+#define STATS_CLAIM(_slot_, _key_) ((_slot_) == 0 ? ((_slot_) = (_key_), true) : false)
+#define FORMAT_CLAIM(_slot_, _format_) ((_slot_) == NULL ? ((_slot_) = (_format_), true) : false)
+#define FORMAT_LOAD(_field_) (_field_)
+#define FORMAT_STORE(_field_, _value_) ((_field_) = (_value_))
+#define STATS_EXCHANGE(_field_, _value_) logger_exchange(&(_field_), (_value_))
+#define STATS_NEXT(_counter_) (++ (_counter_))
+#define LOCK_TAKE(_lock_) ((_lock_) = 1)
+#define LOCK_GIVE(_lock_) ((_lock_) = 0)
+#endif
+
+/*
+ * return the counters of the id or NULL if the ids table is full.
+ * the table uses open addressing and slots are claimed atomically.
+ * an id that is not in the full table is remembered in a bitmap, so its
+ * next entries do not scan the table again.
+ */
+static LogCounters* logger_stats_find_id(uint16_t id) {
+  const uint32_t key = (uint32_t) id + 1;
+  unsigned int i, slot = (id * 2654435761u) % LOGGER_STATS_MAX_IDS;
+
+  if(LOGGER_ID_MASK_TEST(&log_stats_untracked_ids, id)) {
+    return NULL;
+  }
+
+  for(i = 0; i < LOGGER_STATS_MAX_IDS; i ++) {
+    uint32_t k = STATS_LOAD(log_stats_keys[slot]);
+    if(k == key || (k == 0 && STATS_CLAIM(log_stats_keys[slot], key))) {
+      return &log_stats.ids[slot].counters;
+    }
+    if(STATS_LOAD(log_stats_keys[slot]) == key) { // claimed by someone else meanwhile
+      return &log_stats.ids[slot].counters;
+    }
+    slot = (slot + 1) % LOGGER_STATS_MAX_IDS;
+  }
+  STATS_OR(log_stats_untracked_ids.words[id >> 5], 1u << (id & 31));
+  return NULL;
+}
+
+static void logger_stats_add_histogram(uint32_t *histogram, uint32_t cycles) {
+  unsigned int bucket = 0;
+  while(cycles > 1 && bucket < LOGGER_STATS_HISTOGRAM_BUCKETS - 1) {
+    cycles >>= 1;
+    bucket ++;
+  }
+  STATS_ADD(histogram[bucket], 1);
+}
+
+static void logger_stats_copy_counters(LogCounters *dst, LogCounters *src) {
+  dst->entries = STATS_LOAD(src->entries);
+  dst->bytes = STATS_LOAD(src->bytes);
+  dst->truncations = STATS_LOAD(src->truncations);
+  dst->formatting_errors = STATS_LOAD(src->formatting_errors);
+  dst->filtered = STATS_LOAD(src->filtered);
+  dst->dropped = STATS_LOAD(src->dropped);
+  dst->aggregated = STATS_LOAD(src->aggregated);
+}
+
+
+
 bool logger_register_log_entries_helper(LogEntry *entries, size_t count) {
   if(log_entries_count < MAX_LOG_ENTRIES) {
     log_entries[log_entries_count].entries = entries;
@@ -199,11 +414,17 @@ static void logger_replace_special_characters(char *buffer, int length) {
   }
 }
 
-static int logger_snvprintf_id(char *buffer, int length, bool encode, uint16_t id) {
+static int logger_snvprintf_id(char *buffer, int length, bool encode, uint16_t id, const LogTimestamp *timestamp) {
   int len;
 
-  if(encode) {
+  if(encode && timestamp != NULL && timestamp->absolute) {
+    len = snprintf(buffer, length, "\n%04X@%lX|", id, (unsigned long) timestamp->now);
+  } else if(encode && timestamp != NULL) {
+    len = snprintf(buffer, length, "\n%04X:%lX|", id, (unsigned long) timestamp->delta);
+  } else if(encode) {
     len = snprintf(buffer, length, "\n%04X|", id);
+  } else if(timestamp != NULL) {
+    len = snprintf(buffer, length, "[0x%04X][@%lu]", id, (unsigned long) timestamp->now);
   } else {
     len = snprintf(buffer, length, "[0x%04X]", id);
   }
@@ -219,7 +440,13 @@ static int logger_sprintf_parameter_separator(char *buffer, int length) {
   return 1;
 }
 
-static int logger_snvprintf_parameters_encoded(char *buffer, int length, const char *format, va_list params) {
+/*
+ * the float parameters of registered entries are encoded as floats. with
+ * doubles they keep the precision that logger_printf writes them with, which
+ * is used for the formats that got a dynamic id and for the summaries of
+ * aggregated entries.
+ */
+static int logger_snvprintf_parameters_encoded(char *buffer, int length, const char *format, bool doubles, va_list params) {
   char *buf = buffer;
   char *fmt = (char *) format;
 
@@ -254,8 +481,8 @@ static int logger_snvprintf_parameters_encoded(char *buffer, int length, const c
         break;
       }
       case 'f': case 'F': {
-        float f = (float) va_arg(params, double);
-        len = snprintf(buffer, length, formatting, f);
+        double f = va_arg(params, double);
+        len = snprintf(buffer, length, formatting, doubles ? f : (float) f);
         break;
       }
       case 'p': {
@@ -327,11 +554,11 @@ static int logger_snvprintf_parameters_encoded_with_printf(char *buffer, int len
   return buffer - buf;
 }
 
-static int logger_snvprintf_entry(char *buffer, int length, uint16_t id, bool encode, bool is_printf, const char *format, va_list params) {
+static int logger_snvprintf_timed_entry(char *buffer, int length, uint16_t id, bool encode, bool is_printf, const LogTimestamp *timestamp, const char *format, va_list params) {
   char *buf = buffer;
   int len;
 
-  len = logger_snvprintf_id(buffer, length, encode, id);
+  len = logger_snvprintf_id(buffer, length, encode, id, timestamp);
 
   if(len < 0) {
     return len;
@@ -342,7 +569,9 @@ static int logger_snvprintf_entry(char *buffer, int length, uint16_t id, bool en
   if(encode && is_printf) {
     len = logger_snvprintf_parameters_encoded_with_printf(buffer, length, format, params);
   } else if(encode) {
-    len = logger_snvprintf_parameters_encoded(buffer, length, format, params);
+    const bool doubles = (id >= LOGGER_DYNAMIC_ID_FIRST && id < LOGGER_DYNAMIC_ID_FIRST + LOGGER_MAX_DYNAMIC_IDS)
+        || id == LOGGER_AGGREGATE; // the summaries of integers that do not fit in a float
+    len = logger_snvprintf_parameters_encoded(buffer, length, format, doubles, params);
   } else {
     len = logger_snvprintf_parameters(buffer, length, format, params);
   }
@@ -364,50 +593,353 @@ static int logger_snvprintf_entry(char *buffer, int length, uint16_t id, bool en
   return buffer - buf;
 }
 
+static int logger_snvprintf_entry(char *buffer, int length, uint16_t id, bool encode, bool is_printf, const char *format, va_list params) {
+  return logger_snvprintf_timed_entry(buffer, length, id, encode, is_printf, NULL, format, params);
+}
+
+static uint32_t logger_format_hash(const char *format) {
+  uint32_t h = 2166136261u; // FNV-1a
+  while(*format != 0) {
+    h = (h ^ (uint8_t) *format ++) * 16777619u;
+  }
+  return h;
+}
+
+/*
+ * return true if the parameters of the format can be encoded like the
+ * parameters of registered entries and its definition fits in an entry.
+ */
+static bool logger_is_internable_format(const char *format) {
+  char *fmt = (char *) format;
+  long slen;
+
+  if(strlen(format) > LOG_LINE_SIZE - 16 || strstr(format, "%%") != NULL) {
+    return false;
+  }
+  while((slen = logger_find_next_specifier(&fmt)) > 0) {
+    if(slen >= MAX_LOG_FORMATTING_SIZE || memchr(fmt, 'l', slen) != NULL) {
+      return false;
+    }
+    fmt += slen;
+  }
+  return slen == 0;
+}
+
+/*
+ * return the index of the dynamic id of the format or -1 if it has none.
+ * a new format claims the first free slot, which is only used after its
+ * hash is set. until then the format keeps the LOGGER_PRINTF id.
+ */
+static int logger_intern_format(const char *format) {
+  const uint32_t hash = logger_format_hash(format);
+  unsigned int i;
+
+  for(i = 0; i < LOGGER_MAX_DYNAMIC_IDS; i ++) {
+    LogDynamicFormat *slot = &log_dynamic_formats[i];
+    const char *slot_format = FORMAT_LOAD(slot->format);
+
+    if(slot_format == NULL) {
+      if(!logger_is_internable_format(format)) {
+        return -1;
+      }
+      if(FORMAT_CLAIM(slot->format, format)) {
+        slot->hash = hash;
+        FORMAT_STORE(slot->ready, 1);
+        return (int) i;
+      }
+      slot_format = FORMAT_LOAD(slot->format); // claimed by another thread meanwhile
+    }
+    if(slot_format == format) {
+      if(!FORMAT_LOAD(slot->ready)) {
+        return -1;
+      }
+      return slot->hash == hash ? (int) i : -1; // otherwise the buffer was reused
+    }
+  }
+  return -1;
+}
+
+/*
+ * return the memory where an entry of the writer is formatted: the memory of
+ * the writer if it has one or otherwise the buffer, NULL if the writer is full.
+ */
+static char* logger_writer_reserve(LogWriterInfo *writer, char *buffer) {
+  return writer->reserve != NULL ? (char *) writer->reserve(LOG_LINE_SIZE) : buffer;
+}
+
+static void logger_writer_commit(LogWriterInfo *writer, char *line, int len) {
+  if(writer->reserve != NULL) {
+    writer->commit(len);
+  } else {
+    writer->writer((uint8_t *) line, len);
+  }
+}
+
+/*
+ * write the definition entry of a dynamic id to the writer.
+ * return the length of the entry or 0 if the writer could not take it.
+ */
+static int logger_write_format_definition(LogWriterInfo *writer, uint16_t id, const char *format) {
+  char buffer[LOG_LINE_SIZE];
+  const int header_len = 11; // \n1004|F000|
+
+  char *line = logger_writer_reserve(writer, buffer);
+  if(line == NULL) {
+    return 0;
+  }
+  int len = snprintf(line, LOG_LINE_SIZE, "\n%04X|%04X|%s|\n", LOGGER_DEFINE_FORMAT, id, format);
+  logger_replace_special_characters(line + header_len, len - header_len - 2);
+  logger_writer_commit(writer, line, len);
+  return len;
+}
+
+static LogAggregation* logger_find_aggregation(uint16_t id) {
+  unsigned int i;
+  for(i = 0; i < log_aggregations_count; i ++) {
+    if(log_aggregations[i].id == id) {
+      return &log_aggregations[i];
+    }
+  }
+  return NULL;
+}
+
+static bool logger_is_numeric_specifier(char specifier) {
+  return strchr("diuxXfF", specifier) != NULL;
+}
+
+/*
+ * copy the window of the aggregation into window and start a new one.
+ * the lock of the aggregation must be held.
+ */
+static void logger_take_window(LogAggregation *aggregation, LogAggregationWindow *window) {
+  window->count = aggregation->count;
+  window->severity = aggregation->severity;
+  memcpy(window->values, aggregation->values, sizeof(window->values));
+  aggregation->count = 0;
+}
+
+/*
+ * write the summaries of a window that was taken from the aggregation.
+ */
+static void logger_write_window(const LogAggregation *aggregation, const LogAggregationWindow *window) {
+  size_t i;
+  if(window->count == 0) {
+    return;
+  }
+  for(i = 0; i < aggregation->parameter_count; i ++) {
+    const LogAggregate *value = &window->values[i];
+    if(logger_is_numeric_specifier(aggregation->specifiers[i])) {
+      logger_severity_log(window->severity, LOGGER_AGGREGATE, aggregation->id, (uint32_t) i, window->count,
+          value->min, value->max, value->sum / window->count);
+    }
+  }
+}
+
+/*
+ * write the summaries of the window and start a new one.
+ */
+static void logger_flush_aggregation(LogAggregation *aggregation) {
+  LogAggregationWindow window;
+  LOCK_TAKE(aggregation->lock);
+  logger_take_window(aggregation, &window);
+  LOCK_GIVE(aggregation->lock);
+  logger_write_window(aggregation, &window);
+}
+
+/*
+ * add the parameters of an entry to the window of its aggregation.
+ * the parameters are read with the same types as the encoded writers use.
+ * the window is updated under the lock of the aggregation, so the entries of
+ * several threads are all counted and a full window is taken by one of them,
+ * which writes its summaries after the lock is released.
+ * return true if the entry is a sample that is written as it is.
+ */
+static bool logger_aggregate(LogAggregation *aggregation, LogSeverity severity, va_list params) {
+  double values[LOGGER_AGGREGATION_MAX_PARAMETERS];
+  LogAggregationWindow window;
+  size_t i;
+  va_list params_copy;
+  va_copy(params_copy, params);
+
+  for(i = 0; i < aggregation->parameter_count; i ++) {
+    double v = 0;
+    switch(aggregation->specifiers[i]) {
+      case 'd': case 'i': v = va_arg(params_copy, int32_t); break;
+      case 'u': case 'x': case 'X': v = va_arg(params_copy, uint32_t); break;
+      case 'f': case 'F': v = va_arg(params_copy, double); break;
+      case 'c': va_arg(params_copy, int32_t); break;
+      case 'p': va_arg(params_copy, void *); break;
+      case 's': va_arg(params_copy, char *); break;
+    }
+    values[i] = v;
+  }
+  va_end(params_copy);
+
+  LOCK_TAKE(aggregation->lock);
+  for(i = 0; i < aggregation->parameter_count; i ++) {
+    LogAggregate *value = &aggregation->values[i];
+    const double v = values[i];
+    if(aggregation->count == 0) {
+      value->min = value->max = value->sum = v;
+    } else {
+      value->min = v < value->min ? v : value->min;
+      value->max = v > value->max ? v : value->max;
+      value->sum += v;
+    }
+  }
+  const bool is_sample = aggregation->sample > 0 && aggregation->total % aggregation->sample == 0;
+  aggregation->total ++;
+  aggregation->count ++;
+  aggregation->severity = severity;
+  window.count = 0;
+  if(aggregation->count >= aggregation->window) {
+    logger_take_window(aggregation, &window);
+  }
+  LOCK_GIVE(aggregation->lock);
+
+  logger_write_window(aggregation, &window);
+  return is_sample;
+}
+
 static void logger_log_helper(LogSeverity severity, bool is_printf, uint16_t id, const char *format, va_list params) {
+  if(LOGGER_ID_MASK_TEST(&log_disabled_ids, id)) { // before the clock is read or the buffer is cleared
+    return;
+  }
+
   size_t i;
   char buffer[LOG_LINE_SIZE] = {0};
   char *fmt;
   int len;
+  LogTimestamp timestamp, *ts = NULL;
+  const uint32_t now = log_clock != NULL ? log_clock() : 0;
+  uint32_t cycles = 0;
 
   if(is_printf) {
     fmt = (char *) format;
   } else { // has a registered id
     LogEntry *entry = logger_find_log_entry(id);
     if(entry == NULL) {
+      STATS_ADD(log_stats.unknown_ids, 1);
       return;
     }
     fmt = (char *) entry->format;
   }
 
+  LogCounters *id_counters = logger_stats_find_id(id);
+  if(id_counters == NULL) {
+    STATS_ADD(log_stats.untracked_entries, 1);
+  }
+
+  if(!is_printf && log_aggregations_count > 0) {
+    LogAggregation *aggregation = logger_find_aggregation(id);
+    if(aggregation != NULL) {
+      if(id_counters != NULL) STATS_ADD(id_counters->aggregated, 1);
+      if(!logger_aggregate(aggregation, severity, params)) {
+        return;
+      }
+    }
+  }
+
+  const int dynamic = is_printf && log_printf_interning ? logger_intern_format(format) : -1;
+
   for(i = 0; i < log_writers_count; i ++) {
     LogWriterInfo *writer = &log_writers[i];
+    LogWriterStats *writer_stats = &log_stats.writers[i];
 
-    if(severity >= writer->severity) {
+    if(severity < writer->severity && (writer->ids == NULL || !LOGGER_ID_MASK_TEST(writer->ids, id))) {
+      STATS_ADD(writer_stats->counters.filtered, 1);
+      if(id_counters != NULL) STATS_ADD(id_counters->filtered, 1);
+    } else {
       va_list params_copy;
       va_copy(params_copy, params);
 
-      len = logger_snvprintf_entry(buffer, LOG_LINE_SIZE, id, writer->is_encoded, is_printf, fmt, params_copy);
+      if(log_cycle_counter != NULL) {
+        cycles = log_cycle_counter();
+      }
+
+      uint16_t entry_id = id;
+      bool entry_is_printf = is_printf;
+      if(dynamic >= 0 && writer->is_encoded) {
+        entry_id = LOGGER_DYNAMIC_ID_FIRST + dynamic;
+        entry_is_printf = false;
+        LogDynamicFormat *dynamic_format = &log_dynamic_formats[dynamic];
+        const uint32_t entries = STATS_LOAD(writer_stats->counters.entries);
+        if(!(STATS_LOAD(dynamic_format->defined) & (1u << i))
+            || (log_definition_interval > 0 && entries - STATS_LOAD(dynamic_format->defined_at[i]) >= log_definition_interval)) {
+          // set after the definition is written, so the entries of other
+          // threads may write it again but never skip it
+          len = logger_write_format_definition(writer, entry_id, fmt);
+          if(len > 0) { // otherwise it is written again with the next entry
+            FORMAT_STORE(dynamic_format->defined_at[i], entries);
+            STATS_OR(dynamic_format->defined, 1u << i);
+          }
+          STATS_ADD(writer_stats->counters.bytes, (uint32_t) len);
+        }
+      }
+
+      char *line = logger_writer_reserve(writer, buffer);
+      if(line == NULL) {
+        STATS_ADD(writer_stats->counters.dropped, 1);
+        if(id_counters != NULL) STATS_ADD(id_counters->dropped, 1);
+        va_end(params_copy);
+        continue;
+      }
+
+      if(log_clock != NULL) { // the delta of a dropped entry is added to the next one
+        const uint32_t timed_entries = STATS_NEXT(writer->timed_entries) - 1;
+        timestamp.now = now;
+        timestamp.delta = now - STATS_EXCHANGE(writer->last_timestamp, now);
+        timestamp.absolute = STATS_EXCHANGE(writer->anchor, 0) != 0
+            || (log_time_anchor_interval > 0 && timed_entries % log_time_anchor_interval == 0);
+        ts = &timestamp;
+      }
+
+      len = logger_snvprintf_timed_entry(line, LOG_LINE_SIZE, entry_id, writer->is_encoded, entry_is_printf, ts, fmt, params_copy);
 
       if(len == ERROR_BUFFER_OVERFLOW) {
         const char *msg = ".. truncated ..|\n";
         const int n = strlen(msg);
-        memnmcpy(buffer + LOG_LINE_SIZE - n, msg, n, n);
+        memnmcpy(line + LOG_LINE_SIZE - n, msg, n, n);
         len = LOG_LINE_SIZE;
+        STATS_ADD(writer_stats->counters.truncations, 1);
+        if(id_counters != NULL) STATS_ADD(id_counters->truncations, 1);
       } else if(len == ERROR_FORMATTING) {
-        len = logger_snvprintf_id(buffer, LOG_LINE_SIZE, writer->is_encoded, id);
+        len = logger_snvprintf_id(line, LOG_LINE_SIZE, writer->is_encoded, entry_id, ts);
         const char *msg = "this log entry has formatting errors|\n";
-        const int n = strlen(msg) + 1; // include the null character
-        memnmcpy(buffer + len, msg, n, LOG_LINE_SIZE - len);
-        len = strlen(buffer);
+        len += memnmcpy(line + len, msg, strlen(msg), LOG_LINE_SIZE - len);
+        STATS_ADD(writer_stats->counters.formatting_errors, 1);
+        if(id_counters != NULL) STATS_ADD(id_counters->formatting_errors, 1);
+      }
+
+      if(log_cycle_counter != NULL) {
+        uint32_t formatted = log_cycle_counter();
+        logger_stats_add_histogram(writer_stats->format_cycles, formatted - cycles);
+        cycles = formatted;
       }
 
-      writer->writer((uint8_t *) buffer, len);
+      logger_writer_commit(writer, line, len);
+
+      if(log_cycle_counter != NULL) {
+        logger_stats_add_histogram(writer_stats->writer_cycles, log_cycle_counter() - cycles);
+      }
+
+      STATS_ADD(writer_stats->counters.entries, 1);
+      STATS_ADD(writer_stats->counters.bytes, (uint32_t) len);
+      if(id_counters != NULL) {
+        STATS_ADD(id_counters->entries, 1);
+        STATS_ADD(id_counters->bytes, (uint32_t) len);
+      }
 
       va_end(params_copy);
     }
   }
 
+  if(log_stats_interval > 0 && !STATS_LOAD(log_stats_logging)) {
+    if(STATS_SUB(log_stats_countdown, 1) == 0) {
+      STATS_ADD(log_stats_countdown, log_stats_interval); // keeps the entries that other threads counted meanwhile
+      logger_log_stats(SEVERITY_INFO);
+    }
+  }
 }
 
 
@@ -426,25 +958,86 @@ static size_t logger_decoder_get_length_of_next_parameter(const char *entry, siz
   return 0;
 }
 
+static int logger_decoder_hex_value(char c) {
+  if('0' <= c && c <= '9') return c - '0';
+  if('A' <= c && c <= 'F') return c - 'A' + 10;
+  if('a' <= c && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+/*
+ * a header is either \nXXXX| or \nXXXX:T| for timestamped entries where T is
+ * one to eight hexadecimal digits of ticks since the previous entry, or
+ * \nXXXX@T| for anchors where T is the absolute tick count.
+ * update delta to the ticks of a timestamped header or zero otherwise.
+ * return the length of the header or zero if it is not valid.
+ */
+static int logger_decoder_get_header_length(const char *entry, size_t entry_len, unsigned long *delta) {
+  const size_t L_MAX_DELTA_DIGITS = 8;
+  size_t i;
+  int v;
+
+  *delta = 0;
+  if(entry_len < 6 || entry[0] != '\n') {
+    return 0;
+  }
+  if(entry[5] == '|') {
+    return 6;
+  }
+  if(entry[5] != ':' && entry[5] != '@') {
+    return 0;
+  }
+  for(i = 6; i < entry_len && i <= 6 + L_MAX_DELTA_DIGITS; i ++) {
+    if(entry[i] == '|') {
+      return i > 6 ? i + 1 : 0;
+    }
+    if((v = logger_decoder_hex_value(entry[i])) < 0) {
+      return 0;
+    }
+    *delta = (*delta << 4) | v;
+  }
+  return 0;
+}
+
+/*
+ * add the ticks of a timestamped header to time, which is updated to the
+ * time of the entry. return false if the entry is not timestamped.
+ */
+static bool logger_decoder_add_time(const char *entry, size_t entry_len, unsigned long long *time) {
+  unsigned long ticks;
+  if(logger_decoder_get_header_length(entry, entry_len, &ticks) <= 6) {
+    return false;
+  }
+  logger_decode_advance_time(time, ticks, entry[5] == '@');
+  return true;
+}
+
 /*
  * assume there are no errors in the entry's beginning and end. there
  * still might be errors in the middle.
  * decode the entry and write to destination as long as it has space.
+ * write the time after the id if it is not NULL.
  * return ERROR_DECODING in case of error or the number of characters that
  * are written to the destination or would have been written if it was large enough.
  */
-static int logger_decoder_decode_entry_helper(char *dst, int d_len, uint16_t id, const char *format, const char *entry, int entry_len) {
+static int logger_decoder_decode_timed_entry_helper(char *dst, int d_len, uint16_t id, const unsigned long long *time, const char *format, const char *entry, int entry_len) {
   char *fmt = (char *) format;
   const long d_length = d_len; // number of characters that are copied if destination was large enough
   int specifier_len, formatting_len, parameter_len;
+  unsigned long delta;
+  int len;
 
-  int len = snprintf(dst, d_len, "[0x%04X]", id);
+  if(time != NULL) {
+    len = snprintf(dst, d_len, "[0x%04X][@%llu]", id, *time);
+  } else {
+    len = snprintf(dst, d_len, "[0x%04X]", id);
+  }
 
   dst += len;
   d_len -= len;
-  const int L_ENCODED_HEADER_LENGTH = 6;
-  entry += L_ENCODED_HEADER_LENGTH;
-  entry_len -= L_ENCODED_HEADER_LENGTH;
+  const int header_len = logger_decoder_get_header_length(entry, entry_len, &delta);
+  entry += header_len;
+  entry_len -= header_len;
 
   char *previous_fmt = fmt;
 
@@ -486,6 +1079,10 @@ static int logger_decoder_decode_entry_helper(char *dst, int d_len, uint16_t id,
   return d_length - d_len;
 }
 
+static int logger_decoder_decode_entry_helper(char *dst, int d_len, uint16_t id, const char *format, const char *entry, int entry_len) {
+  return logger_decoder_decode_timed_entry_helper(dst, d_len, id, NULL, format, entry, entry_len);
+}
+
 static uint16_t logger_decoder_get_id(const char *entry) {
   char id[5];
   memnmcpy(id, entry + 1, 4, 5); // skip the start '\n' and only use the four id characters
@@ -499,25 +1096,94 @@ static uint16_t logger_decoder_get_id(const char *entry) {
  * \n8026|20.89|\n
  * \n8029|48010||1258.05|\n
  * \n8037|string with numbers 1554.71|2.57|\n
+ * \n8012:3E8|42|\n
  */
 static long logger_decoder_is_entry_decodable(const char *entry, size_t entry_len) {
-  return entry_len >= 7 &&
-    entry[0] == '\n' && entry[5] == '|' && // a valid entry starts with \nXXXX|
+  unsigned long delta;
+  const size_t header_len = logger_decoder_get_header_length(entry, entry_len, &delta);
+  return header_len > 0 && entry_len >= header_len + 1 && // a valid entry starts with a header
     entry[entry_len - 2] == '|' && entry[entry_len - 1] == '\n'; // and must have '|\n' at the end
 }
 
-static long logger_decoder_decode_entry(char *dst, size_t d_len, const char *entry, size_t entry_len) {
+/*
+ * learn the format of a dynamic id from its definition entry, or only check
+ * the definition if formats is NULL.
+ * return false if the definition is not valid.
+ */
+static bool logger_decoder_learn_format(LoggerFormats *formats, const char *entry, size_t entry_len) {
+  unsigned long delta;
+  size_t i;
+  int v, id = 0;
+
+  const size_t header_len = logger_decoder_get_header_length(entry, entry_len, &delta);
+  const char *fields = entry + header_len;
+  const size_t fields_len = entry_len - header_len - 2; // without the end "|\n"
+  if(header_len == 0 || entry_len < header_len + 2 || fields_len < 5 || fields[4] != '|') {
+    return false;
+  }
+  for(i = 0; i < 4; i ++) {
+    if((v = logger_decoder_hex_value(fields[i])) < 0) {
+      return false;
+    }
+    id = (id << 4) | v;
+  }
+  const size_t n = fields_len - 5;
+  if(id < LOGGER_DYNAMIC_ID_FIRST || id >= LOGGER_DYNAMIC_ID_FIRST + LOGGER_MAX_DYNAMIC_IDS || n >= LOGGER_FORMAT_SIZE) {
+    return false;
+  }
+  if(formats != NULL) {
+    memcpy(formats->formats[id - LOGGER_DYNAMIC_ID_FIRST], fields + 5, n);
+    formats->formats[id - LOGGER_DYNAMIC_ID_FIRST][n] = 0;
+    formats->defined[id - LOGGER_DYNAMIC_ID_FIRST] = true;
+  }
+  return true;
+}
+
+/*
+ * return the format of the resolver, of a registered id or of a dynamic id
+ * learned in formats, which may be NULL, or NULL.
+ */
+static const char *logger_decoder_find_format(uint16_t id, LogFormatResolver resolver, void *context, const LoggerFormats *formats) {
+  const char *format = resolver != NULL ? resolver(context, id) : NULL;
+  if(format != NULL) {
+    return format;
+  }
+  LogEntry *le = logger_find_log_entry(id);
+  if(le != NULL) {
+    return le->format;
+  }
+  if(formats != NULL && id >= LOGGER_DYNAMIC_ID_FIRST && id < LOGGER_DYNAMIC_ID_FIRST + LOGGER_MAX_DYNAMIC_IDS
+      && formats->defined[id - LOGGER_DYNAMIC_ID_FIRST]) {
+    return formats->formats[id - LOGGER_DYNAMIC_ID_FIRST];
+  }
+  return NULL;
+}
+
+/*
+ * time is the time of the previous timestamped entry. it is updated if the
+ * entry is timestamped. a definition of a dynamic id is learned in formats
+ * and not written.
+ */
+static long logger_decoder_decode_entry(char *dst, size_t d_len, const char *entry, size_t entry_len, unsigned long long *time, LogFormatResolver resolver, void *context, LoggerFormats *formats) {
   if(logger_decoder_is_entry_decodable(entry, entry_len)) {
     uint16_t id = logger_decoder_get_id(entry);
+    const unsigned long long *entry_time = NULL;
+
+    if(logger_decoder_add_time(entry, entry_len, time)) {
+      entry_time = time;
+    }
+
+    if(id == LOGGER_DEFINE_FORMAT && logger_decoder_learn_format(formats, entry, entry_len)) {
+      return 0;
+    }
 
-    LogEntry *le = logger_find_log_entry(id);
+    const char *format = logger_decoder_find_format(id, resolver, context, formats);
 
-    if(le != NULL) {
-      const char *format = le->format;
-      return logger_decoder_decode_entry_helper(dst, d_len, id, format, entry, entry_len);
+    if(format != NULL) {
+      return logger_decoder_decode_timed_entry_helper(dst, d_len, id, entry_time, format, entry, entry_len);
     } else if(!initialized) {
       const char *format = "%s";
-      return logger_decoder_decode_entry_helper(dst, d_len, id, format, entry, entry_len);
+      return logger_decoder_decode_timed_entry_helper(dst, d_len, id, entry_time, format, entry, entry_len);
     }
   }
   return ERROR_DECODING;
@@ -551,6 +1217,17 @@ static size_t logger_decoder_get_length_of_next_entry(const char *entry, size_t
 void logger_initialize(void) {
   log_entries_count = 0;
   log_writers_count = 0;
+  log_clock = NULL;
+  log_cycle_counter = NULL;
+  log_stats_interval = 0;
+  logger_reset_stats();
+  memset(log_dynamic_formats, 0, sizeof(log_dynamic_formats));
+  log_printf_interning = false;
+  log_definition_interval = 0;
+  log_time_anchor_interval = 0;
+  log_aggregations_count = 0;
+  memset(&log_disabled_ids, 0, sizeof(log_disabled_ids));
+  logger_set_format_resolver(NULL, NULL);
   logger_initialize_all_log_entries();
   initialized = true;
 }
@@ -559,10 +1236,12 @@ bool logger_register_log_entries(LogEntry *entries, size_t count) {
   return logger_register_log_entries_helper(entries, count);
 }
 
-bool logger_register_log_writer(LogWriter writer, LogSeverity severity, bool encode) {
+static bool logger_register_log_writer_helper(LogWriter writer, LogWriterReserve reserve, LogWriterCommit commit, LogSeverity severity, bool encode) {
   unsigned int i;
   for(i = 0; i < log_writers_count; i ++) { // do not register duplicates
     if(log_writers[i].writer == writer
+        && log_writers[i].reserve == reserve
+        && log_writers[i].commit == commit
         && log_writers[i].severity == severity
         && log_writers[i].is_encoded == encode) {
       return false;
@@ -570,14 +1249,299 @@ bool logger_register_log_writer(LogWriter writer, LogSeverity severity, bool enc
   }
   if(log_writers_count < MAX_LOG_WRITERS) {
     log_writers[log_writers_count].writer = writer;
+    log_writers[log_writers_count].reserve = reserve;
+    log_writers[log_writers_count].commit = commit;
     log_writers[log_writers_count].severity = severity;
     log_writers[log_writers_count].is_encoded = encode;
+    log_writers[log_writers_count].ids = NULL;
+    log_writers[log_writers_count].last_timestamp = 0;
+    log_writers[log_writers_count].anchor = 0;
+    log_writers[log_writers_count].timed_entries = 0;
+    memset(&log_stats.writers[log_writers_count], 0, sizeof(log_stats.writers[log_writers_count]));
     log_writers_count ++;
     return true;
   }
   return false;
 }
 
+bool logger_register_log_writer(LogWriter writer, LogSeverity severity, bool encode) {
+  if(writer == NULL) {
+    return false;
+  }
+  return logger_register_log_writer_helper(writer, NULL, NULL, severity, encode);
+}
+
+/*
+ * register a writer that the entries are formatted into without a copy.
+ */
+bool logger_register_log_writer_reserve(LogWriterReserve reserve, LogWriterCommit commit, LogSeverity severity, bool encode) {
+  if(reserve == NULL || commit == NULL) {
+    return false;
+  }
+  return logger_register_log_writer_helper(NULL, reserve, commit, severity, encode);
+}
+
+/*
+ * set the clock that timestamps the entries or NULL to stop timestamping.
+ */
+void logger_set_clock(LogClock clock) {
+  unsigned int i;
+  for(i = 0; i < log_writers_count; i ++) {
+    log_writers[i].last_timestamp = 0;
+    log_writers[i].anchor = 0;
+    log_writers[i].timed_entries = 0;
+  }
+  log_clock = clock;
+}
+
+/*
+ * write the absolute time instead of the delta in every given number of
+ * timestamped entries of a writer, starting with its first one, or never if
+ * zero.
+ */
+void logger_set_time_anchor_interval(uint32_t entries) {
+  log_time_anchor_interval = entries;
+}
+
+/*
+ * write the absolute time in the next timestamped entry of every writer, e.g.
+ * after a writer starts a new file.
+ */
+void logger_anchor_time(void) {
+  unsigned int i;
+  for(i = 0; i < log_writers_count; i ++) {
+    STATS_OR(log_writers[i].anchor, 1);
+  }
+}
+
+/*
+ * enable or disable dynamic ids for the formats of logger_printf. the
+ * definitions are written again to every writer when it is enabled, so a new
+ * log can be started and decoded on its own.
+ */
+void logger_set_printf_interning(bool enabled) {
+  unsigned int i;
+  for(i = 0; i < LOGGER_MAX_DYNAMIC_IDS; i ++) {
+    STATS_AND(log_dynamic_formats[i].defined, 0);
+  }
+  log_printf_interning = enabled;
+}
+
+/*
+ * set the bits of the ids from first to last, both included, to value.
+ */
+void logger_id_mask_set_range(LogIdMask *mask, LogId first, LogId last, bool value) {
+  unsigned int id = first;
+
+  while(id <= last) {
+    uint32_t bits;
+    unsigned int end = (id | 31) < last ? (id | 31) : last; // last id in the word
+    if((id & 31) == 0 && end - id == 31) {
+      bits = 0xFFFFFFFF;
+    } else {
+      bits = ((1u << (end - id + 1)) - 1) << (id & 31);
+    }
+    if(value) {
+      mask->words[id >> 5] |= bits;
+    } else {
+      mask->words[id >> 5] &= ~bits;
+    }
+    id = end + 1;
+  }
+}
+
+/*
+ * enable or disable the ids from first to last, both included, for all the
+ * writers, e.g. 0x8000 to 0x8FFF for the NiQ block.
+ */
+void logger_enable_ids(LogId first, LogId last, bool enabled) {
+  logger_id_mask_set_range(&log_disabled_ids, first, last, !enabled);
+}
+
+/*
+ * set the ids that the writer with the given index (the order of
+ * registration) writes whatever their severity or NULL for none.
+ * the mask is not copied and can be changed while it is set.
+ */
+bool logger_set_writer_id_mask(size_t writer, const LogIdMask *mask) {
+  if(writer >= log_writers_count) {
+    return false;
+  }
+  log_writers[writer].ids = mask;
+  return true;
+}
+
+/*
+ * aggregate the entries of a registered id over windows of the given number of
+ * entries and write every sample-th entry as it is, 0 for no samples. the
+ * format of the id must have a numeric parameter. a window of 0 stops the
+ * aggregation of the id and writes the summaries of its last window.
+ * return false if the id cannot be aggregated or there are too many ids.
+ */
+bool logger_set_aggregation(LogId id, uint32_t window, uint32_t sample) {
+  LogAggregation *aggregation = logger_find_aggregation(id);
+  LogEntry *entry = logger_find_log_entry(id);
+  LogAggregation config;
+  bool is_numeric = false;
+  long len;
+
+  if(window == 0) {
+    if(aggregation != NULL) {
+      logger_flush_aggregation(aggregation);
+      *aggregation = log_aggregations[-- log_aggregations_count];
+    }
+    return true;
+  }
+  if(entry == NULL || id == LOGGER_AGGREGATE) {
+    return false;
+  }
+
+  memset(&config, 0, sizeof(config));
+  config.id = id;
+  config.window = window;
+  config.sample = sample;
+  char *fmt = (char *) entry->format;
+  while((len = logger_find_next_specifier(&fmt)) > 0) {
+    if(config.parameter_count == LOGGER_AGGREGATION_MAX_PARAMETERS) {
+      return false;
+    }
+    fmt += len;
+    config.specifiers[config.parameter_count ++] = fmt[-1];
+    is_numeric |= logger_is_numeric_specifier(fmt[-1]);
+  }
+  if(len < 0 || !is_numeric) {
+    return false;
+  }
+
+  if(aggregation != NULL) {
+    logger_flush_aggregation(aggregation);
+  } else if(log_aggregations_count < LOGGER_MAX_AGGREGATIONS) {
+    aggregation = &log_aggregations[log_aggregations_count ++];
+  } else {
+    return false;
+  }
+  *aggregation = config;
+  return true;
+}
+
+/*
+ * write the summaries of the windows that are not full yet, e.g. before the
+ * log is closed.
+ */
+void logger_flush_aggregations(void) {
+  unsigned int i;
+  for(i = 0; i < log_aggregations_count; i ++) {
+    logger_flush_aggregation(&log_aggregations[i]);
+  }
+}
+
+/*
+ * write the definition of a dynamic id again to a writer when it wrote at
+ * least the given number of entries since the previous one, or never if zero.
+ * a log that only keeps its last part, like a flight recorder that wraps, a
+ * rotated file or packets that a query decompresses, can then be decoded.
+ */
+void logger_set_definition_interval(uint32_t entries) {
+  log_definition_interval = entries;
+}
+
+/*
+ * set the counter that measures the time spent formatting and writing the
+ * entries or NULL to stop measuring.
+ */
+void logger_set_cycle_counter(LogCycleCounter counter) {
+  log_cycle_counter = counter;
+}
+
+/*
+ * take a snapshot of the statistics. the counters of different writers and ids
+ * are read one by one while they may be updated.
+ */
+void logger_get_stats(LogStats *stats) {
+  unsigned int i, j;
+
+  memset(stats, 0, sizeof(*stats));
+
+  stats->writer_count = log_writers_count;
+  for(i = 0; i < log_writers_count; i ++) {
+    LogWriterStats *writer_stats = &log_stats.writers[i];
+    logger_stats_copy_counters(&stats->writers[i].counters, &writer_stats->counters);
+    for(j = 0; j < LOGGER_STATS_HISTOGRAM_BUCKETS; j ++) {
+      stats->writers[i].format_cycles[j] = STATS_LOAD(writer_stats->format_cycles[j]);
+      stats->writers[i].writer_cycles[j] = STATS_LOAD(writer_stats->writer_cycles[j]);
+    }
+  }
+
+  for(i = 0; i < LOGGER_STATS_MAX_IDS; i ++) {
+    uint32_t key = STATS_LOAD(log_stats_keys[i]);
+    if(key != 0) {
+      LogIdStats *id_stats = &stats->ids[stats->id_count ++];
+      id_stats->id = (LogId) (key - 1);
+      logger_stats_copy_counters(&id_stats->counters, &log_stats.ids[i].counters);
+    }
+  }
+
+  stats->untracked_entries = STATS_LOAD(log_stats.untracked_entries);
+  stats->unknown_ids = STATS_LOAD(log_stats.unknown_ids);
+}
+
+void logger_reset_stats(void) {
+  memset(&log_stats, 0, sizeof(log_stats));
+  memset(log_stats_keys, 0, sizeof(log_stats_keys));
+  memset(&log_stats_untracked_ids, 0, sizeof(log_stats_untracked_ids));
+  log_stats_countdown = log_stats_interval;
+}
+
+/*
+ * log the statistics of every writer and id as entries. nothing is logged if
+ * they are being logged already, by a writer that logs or by another thread.
+ */
+void logger_log_stats(LogSeverity severity) {
+  LogStats stats;
+  unsigned int i;
+
+  if(STATS_EXCHANGE(log_stats_logging, 1) != 0) {
+    return;
+  }
+  logger_get_stats(&stats);
+
+  for(i = 0; i < stats.writer_count; i ++) {
+    LogCounters *c = &stats.writers[i].counters;
+    logger_severity_log(severity, LOGGER_STATS_WRITER, i, c->entries, c->bytes, c->truncations, c->formatting_errors, c->filtered);
+  }
+  for(i = 0; i < stats.id_count; i ++) {
+    LogCounters *c = &stats.ids[i].counters;
+    logger_severity_log(severity, LOGGER_STATS_ID, stats.ids[i].id, c->entries, c->bytes, c->truncations, c->formatting_errors, c->filtered);
+  }
+  logger_severity_log(severity, LOGGER_STATS_UNTRACKED, stats.untracked_entries, stats.unknown_ids);
+  STATS_EXCHANGE(log_stats_logging, 0);
+}
+
+/*
+ * log the statistics after every given number of entries or never if zero.
+ */
+void logger_set_stats_interval(uint32_t entries) {
+  log_stats_interval = entries;
+  log_stats_countdown = entries;
+}
+
+/*
+ * a clock with a millisecond tick that is cheap to read on linux.
+ */
+uint32_t logger_clock_monotonic_coarse(void) {
+#if defined(CLOCK_MONOTONIC_COARSE)
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+  return (uint32_t) (ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+#elif defined(CLOCK_MONOTONIC)
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t) (ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+#else
+  return (uint32_t) (clock() / (CLOCKS_PER_SEC / 1000));
+#endif
+}
+
 
 
 void logger_log(int id, ...) {
@@ -626,9 +1590,25 @@ void logger_severity_printf(LogSeverity severity, const char * format, ...) {
  * update s_unused_bytes to show the number of unused bytes in the source.
  * the destination buffer must be large enough to at least hold one decoded entry,
  * otherwise no decoding will happen.
+ * the time of the timestamped entries is added up from zero in every call and
+ * dynamic ids are only decoded if their definition is in the same source.
  * return the number of characters that are written to the destination.
  */
 size_t logger_decode(char *dst, size_t d_len, const char *src, size_t s_len, size_t *s_unused_bytes) {
+  unsigned long long time = 0;
+  LoggerFormats formats;
+  logger_formats_init(&formats);
+  return logger_decode_timed(dst, d_len, src, s_len, s_unused_bytes, &time, &formats);
+}
+
+/*
+ * like logger_decode but the time of the timestamped entries continues from
+ * time, which is updated to the time of the last decoded entry, and the
+ * definitions of dynamic ids are learned in formats, or only skipped if it is
+ * NULL. both are owned by the caller and keep the state of one log between
+ * calls: time is zero and formats is initialized at the start of a log.
+ */
+size_t logger_decode_timed(char *dst, size_t d_len, const char *src, size_t s_len, size_t *s_unused_bytes, unsigned long long *time, LoggerFormats *formats) {
   const size_t original_d_len = d_len;
   char *entry = (char *) src;
   size_t entry_len;
@@ -637,7 +1617,8 @@ size_t logger_decode(char *dst, size_t d_len, const char *src, size_t s_len, siz
     if(entry_len == 2 && !strncmp(entry, "\n\n", 2)) { // "\n\n" can happen
       entry_len = 1; // skip the first '\n'
     } else {
-      int len = logger_decoder_decode_entry(dst, d_len, entry, entry_len);
+      unsigned long long entry_time = *time;
+      int len = logger_decoder_decode_entry(dst, d_len, entry, entry_len, &entry_time, decoder_resolver, decoder_resolver_context, formats);
 
       if(len == ERROR_DECODING) { // decoding failed
         if(entry[0] == '\n') { // do not write the first '\n'
@@ -651,6 +1632,7 @@ size_t logger_decode(char *dst, size_t d_len, const char *src, size_t s_len, siz
         break;
       }
 
+      *time = entry_time;
       dst += len;
       d_len -= len;
     }
@@ -663,7 +1645,360 @@ size_t logger_decode(char *dst, size_t d_len, const char *src, size_t s_len, siz
   return original_d_len - d_len;
 }
 
+/*
+ * add the ticks of an entry that is not decoded to time, as decoding it
+ * would, so the entries after it get the same time as in a full decode.
+ */
+void logger_decode_skip(const char *entry, size_t entry_len, unsigned long long *time) {
+  if(logger_decoder_is_entry_decodable(entry, entry_len)) {
+    logger_decoder_add_time(entry, entry_len, time);
+  }
+}
+
+/*
+ * update time with the ticks of a timestamped header. a delta is a signed 32
+ * bit number of ticks. an absolute tick count of an anchor replaces the lower
+ * 32 bits of time and keeps the wraps of the clock that time already has, so
+ * time is absolute from the first anchor on even if the log did not start
+ * with the first entry of the writer.
+ */
+void logger_decode_advance_time(unsigned long long *time, unsigned long ticks, bool absolute) {
+  if(absolute) {
+    unsigned long long anchored = (*time & ~0xFFFFFFFFull) | (uint32_t) ticks;
+    if(anchored + 0x80000000ull < *time) { // the clock wrapped
+      anchored += 0x100000000ull;
+    }
+    *time = anchored;
+  } else {
+    *time += (long long) (int32_t) (uint32_t) ticks;
+  }
+}
+
+/*
+ * set the fields of the record to the parameters of a valid entry and the
+ * specifiers of its format.
+ * return false if the entry is not valid.
+ */
+static bool logger_decoder_record_entry(LoggerRecord *record, const char *entry, size_t entry_len, unsigned long long *time, LoggerFormats *formats) {
+  const char *end = entry + entry_len - 1; // the end '\n'
+  unsigned long delta;
+  long slen;
+
+  if(!logger_decoder_is_entry_decodable(entry, entry_len)) {
+    return false;
+  }
+  record->id = logger_decoder_get_id(entry);
+  if(record->id == LOGGER_DEFINE_FORMAT) {
+    logger_decoder_learn_format(formats, entry, entry_len);
+  }
+  record->format = logger_decoder_find_format(record->id, decoder_resolver, decoder_resolver_context, formats);
+  if(record->format == NULL && initialized) {
+    return false;
+  }
+
+  const char *field = entry + logger_decoder_get_header_length(entry, entry_len, &delta);
+  record->field_count = 0;
+  while(field < end) { // every field ends with '|'
+    const char *separator = (const char *) memchr(field, '|', end - field);
+    if(record->field_count == LOGGER_RECORD_MAX_FIELDS) {
+      return false;
+    }
+    record->fields[record->field_count].data = field;
+    record->fields[record->field_count].length = separator - field;
+    record->fields[record->field_count].specifier = 0;
+    record->field_count ++;
+    field = separator + 1;
+  }
+
+  char *fmt = (char *) record->format;
+  size_t i;
+  for(i = 0; fmt != NULL && i < record->field_count && (slen = logger_find_next_specifier(&fmt)) > 0; i ++) {
+    fmt += slen;
+    record->fields[i].specifier = fmt[-1];
+  }
+
+  record->has_time = logger_decoder_add_time(entry, entry_len, time);
+  if(record->has_time) {
+    record->time = *time;
+  }
+  return true;
+}
+
+/*
+ * decode the next entry of the source into a record whose fields point into
+ * the source. an entry that is not valid is returned with LOGGER_ERROR_ID and
+ * its text as the only field.
+ * time is the time of the previous timestamped entry and it is updated if the
+ * entry is timestamped. a definition of a dynamic id is returned as a record
+ * and learned in formats if it is not NULL (see logger_decode_timed).
+ * update s_unused_bytes to the number of unused bytes in the source.
+ * return false if there is not a complete entry in the source.
+ */
+bool logger_decode_record(LoggerRecord *record, const char *src, size_t s_len, size_t *s_unused_bytes, unsigned long long *time, LoggerFormats *formats) {
+  size_t entry_len;
+
+  while((entry_len = logger_decoder_get_length_of_next_entry(src, s_len)) > 0) {
+    if(entry_len == 2 && !strncmp(src, "\n\n", 2)) { // "\n\n" can happen
+      src ++;
+      s_len --;
+      continue;
+    }
+
+    if(logger_decoder_record_entry(record, src, entry_len, time, formats)) {
+      s_len -= entry_len;
+    } else {
+      const size_t skip = src[0] == '\n' ? 1 : 0; // do not use the first '\n'
+      record->id = LOGGER_ERROR_ID;
+      record->format = NULL;
+      record->has_time = false;
+      record->field_count = 1;
+      record->fields[0].data = src + skip;
+      record->fields[0].length = entry_len - 1 - skip;
+      record->fields[0].specifier = 's';
+      s_len -= entry_len - 1; // keep the end '\n'
+    }
+    *s_unused_bytes = s_len;
+    return true;
+  }
+
+  *s_unused_bytes = s_len;
+  return false;
+}
+
+/*
+ * start the formats of a log without any learned dynamic id.
+ */
+void logger_formats_init(LoggerFormats *formats) {
+  memset(formats->defined, 0, sizeof(formats->defined));
+}
+
+/*
+ * return the format of an id like logger_get_format or of a dynamic id that
+ * is learned in formats, or NULL.
+ */
+const char *logger_formats_find(const LoggerFormats *formats, LogId id) {
+  return logger_decoder_find_format(id, decoder_resolver, decoder_resolver_context, formats);
+}
+
+/*
+ * set the resolver that is asked for the format of an id before the registered
+ * entries when decoding. the context is passed to the resolver. a NULL
+ * resolver only uses the registered entries.
+ */
+void logger_set_format_resolver(LogFormatResolver resolver, void *context) {
+  decoder_resolver = resolver;
+  decoder_resolver_context = context;
+}
+
+
+
+static size_t logger_decoder_flush_output(LoggerDecoder *decoder, char *dst, size_t d_len) {
+  size_t n = MINIMUM(d_len, decoder->output_length - decoder->output_position);
+  memcpy(dst, &decoder->output[decoder->output_position], n);
+  decoder->output_position += n;
+  return n;
+}
+
+/*
+ * decode a complete entry like logger_decode and write it in destination or
+ * keep what does not fit in the decoder output.
+ * return the number of characters of the entry that are used; the end '\n' of
+ * an invalid entry or of "\n\n" is not used because it starts the next entry.
+ */
+static size_t logger_decoder_decode_next_entry(LoggerDecoder *decoder, char **dst, size_t *d_len, const char *entry, size_t entry_len) {
+  unsigned long long time = decoder->time;
+  LogFormatResolver resolver = decoder->resolver != NULL ? decoder->resolver : decoder_resolver;
+  void *context = decoder->resolver != NULL ? decoder->resolver_context : decoder_resolver_context;
+  size_t used = entry_len;
+  int len;
+
+  if(entry_len == 2 && entry[0] == '\n' && entry[1] == '\n') { // "\n\n" can happen
+    return 1;
+  }
+
+  char *out = *d_len > 0 ? *dst : decoder->output;
+  size_t out_len = *d_len > 0 ? *d_len : LOGGER_DECODER_OUTPUT_SIZE;
+  while(true) {
+    len = logger_decoder_decode_entry(out, out_len, entry, entry_len, &time, resolver, context, &decoder->formats);
+    if(len == ERROR_DECODING) {
+      if(entry[0] == '\n') { // do not write the first '\n'
+        len = logger_decoder_write_invalid_entry(out, out_len, entry + 1, entry_len - 1);
+      } else {
+        len = logger_decoder_write_invalid_entry(out, out_len, entry, entry_len);
+      }
+      used = entry_len - 1; // keep the end '\n'
+    }
+    if((size_t) len <= out_len || out == decoder->output) {
+      break;
+    }
+    // decode again in the decoder output
+    time = decoder->time;
+    out = decoder->output;
+    out_len = LOGGER_DECODER_OUTPUT_SIZE;
+  }
+  decoder->time = time;
+
+  if(out == decoder->output) {
+    decoder->output_position = 0;
+    decoder->output_length = MINIMUM((size_t) len, out_len);
+    len = logger_decoder_flush_output(decoder, *dst, *d_len);
+  }
+  *dst += len;
+  *d_len -= len;
+  return used;
+}
+
+void logger_decoder_init(LoggerDecoder *decoder) {
+  decoder->entry_length = 0;
+  decoder->output_position = 0;
+  decoder->output_length = 0;
+  decoder->time = 0;
+  decoder->resolver = NULL;
+  decoder->resolver_context = NULL;
+  logger_formats_init(&decoder->formats);
+}
+
+/*
+ * set the resolver of the formats of this decoder instead of the resolver of
+ * the logger. a NULL resolver uses the resolver of the logger again.
+ */
+void logger_decoder_set_format_resolver(LoggerDecoder *decoder, LogFormatResolver resolver, void *context) {
+  decoder->resolver = resolver;
+  decoder->resolver_context = context;
+}
+
+/*
+ * decode the source and write in destination. unlike logger_decode, an entry
+ * that is not complete is kept in the decoder and a decoded entry that does
+ * not fit is kept in the decoder output, so the source is always consumed until
+ * it is empty or the destination is full. the caller continues from the first
+ * character that is not consumed; call again with an empty source to get the
+ * pending output.
+ * update s_consumed_bytes to the number of characters consumed from the source.
+ * return the number of characters written into the destination.
+ */
+size_t logger_decoder_decode(LoggerDecoder *decoder, char *dst, size_t d_len, const char *src, size_t s_len, size_t *s_consumed_bytes) {
+  const size_t original_d_len = d_len;
+  const char *original_src = src;
+  const char *end;
+  size_t used;
+
+  used = logger_decoder_flush_output(decoder, dst, d_len);
+  dst += used;
+  d_len -= used;
+
+  while(s_len > 0 && logger_decoder_pending(decoder) == 0) {
+    if(decoder->entry_length == 0) { // decode the entries in the source without copying them
+      end = s_len > 1 ? (const char *) memchr(src + 1, '\n', s_len - 1) : NULL;
+      if(end != NULL) {
+        used = logger_decoder_decode_next_entry(decoder, &dst, &d_len, src, end - src + 1);
+        src += used;
+        s_len -= used;
+        continue;
+      }
+    }
+
+    // append to the entry, keep a character for the end '\n' if it is too long
+    end = (const char *) memchr(src, '\n', s_len);
+    const size_t n = end != NULL ? (size_t) (end - src + 1) : s_len;
+    const size_t space = LOGGER_DECODER_ENTRY_SIZE - 1 - decoder->entry_length;
+    memcpy(&decoder->entry[decoder->entry_length], src, MINIMUM(n, space));
+    decoder->entry_length += MINIMUM(n, space);
+    src += n;
+    s_len -= n;
+
+    if(decoder->entry_length == 1 && end == src - 1) { // the first '\n' of the entry
+      continue;
+    }
+    if(end == NULL) {
+      break;
+    }
+    if(n > space) {
+      decoder->entry[decoder->entry_length ++] = '\n';
+    }
+    used = logger_decoder_decode_next_entry(decoder, &dst, &d_len, decoder->entry, decoder->entry_length);
+    if(used < decoder->entry_length) { // the end '\n' starts the next entry
+      decoder->entry[0] = '\n';
+      decoder->entry_length = 1;
+    } else {
+      decoder->entry_length = 0;
+    }
+  }
+
+  *s_consumed_bytes = src - original_src;
+  return original_d_len - d_len;
+}
+
+/*
+ * return the number of decoded characters that are kept in the decoder.
+ */
+size_t logger_decoder_pending(const LoggerDecoder *decoder) {
+  return decoder->output_length - decoder->output_position;
+}
+
+/*
+ * return the format of the resolver of the logger or of a registered id, or
+ * NULL. the formats of dynamic ids are learned per log (see logger_formats_find).
+ */
+const char *logger_get_format(LogId id) {
+  return logger_decoder_find_format(id, decoder_resolver, decoder_resolver_context, NULL);
+}
+
 size_t logger_get_max_buffer_size() {
   return LOG_LINE_SIZE;
 }
 
+
+/*
+ * write the text of a preset dictionary for the compressor (see lzss.h): the
+ * encoded header of every entry of logger.defs followed by a separator per
+ * parameter, then the formats without their specifiers while they fit.
+ * return the number of characters written.
+ */
+size_t logger_get_preset_text(char *dst, size_t d_len) {
+  const size_t count = sizeof(all_log_entries) / sizeof(all_log_entries[0]);
+  char header[32]; // "\nXXXX|" and the separators
+  size_t i, len = 0;
+
+  for(i = 0; i < count; i ++) {
+    const LogEntry *entry = &all_log_entries[i];
+    char *fmt = (char *) entry->format;
+    int n = snprintf(header, sizeof(header), "\n%04X|", entry->id);
+
+    if(entry->id == LOGGER_INVALID_ID || entry->id == LOGGER_ERROR_ID) {
+      continue;
+    }
+    while(n < (int) sizeof(header) - 1 && logger_find_next_specifier(&fmt) > 0) {
+      header[n ++] = '|';
+      fmt ++;
+    }
+    if(len + n > d_len) {
+      return len;
+    }
+    memcpy(dst + len, header, n);
+    len += n;
+  }
+
+  for(i = 0; i < count; i ++) {
+    const char *fmt = all_log_entries[i].format;
+    char *next = (char *) fmt;
+    long slen;
+
+    while(*fmt != 0) {
+      slen = logger_find_next_specifier(&next);
+      size_t n = slen > 0 ? (size_t) (next - fmt) : strlen(fmt);
+      if(len + n > d_len) {
+        return len;
+      }
+      memcpy(dst + len, fmt, n);
+      len += n;
+      if(slen <= 0) {
+        break;
+      }
+      fmt = next + slen;
+      next = (char *) fmt;
+    }
+  }
+
+  return len;
+}
@@ -15,8 +15,20 @@ extern "C" {
 // to be able to write a buffer of bytes into persistent memory
 typedef void (*LogWriter)(const uint8_t *data, const size_t length);
 
+// a LogWriter that owns its memory (a page cache, a DMA buffer, a ring) can
+// instead be registered with LogWriterReserve and LogWriterCommit. the entry
+// is formatted directly into the memory returned by reserve, which must have
+// room for length bytes or be NULL to drop the entry. commit is then called
+// with the bytes that were written, which are at most the reserved length.
+typedef uint8_t *(*LogWriterReserve)(const size_t length);
+typedef void (*LogWriterCommit)(const size_t length);
+
 typedef uint16_t LogId;
 
+// LogClock returns a monotonic tick count that is used to timestamp entries.
+// it is called once per entry so it must be cheap. it may wrap around.
+typedef uint32_t (*LogClock)(void);
+
 typedef enum {
   SEVERITY_VERBOSE,
   SEVERITY_DEBUG,
@@ -26,11 +38,107 @@ typedef enum {
   SEVERITY_FATAL
 } LogSeverity;
 
+// LogCycleCounter returns a cycle or tick count that is used to measure the
+// time spent formatting and writing entries.
+typedef uint32_t (*LogCycleCounter)(void);
+
 typedef struct {
   uint16_t id;
   const char * const format;
 } LogEntry;
 
+// LogFormatResolver returns the format of an id for the decoder or NULL if it
+// does not know the id, e.g. a lookup in a format database of a firmware.
+typedef const char *(*LogFormatResolver)(void *context, LogId id);
+
+#define LOGGER_MAX_WRITERS 4
+#define LOGGER_DYNAMIC_ID_FIRST 0xF000 // ids assigned to the formats of logger_printf
+#define LOGGER_MAX_DYNAMIC_IDS 64
+#define LOGGER_STATS_MAX_IDS 32
+#define LOGGER_ID_MASK_WORDS (65536 / 32)
+#define LOGGER_MAX_AGGREGATIONS 8
+#define LOGGER_AGGREGATION_MAX_PARAMETERS 8
+#define LOGGER_STATS_HISTOGRAM_BUCKETS 16 // bucket i counts durations in [2^i, 2^(i+1))
+
+// one bit for every LogId
+typedef struct {
+  uint32_t words[LOGGER_ID_MASK_WORDS];
+} LogIdMask;
+
+#define LOGGER_ID_MASK_TEST(_mask_, _id_) (((_mask_)->words[(LogId) (_id_) >> 5] >> ((_id_) & 31)) & 1)
+
+typedef struct {
+  uint32_t entries;
+  uint32_t bytes;
+  uint32_t truncations;
+  uint32_t formatting_errors;
+  uint32_t filtered; // by severity
+  uint32_t dropped;  // the writer could not reserve memory for the entry
+  uint32_t aggregated; // added to the summary of an aggregation, only counted for ids
+} LogCounters;
+
+typedef struct {
+  LogCounters counters;
+  uint32_t format_cycles[LOGGER_STATS_HISTOGRAM_BUCKETS];
+  uint32_t writer_cycles[LOGGER_STATS_HISTOGRAM_BUCKETS];
+} LogWriterStats;
+
+typedef struct {
+  LogId id;
+  LogCounters counters;
+} LogIdStats;
+
+typedef struct {
+  size_t writer_count;
+  LogWriterStats writers[LOGGER_MAX_WRITERS];
+  size_t id_count;
+  LogIdStats ids[LOGGER_STATS_MAX_IDS];
+  uint32_t untracked_entries; // entries of ids that did not fit in the ids table
+  uint32_t unknown_ids;       // entries logged with an unregistered id
+} LogStats;
+
+#define LOGGER_FORMAT_SIZE 128 // of a learned format with its null character
+
+// formats of the dynamic ids learned from the definitions of one log
+typedef struct {
+  char formats[LOGGER_MAX_DYNAMIC_IDS][LOGGER_FORMAT_SIZE];
+  bool defined[LOGGER_MAX_DYNAMIC_IDS];
+} LoggerFormats;
+
+#define LOGGER_DECODER_ENTRY_SIZE 256  // longer entries are truncated and decoded as invalid
+#define LOGGER_DECODER_OUTPUT_SIZE 512 // longer decoded entries are truncated
+
+// state of a decoder that is fed with chunks of an encoded log of any size
+typedef struct {
+  char entry[LOGGER_DECODER_ENTRY_SIZE]; // entry that is not complete in the input yet
+  size_t entry_length;
+  char output[LOGGER_DECODER_OUTPUT_SIZE]; // decoded entry that did not fit in the destination
+  size_t output_position;
+  size_t output_length;
+  unsigned long long time; // time of the last timestamped entry
+  LogFormatResolver resolver; // NULL to use the resolver of the logger
+  void *resolver_context;
+  LoggerFormats formats; // learned from the definitions of the log
+} LoggerDecoder;
+
+#define LOGGER_RECORD_MAX_FIELDS 16
+
+typedef struct {
+  const char *data; // points into the decoded source, it is not null terminated
+  size_t length;
+  char specifier;   // conversion character of the format specifier or 0 if unknown
+} LoggerField;
+
+// an entry decoded without copying or formatting its parameters
+typedef struct {
+  LogId id;
+  const char *format; // NULL if the id is not registered
+  bool has_time;
+  unsigned long long time;
+  size_t field_count;
+  LoggerField fields[LOGGER_RECORD_MAX_FIELDS];
+} LoggerRecord;
+
 enum {
 #define LOG_ENTRY(_id_, _value_, _format_) _id_ = _value_,
 #include "logger.defs"
@@ -41,6 +149,28 @@ void logger_initialize(void);
 
 bool logger_register_log_entries(LogEntry *entries, size_t count);
 bool logger_register_log_writer(LogWriter writer, LogSeverity severity, bool encode);
+bool logger_register_log_writer_reserve(LogWriterReserve reserve, LogWriterCommit commit, LogSeverity severity, bool encode);
+
+void logger_set_clock(LogClock clock);
+void logger_set_time_anchor_interval(uint32_t entries);
+void logger_anchor_time(void);
+uint32_t logger_clock_monotonic_coarse(void);
+
+void logger_set_printf_interning(bool enabled);
+void logger_set_definition_interval(uint32_t entries);
+
+void logger_id_mask_set_range(LogIdMask *mask, LogId first, LogId last, bool value);
+void logger_enable_ids(LogId first, LogId last, bool enabled);
+bool logger_set_writer_id_mask(size_t writer, const LogIdMask *mask);
+
+bool logger_set_aggregation(LogId id, uint32_t window, uint32_t sample);
+void logger_flush_aggregations(void);
+
+void logger_set_cycle_counter(LogCycleCounter counter);
+void logger_get_stats(LogStats *stats);
+void logger_reset_stats(void);
+void logger_log_stats(LogSeverity severity);
+void logger_set_stats_interval(uint32_t entries);
 
 void logger_log(int id, ...);
 void logger_severity_log(LogSeverity severity, int id, ...);
@@ -48,8 +178,25 @@ void logger_printf(const char * format, ...) __attribute__ ((format (printf, 1,
 void logger_severity_printf(LogSeverity severity, const char * format, ...) __attribute__ ((format (printf, 2, 3)));
 
 size_t logger_decode(char *dst, size_t d_len, const char *src, size_t s_len, size_t *s_unused_bytes);
+size_t logger_decode_timed(char *dst, size_t d_len, const char *src, size_t s_len, size_t *s_unused_bytes, unsigned long long *time, LoggerFormats *formats);
+void logger_decode_skip(const char *entry, size_t entry_len, unsigned long long *time);
+void logger_decode_advance_time(unsigned long long *time, unsigned long ticks, bool absolute);
+void logger_set_format_resolver(LogFormatResolver resolver, void *context);
+
+bool logger_decode_record(LoggerRecord *record, const char *src, size_t s_len, size_t *s_unused_bytes, unsigned long long *time, LoggerFormats *formats);
+
+void logger_formats_init(LoggerFormats *formats);
+const char *logger_formats_find(const LoggerFormats *formats, LogId id);
+
+void logger_decoder_init(LoggerDecoder *decoder);
+void logger_decoder_set_format_resolver(LoggerDecoder *decoder, LogFormatResolver resolver, void *context);
+size_t logger_decoder_decode(LoggerDecoder *decoder, char *dst, size_t d_len, const char *src, size_t s_len, size_t *s_consumed_bytes);
+size_t logger_decoder_pending(const LoggerDecoder *decoder);
+
+const char *logger_get_format(LogId id);
 
 size_t logger_get_max_buffer_size(void);
+size_t logger_get_preset_text(char *dst, size_t d_len);
 
 #ifdef __cplusplus
 }
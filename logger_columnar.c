@@ -0,0 +1,917 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "logger.h"
+#include "logger_columnar.h"
+
+/*
+ * the columnar archive splits an encoded log into a spine with the id and the
+ * timestamp of every entry and one column per parameter of every id, so the
+ * values of a parameter are stored next to each other and a scan reads only
+ * the columns it needs. the text is restored exactly: what is not a canonical
+ * entry (\nXXXX|..|\n or \nXXXX:T|..|\n with uppercase hexadecimal digits) is
+ * kept in the spine as raw text.
+ *
+ * a parameter whose specifier is an integer or a float is stored as a number
+ * if formatting the number with the specifier gives the same text again;
+ * floats are scaled by 10^precision. integers and floats are delta coded and
+ * hexadecimal integers are xored with the previous value of the column. all
+ * the other parameters are indexes into a dictionary of strings.
+ *
+ * header: "LGCA", version, 0, 0, 0, text length, entry count, id count,
+ *         string count, spine length, string bytes (u32 LE)
+ * ids:    id (u16 LE), usual parameter count, column count, and for every
+ *         column the length of its specifier, the specifier and the length of
+ *         the column (u32 LE)
+ * spine:  a varint per entry: (index of the id << 2 | count differs << 1 |
+ *         timestamped) << 1, followed by the ticks if it is timestamped and
+ *         by the parameter count if it differs from the usual count; or
+ *         (length << 1 | 1) followed by raw text
+ * strings: the offset of every string and of the end (u32 LE), the bytes
+ * columns: a varint per value: delta or xor << 1, or string index << 1 | 1
+ */
+
+static const char COLUMNAR_MAGIC[4] = { 'L', 'G', 'C', 'A' };
+
+#define MAX_NUMBER_SIZE 64 // longer parameters are strings
+#define MAX_DECIMALS 9
+#define MAX_SCALED ((long long) 1 << 53)
+
+static const double POWERS_OF_TEN[MAX_DECIMALS + 1] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+
+typedef struct {
+  uint8_t *data;
+  size_t length;
+  size_t capacity;
+  bool failed;
+} ByteBuffer;
+
+typedef struct {
+  char spec[LOGGER_COLUMNAR_MAX_SPEC_SIZE]; // empty if the parameter is not a number
+  char specifier;
+  unsigned int decimals;
+  long long previous;
+  ByteBuffer data;
+} Column;
+
+typedef struct {
+  LogId id;
+  uint8_t usual_count; // parameters of the first entry
+  uint8_t column_count;
+  Column columns[LOGGER_RECORD_MAX_FIELDS];
+} ColumnarId;
+
+typedef struct {
+  ColumnarId *ids;
+  size_t id_count;
+  ByteBuffer spine;
+  ByteBuffer strings;
+  ByteBuffer offsets;  // u32 LE offset of every string in strings
+  uint32_t string_count;
+  uint32_t *table;     // string index + 1 or zero, open addressing
+  size_t table_size;
+  uint32_t entry_count;
+  LoggerFormats *formats; // of the dynamic ids of the log
+} ColumnarEncoder;
+
+typedef struct {
+  LogId id;
+  bool has_time;
+  unsigned long delta;
+  size_t field_count;
+  const char *fields[LOGGER_RECORD_MAX_FIELDS];
+  size_t lengths[LOGGER_RECORD_MAX_FIELDS];
+} ColumnarEntry;
+
+typedef struct {
+  size_t text_size;
+  uint32_t entry_count;
+  uint32_t id_count;
+  uint32_t string_count;
+  const uint8_t *ids;
+  const uint8_t *spine;
+  size_t spine_len;
+  const uint8_t *strings;
+  const uint8_t *columns;
+} ColumnarLayout;
+
+
+
+static void write_u16(uint8_t *dst, uint16_t value) {
+  dst[0] = (uint8_t) value;
+  dst[1] = (uint8_t) (value >> 8);
+}
+
+static void write_u32(uint8_t *dst, uint32_t value) {
+  write_u16(dst, (uint16_t) value);
+  write_u16(dst + 2, (uint16_t) (value >> 16));
+}
+
+static uint16_t read_u16(const uint8_t *src) {
+  return (uint16_t) (src[0] | (src[1] << 8));
+}
+
+static uint32_t read_u32(const uint8_t *src) {
+  return read_u16(src) | ((uint32_t) read_u16(src + 2) << 16);
+}
+
+static bool buffer_reserve(ByteBuffer *buffer, size_t n) {
+  if(buffer->failed) {
+    return false;
+  }
+  if(buffer->length + n > buffer->capacity) {
+    size_t capacity = buffer->capacity ? buffer->capacity : 256;
+    while(capacity < buffer->length + n) {
+      capacity *= 2;
+    }
+    uint8_t *data = (uint8_t *) realloc(buffer->data, capacity);
+    if(data == NULL) {
+      buffer->failed = true;
+      return false;
+    }
+    buffer->data = data;
+    buffer->capacity = capacity;
+  }
+  return true;
+}
+
+static void buffer_append(ByteBuffer *buffer, const void *data, size_t n) {
+  if(n > 0 && buffer_reserve(buffer, n)) {
+    memcpy(buffer->data + buffer->length, data, n);
+    buffer->length += n;
+  }
+}
+
+static void buffer_append_varint(ByteBuffer *buffer, uint64_t value) {
+  uint8_t bytes[10];
+  size_t n = 0;
+  while(value >= 0x80) {
+    bytes[n ++] = (uint8_t) (value | 0x80);
+    value >>= 7;
+  }
+  bytes[n ++] = (uint8_t) value;
+  buffer_append(buffer, bytes, n);
+}
+
+static bool read_varint(const uint8_t **src, const uint8_t *end, uint64_t *value) {
+  unsigned int shift = 0;
+  *value = 0;
+  while(*src < end && shift < 64) {
+    const uint8_t c = *(*src) ++;
+    *value |= (uint64_t) (c & 0x7f) << shift;
+    if(!(c & 0x80)) {
+      return true;
+    }
+    shift += 7;
+  }
+  return false;
+}
+
+static uint64_t zigzag(long long value) {
+  return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+}
+
+static long long unzigzag(uint64_t value) {
+  return (long long) (value >> 1) ^ -(long long) (value & 1);
+}
+
+
+
+/*
+ * set the specifier and the decimals of a number parameter from its
+ * formatting or set the specifier to zero if it is not stored as a number.
+ */
+static void columnar_parse_spec(const char *spec, char *specifier, unsigned int *decimals) {
+  const size_t len = strlen(spec);
+  const char *dot = strchr(spec, '.');
+
+  *specifier = len > 1 ? spec[len - 1] : 0;
+  *decimals = 0;
+  if(*specifier == 0 || strchr("diuxXfF", *specifier) == NULL || strchr(spec, 'l') != NULL) {
+    *specifier = 0;
+  } else if(*specifier == 'f' || *specifier == 'F') {
+    *decimals = dot != NULL ? (unsigned int) atoi(dot + 1) : 6;
+    if(*decimals > MAX_DECIMALS) {
+      *specifier = 0;
+    }
+  }
+}
+
+/*
+ * copy the formatting of every specifier of the format into specs, like the
+ * logger finds them, and leave the others empty.
+ */
+static void columnar_find_specs(const char *format, char specs[][LOGGER_COLUMNAR_MAX_SPEC_SIZE], size_t count) {
+  const char *pos = format;
+  size_t i = 0, len;
+
+  while(pos != NULL && i < count && (pos = strchr(pos, '%')) != NULL) {
+    if(pos[1] == '%') {
+      pos += 2;
+      continue;
+    }
+    len = 1;
+    while(strchr("+- #.0123456789l", pos[len]) != NULL && pos[len] != 0) {
+      len ++;
+    }
+    if(pos[len] == 0 || strchr("diuxXfFcsp", pos[len]) == NULL || len + 1 >= LOGGER_COLUMNAR_MAX_SPEC_SIZE) {
+      break; // the logger writes a formatting error instead of the parameters
+    }
+    memcpy(specs[i], pos, len + 1);
+    specs[i][len + 1] = 0;
+    pos += len + 1;
+    i ++;
+  }
+}
+
+/*
+ * format the number like the logger formats the parameter.
+ * return the number of characters of the text.
+ */
+static int columnar_render(const char *spec, char specifier, unsigned int decimals, long long number, char *dst, size_t d_len) {
+  int len;
+  switch(specifier) {
+    case 'd': case 'i':
+      len = snprintf(dst, d_len, spec, (int) number);
+      break;
+    case 'u': case 'x': case 'X':
+      len = snprintf(dst, d_len, spec, (unsigned int) number);
+      break;
+    default:
+      len = snprintf(dst, d_len, spec, (double) number / POWERS_OF_TEN[decimals]);
+      break;
+  }
+  return len < 0 ? 0 : len;
+}
+
+/*
+ * return true and set number if formatting it gives the parameter again.
+ */
+static bool columnar_get_number(const Column *column, const char *s, size_t length, long long *number) {
+  char text[MAX_NUMBER_SIZE], rendered[MAX_NUMBER_SIZE];
+  char *end;
+
+  if(column->specifier == 0 || length == 0 || length >= MAX_NUMBER_SIZE) {
+    return false;
+  }
+  memcpy(text, s, length);
+  text[length] = 0;
+
+  switch(column->specifier) {
+    case 'd': case 'i': {
+      long long value = strtoll(text, &end, 10);
+      if(value < -2147483647LL - 1 || value > 2147483647LL) {
+        return false;
+      }
+      *number = value;
+      break;
+    }
+    case 'u': case 'x': case 'X': {
+      unsigned long long value = strtoull(text, &end, column->specifier == 'u' ? 10 : 16);
+      if(value > 0xFFFFFFFFULL) {
+        return false;
+      }
+      *number = (long long) value;
+      break;
+    }
+    default: {
+      double value = strtod(text, &end) * POWERS_OF_TEN[column->decimals];
+      if(!(value > -MAX_SCALED && value < MAX_SCALED)) { // also false for nan
+        return false;
+      }
+      *number = (long long) (value < 0 ? value - 0.5 : value + 0.5);
+      break;
+    }
+  }
+  if(end != text + length) {
+    return false;
+  }
+  const int len = columnar_render(column->spec, column->specifier, column->decimals, *number, rendered, sizeof(rendered));
+  return (size_t) len == length && !memcmp(rendered, s, length);
+}
+
+
+
+static uint32_t columnar_hash(const char *s, size_t length) {
+  uint32_t h = 2166136261u; // FNV-1a
+  while(length --) {
+    h = (h ^ (uint8_t) *s ++) * 16777619u;
+  }
+  return h;
+}
+
+static const char *columnar_string(const ColumnarEncoder *encoder, uint32_t index, size_t *length) {
+  const uint32_t start = read_u32(encoder->offsets.data + 4 * index);
+  const uint32_t end = index + 1 < encoder->string_count ? read_u32(encoder->offsets.data + 4 * (index + 1)) : (uint32_t) encoder->strings.length;
+  *length = end - start;
+  return (const char *) encoder->strings.data + start;
+}
+
+static bool columnar_grow_table(ColumnarEncoder *encoder) {
+  const size_t size = encoder->table_size ? 2 * encoder->table_size : 1024;
+  uint32_t *table = (uint32_t *) calloc(size, sizeof(uint32_t));
+  uint32_t i;
+  size_t length;
+
+  if(table == NULL) {
+    return false;
+  }
+  for(i = 0; i < encoder->string_count; i ++) {
+    const char *s = columnar_string(encoder, i, &length);
+    size_t slot = columnar_hash(s, length) & (size - 1);
+    while(table[slot] != 0) {
+      slot = (slot + 1) & (size - 1);
+    }
+    table[slot] = i + 1;
+  }
+  free(encoder->table);
+  encoder->table = table;
+  encoder->table_size = size;
+  return true;
+}
+
+/*
+ * return the index of the string in the dictionary, adding it if it is new.
+ */
+static uint32_t columnar_intern(ColumnarEncoder *encoder, const char *s, size_t length) {
+  uint8_t offset[4];
+  size_t slot, n;
+
+  if(2 * (encoder->string_count + 1) > encoder->table_size && !columnar_grow_table(encoder)) {
+    encoder->strings.failed = true;
+    return 0;
+  }
+  slot = columnar_hash(s, length) & (encoder->table_size - 1);
+  while(encoder->table[slot] != 0) {
+    const char *t = columnar_string(encoder, encoder->table[slot] - 1, &n);
+    if(n == length && !memcmp(s, t, n)) {
+      return encoder->table[slot] - 1;
+    }
+    slot = (slot + 1) & (encoder->table_size - 1);
+  }
+  write_u32(offset, (uint32_t) encoder->strings.length);
+  buffer_append(&encoder->offsets, offset, sizeof(offset));
+  buffer_append(&encoder->strings, s, length);
+  encoder->table[slot] = ++ encoder->string_count;
+  return encoder->string_count - 1;
+}
+
+
+
+static int columnar_hex_value(char c) {
+  if('0' <= c && c <= '9') return c - '0';
+  if('A' <= c && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+/*
+ * parse an entry that the logger writes exactly like this, with uppercase
+ * digits and no leading zeros in the ticks.
+ * return the length of the entry or zero if it is not such an entry.
+ */
+static size_t columnar_parse_entry(const char *src, size_t s_len, ColumnarEntry *entry) {
+  size_t i, start;
+  int v;
+
+  if(s_len < 7 || src[0] != '\n') {
+    return 0;
+  }
+  const char *end = (const char *) memchr(src + 1, '\n', s_len - 1);
+  if(end == NULL) {
+    return 0;
+  }
+  const size_t entry_len = end - src + 1;
+
+  entry->id = 0;
+  for(i = 1; i <= 4; i ++) {
+    if((v = columnar_hex_value(src[i])) < 0) {
+      return 0;
+    }
+    entry->id = (LogId) ((entry->id << 4) | v);
+  }
+  entry->has_time = src[5] == ':';
+  entry->delta = 0;
+  if(entry->has_time) {
+    for(i = 6; i < entry_len && (v = columnar_hex_value(src[i])) >= 0; i ++) {
+      entry->delta = (entry->delta << 4) | v;
+    }
+    if(i == 6 || i > 14 || (src[6] == '0' && i > 7)) {
+      return 0;
+    }
+  }
+  if(src[i] != '|') {
+    return 0;
+  }
+
+  entry->field_count = 0;
+  for(start = ++ i; i < entry_len - 1; i ++) {
+    if(src[i] == '|') {
+      if(entry->field_count == LOGGER_RECORD_MAX_FIELDS) {
+        return 0;
+      }
+      entry->fields[entry->field_count] = src + start;
+      entry->lengths[entry->field_count] = i - start;
+      entry->field_count ++;
+      start = i + 1;
+    }
+  }
+  return start == entry_len - 1 ? entry_len : 0; // the last parameter must end with '|'
+}
+
+/*
+ * return the index of the id, adding it with the formatting of its parameters,
+ * or -1 if the ids table is full.
+ */
+static int columnar_find_id(ColumnarEncoder *encoder, const ColumnarEntry *entry) {
+  char specs[LOGGER_RECORD_MAX_FIELDS][LOGGER_COLUMNAR_MAX_SPEC_SIZE];
+  size_t i;
+
+  for(i = 0; i < encoder->id_count; i ++) {
+    if(encoder->ids[i].id == entry->id) {
+      return (int) i;
+    }
+  }
+  if(encoder->id_count == LOGGER_COLUMNAR_MAX_IDS) {
+    return -1;
+  }
+
+  ColumnarId *id = &encoder->ids[encoder->id_count];
+  memset(id, 0, sizeof(*id));
+  id->id = entry->id;
+  id->usual_count = (uint8_t) entry->field_count;
+  memset(specs, 0, sizeof(specs));
+  const char *format = logger_formats_find(encoder->formats, entry->id);
+  if(format != NULL) {
+    columnar_find_specs(format, specs, LOGGER_RECORD_MAX_FIELDS);
+  }
+  for(i = 0; i < LOGGER_RECORD_MAX_FIELDS; i ++) {
+    Column *column = &id->columns[i];
+    columnar_parse_spec(specs[i], &column->specifier, &column->decimals);
+    if(column->specifier != 0) {
+      memcpy(column->spec, specs[i], sizeof(column->spec));
+    }
+  }
+  return (int) encoder->id_count ++;
+}
+
+static void columnar_add_value(ColumnarEncoder *encoder, Column *column, const char *s, size_t length) {
+  long long number;
+
+  if(columnar_get_number(column, s, length, &number)) {
+    const bool hexadecimal = column->specifier == 'x' || column->specifier == 'X';
+    buffer_append_varint(&column->data, (hexadecimal ? (uint64_t) (number ^ column->previous) : zigzag(number - column->previous)) << 1);
+    column->previous = number;
+  } else {
+    buffer_append_varint(&column->data, ((uint64_t) columnar_intern(encoder, s, length) << 1) | 1);
+  }
+}
+
+static void columnar_add_raw(ColumnarEncoder *encoder, const char *raw, size_t length) {
+  if(length > 0) {
+    buffer_append_varint(&encoder->spine, ((uint64_t) length << 1) | 1);
+    buffer_append(&encoder->spine, raw, length);
+    encoder->entry_count ++;
+  }
+}
+
+static void columnar_add_entry(ColumnarEncoder *encoder, int index, const ColumnarEntry *entry) {
+  ColumnarId *id = &encoder->ids[index];
+  const bool differs = entry->field_count != id->usual_count;
+  size_t i;
+
+  buffer_append_varint(&encoder->spine, (((uint64_t) index << 2) | (differs << 1) | entry->has_time) << 1);
+  if(entry->has_time) {
+    buffer_append_varint(&encoder->spine, entry->delta);
+  }
+  if(differs) {
+    buffer_append_varint(&encoder->spine, entry->field_count);
+  }
+  if(entry->field_count > id->column_count) {
+    id->column_count = (uint8_t) entry->field_count;
+  }
+  for(i = 0; i < entry->field_count; i ++) {
+    columnar_add_value(encoder, &id->columns[i], entry->fields[i], entry->lengths[i]);
+  }
+  encoder->entry_count ++;
+}
+
+static bool columnar_failed(const ColumnarEncoder *encoder) {
+  size_t i, j;
+  bool failed = encoder->spine.failed || encoder->strings.failed || encoder->offsets.failed;
+  for(i = 0; i < encoder->id_count; i ++) {
+    for(j = 0; j < encoder->ids[i].column_count; j ++) {
+      failed = failed || encoder->ids[i].columns[j].data.failed;
+    }
+  }
+  return failed;
+}
+
+static uint8_t *columnar_write(const ColumnarEncoder *encoder, size_t text_size, size_t *length) {
+  size_t i, j, size = LOGGER_COLUMNAR_HEADER_SIZE;
+
+  for(i = 0; i < encoder->id_count; i ++) {
+    size += 4;
+    for(j = 0; j < encoder->ids[i].column_count; j ++) {
+      size += 1 + strlen(encoder->ids[i].columns[j].spec) + 4 + encoder->ids[i].columns[j].data.length;
+    }
+  }
+  size += encoder->spine.length + 4 * (encoder->string_count + 1) + encoder->strings.length;
+
+  uint8_t *dst = (uint8_t *) malloc(size);
+  if(dst == NULL) {
+    return NULL;
+  }
+  uint8_t *p = dst;
+  memset(p, 0, LOGGER_COLUMNAR_HEADER_SIZE);
+  memcpy(p, COLUMNAR_MAGIC, sizeof(COLUMNAR_MAGIC));
+  p[4] = LOGGER_COLUMNAR_VERSION;
+  write_u32(p + 8, (uint32_t) text_size);
+  write_u32(p + 12, encoder->entry_count);
+  write_u32(p + 16, (uint32_t) encoder->id_count);
+  write_u32(p + 20, encoder->string_count);
+  write_u32(p + 24, (uint32_t) encoder->spine.length);
+  write_u32(p + 28, (uint32_t) encoder->strings.length);
+  p += LOGGER_COLUMNAR_HEADER_SIZE;
+
+  for(i = 0; i < encoder->id_count; i ++) {
+    const ColumnarId *id = &encoder->ids[i];
+    write_u16(p, id->id);
+    p[2] = id->usual_count;
+    p[3] = id->column_count;
+    p += 4;
+    for(j = 0; j < id->column_count; j ++) {
+      const size_t spec_len = strlen(id->columns[j].spec);
+      *p ++ = (uint8_t) spec_len;
+      memcpy(p, id->columns[j].spec, spec_len);
+      p += spec_len;
+      write_u32(p, (uint32_t) id->columns[j].data.length);
+      p += 4;
+    }
+  }
+  if(encoder->spine.length > 0) {
+    memcpy(p, encoder->spine.data, encoder->spine.length);
+    p += encoder->spine.length;
+  }
+  if(encoder->string_count > 0) {
+    memcpy(p, encoder->offsets.data, 4 * encoder->string_count);
+  }
+  write_u32(p + 4 * encoder->string_count, (uint32_t) encoder->strings.length);
+  p += 4 * (encoder->string_count + 1);
+  if(encoder->strings.length > 0) {
+    memcpy(p, encoder->strings.data, encoder->strings.length);
+    p += encoder->strings.length;
+  }
+  for(i = 0; i < encoder->id_count; i ++) {
+    for(j = 0; j < encoder->ids[i].column_count; j ++) {
+      const ByteBuffer *data = &encoder->ids[i].columns[j].data;
+      if(data->length > 0) {
+        memcpy(p, data->data, data->length);
+        p += data->length;
+      }
+    }
+  }
+
+  *length = size;
+  return dst;
+}
+
+static void columnar_free(ColumnarEncoder *encoder) {
+  size_t i, j;
+  for(i = 0; encoder->ids != NULL && i < encoder->id_count; i ++) {
+    for(j = 0; j < LOGGER_RECORD_MAX_FIELDS; j ++) {
+      free(encoder->ids[i].columns[j].data.data);
+    }
+  }
+  free(encoder->ids);
+  free(encoder->formats);
+  free(encoder->spine.data);
+  free(encoder->strings.data);
+  free(encoder->offsets.data);
+  free(encoder->table);
+}
+
+
+
+/*
+ * transcode an encoded log into a columnar archive. the formats of the ids are
+ * those of the logger (see logger_get_format), and the definitions of dynamic
+ * ids in the log are learned on the way in formats of the encoder.
+ * update length to the length of the archive.
+ * return the archive, which the caller frees, or NULL if there is not enough
+ * memory.
+ */
+uint8_t *logger_columnar_encode(const char *src, size_t s_len, size_t *length) {
+  ColumnarEncoder encoder;
+  ColumnarEntry entry;
+  size_t pos = 0, raw = 0, n;
+
+  if(s_len > 0xFFFFFFFFu) {
+    return NULL;
+  }
+  memset(&encoder, 0, sizeof(encoder));
+  encoder.ids = (ColumnarId *) malloc(LOGGER_COLUMNAR_MAX_IDS * sizeof(ColumnarId));
+  encoder.formats = (LoggerFormats *) malloc(sizeof(LoggerFormats));
+  if(encoder.ids == NULL || encoder.formats == NULL) {
+    columnar_free(&encoder);
+    return NULL;
+  }
+  logger_formats_init(encoder.formats);
+
+  while(pos < s_len) {
+    int index = -1;
+    if((n = columnar_parse_entry(src + pos, s_len - pos, &entry)) > 0) {
+      index = columnar_find_id(&encoder, &entry);
+    }
+    if(index < 0) { // raw text until the next '\n'
+      const char *next = (const char *) memchr(src + pos + 1, '\n', s_len - pos - 1);
+      pos = next != NULL ? (size_t) (next - src) : s_len;
+      continue;
+    }
+    if(entry.id == LOGGER_DEFINE_FORMAT) { // learn the format of a dynamic id
+      LoggerRecord record;
+      unsigned long long time = 0;
+      size_t unused;
+      logger_decode_record(&record, src + pos, n, &unused, &time, encoder.formats);
+    }
+    columnar_add_raw(&encoder, src + raw, pos - raw);
+    columnar_add_entry(&encoder, index, &entry);
+    pos += n;
+    raw = pos;
+  }
+  columnar_add_raw(&encoder, src + raw, pos - raw);
+
+  uint8_t *archive = columnar_failed(&encoder) ? NULL : columnar_write(&encoder, s_len, length);
+  columnar_free(&encoder);
+  return archive;
+}
+
+
+
+/*
+ * check the header and the sizes of the sections of the archive.
+ */
+static bool columnar_read_layout(ColumnarLayout *layout, const uint8_t *src, size_t s_len) {
+  const uint8_t *end = src + s_len;
+  size_t columns_len = 0;
+  uint32_t i, j;
+
+  if(s_len < LOGGER_COLUMNAR_HEADER_SIZE || memcmp(src, COLUMNAR_MAGIC, sizeof(COLUMNAR_MAGIC))
+      || src[4] != LOGGER_COLUMNAR_VERSION) {
+    return false;
+  }
+  layout->text_size = read_u32(src + 8);
+  layout->entry_count = read_u32(src + 12);
+  layout->id_count = read_u32(src + 16);
+  layout->string_count = read_u32(src + 20);
+  layout->spine_len = read_u32(src + 24);
+  const size_t strings_len = read_u32(src + 28);
+  if(layout->id_count > LOGGER_COLUMNAR_MAX_IDS) {
+    return false;
+  }
+
+  const uint8_t *p = layout->ids = src + LOGGER_COLUMNAR_HEADER_SIZE;
+  for(i = 0; i < layout->id_count; i ++) {
+    if(end - p < 4 || p[3] > LOGGER_RECORD_MAX_FIELDS) {
+      return false;
+    }
+    const uint8_t column_count = p[3];
+    p += 4;
+    for(j = 0; j < column_count; j ++) {
+      if(end - p < 1 || *p >= LOGGER_COLUMNAR_MAX_SPEC_SIZE || (size_t) (end - p) < 1u + *p + 4) {
+        return false;
+      }
+      p += 1 + *p;
+      columns_len += read_u32(p);
+      p += 4;
+    }
+  }
+  layout->spine = p;
+  layout->strings = p + layout->spine_len;
+  const size_t offsets_len = 4 * ((size_t) layout->string_count + 1);
+  if((size_t) (end - p) < layout->spine_len || (size_t) (end - layout->strings) < offsets_len
+      || read_u32(layout->strings + offsets_len - 4) != strings_len
+      || (size_t) (end - layout->strings) - offsets_len < strings_len) {
+    return false;
+  }
+  layout->columns = layout->strings + offsets_len + strings_len;
+  return (size_t) (end - layout->columns) >= columns_len;
+}
+
+static void columnar_cursor_setup(LoggerColumnarCursor *cursor, const ColumnarLayout *layout, const uint8_t *spec, const uint8_t *column, size_t column_len) {
+  memcpy(cursor->spec, spec + 1, spec[0]);
+  cursor->spec[spec[0]] = 0;
+  columnar_parse_spec(cursor->spec, &cursor->specifier, &cursor->decimals);
+  cursor->position = column;
+  cursor->end = column + column_len;
+  cursor->strings = layout->strings;
+  cursor->string_count = layout->string_count;
+  cursor->previous = 0;
+}
+
+/*
+ * return false if the archive is not valid.
+ */
+bool logger_columnar_read_header(const uint8_t *src, size_t s_len, size_t *text_size) {
+  ColumnarLayout layout;
+  if(!columnar_read_layout(&layout, src, s_len)) {
+    return false;
+  }
+  *text_size = layout.text_size;
+  return true;
+}
+
+/*
+ * set the cursor to the values of a parameter of an id; field is the index of
+ * the parameter.
+ * return false if the archive is not valid or has no such parameter.
+ */
+bool logger_columnar_cursor_init(LoggerColumnarCursor *cursor, const uint8_t *src, size_t s_len, LogId id, size_t field) {
+  ColumnarLayout layout;
+  const uint8_t *column;
+  uint32_t i, j;
+
+  if(!columnar_read_layout(&layout, src, s_len)) {
+    return false;
+  }
+  const uint8_t *p = layout.ids;
+  for(column = layout.columns, i = 0; i < layout.id_count; i ++) {
+    const bool found = read_u16(p) == id;
+    const uint8_t column_count = p[3];
+    p += 4;
+    for(j = 0; j < column_count; j ++) {
+      const uint8_t *spec = p;
+      p += 1 + *p;
+      const size_t column_len = read_u32(p);
+      p += 4;
+      if(found && j == field) {
+        columnar_cursor_setup(cursor, &layout, spec, column, column_len);
+        return true;
+      }
+      column += column_len;
+    }
+  }
+  return false;
+}
+
+/*
+ * read the next value of the column.
+ * return false at the end of the column or if the value is not valid.
+ */
+bool logger_columnar_cursor_next(LoggerColumnarCursor *cursor, LoggerColumnarValue *value) {
+  uint64_t v;
+
+  if(cursor->position == cursor->end || !read_varint(&cursor->position, cursor->end, &v)) {
+    return false;
+  }
+  if(v & 1) {
+    const uint64_t index = v >> 1;
+    if(index >= cursor->string_count) {
+      return false;
+    }
+    const uint8_t *bytes = cursor->strings + 4 * ((size_t) cursor->string_count + 1);
+    const uint32_t start = read_u32(cursor->strings + 4 * index);
+    const uint32_t end = read_u32(cursor->strings + 4 * (index + 1));
+    if(start > end || end > read_u32(cursor->strings + 4 * (size_t) cursor->string_count)) {
+      return false;
+    }
+    value->is_number = false;
+    value->string = (const char *) bytes + start;
+    value->length = end - start;
+    return true;
+  }
+  if(cursor->specifier == 0) {
+    return false;
+  }
+  if(cursor->specifier == 'x' || cursor->specifier == 'X') {
+    cursor->previous ^= (long long) (v >> 1);
+  } else {
+    cursor->previous += unzigzag(v >> 1);
+  }
+  value->is_number = true;
+  value->number = cursor->previous;
+  value->decimals = cursor->decimals;
+  return true;
+}
+
+/*
+ * restore the encoded log of the archive.
+ * return the length of the log or zero if the archive is not valid or the
+ * destination is too small.
+ */
+size_t logger_columnar_decode(char *dst, size_t d_len, const uint8_t *src, size_t s_len) {
+  ColumnarLayout layout;
+  LoggerColumnarValue value;
+  size_t first_column[LOGGER_COLUMNAR_MAX_IDS + 1];
+  uint8_t usual_counts[LOGGER_COLUMNAR_MAX_IDS];
+  LogId ids[LOGGER_COLUMNAR_MAX_IDS];
+  char number[MAX_NUMBER_SIZE];
+  size_t len = 0, n, k;
+  uint32_t i, j;
+  uint64_t tag;
+
+  if(!columnar_read_layout(&layout, src, s_len) || layout.text_size > d_len) {
+    return 0;
+  }
+
+  // a cursor per column
+  const uint8_t *p = layout.ids;
+  first_column[0] = 0;
+  for(i = 0; i < layout.id_count; i ++) {
+    ids[i] = read_u16(p);
+    usual_counts[i] = p[2];
+    first_column[i + 1] = first_column[i] + p[3];
+    for(j = 0, p += 4; j < first_column[i + 1] - first_column[i]; j ++) {
+      p += 1 + *p + 4;
+    }
+  }
+  LoggerColumnarCursor *cursors = (LoggerColumnarCursor *) malloc((first_column[layout.id_count] + 1) * sizeof(LoggerColumnarCursor));
+  if(cursors == NULL) {
+    return 0;
+  }
+  const uint8_t *column = layout.columns;
+  for(p = layout.ids, i = 0; i < layout.id_count; i ++) {
+    p += 4;
+    for(k = first_column[i]; k < first_column[i + 1]; k ++) {
+      const uint8_t *spec = p;
+      p += 1 + *p;
+      const size_t column_len = read_u32(p);
+      p += 4;
+      columnar_cursor_setup(&cursors[k], &layout, spec, column, column_len);
+      column += column_len;
+    }
+  }
+
+  const uint8_t *spine = layout.spine;
+  const uint8_t *spine_end = spine + layout.spine_len;
+  bool valid = true;
+  for(i = 0; valid && i < layout.entry_count; i ++) {
+    if(!read_varint(&spine, spine_end, &tag)) {
+      valid = false;
+      break;
+    }
+    if(tag & 1) { // raw text
+      n = (size_t) (tag >> 1);
+      valid = n <= (size_t) (spine_end - spine) && n <= layout.text_size - len;
+      if(valid) {
+        memcpy(dst + len, spine, n);
+        spine += n;
+        len += n;
+      }
+      continue;
+    }
+
+    const size_t index = (size_t) (tag >> 3);
+    const bool has_time = (tag >> 1) & 1;
+    const bool differs = (tag >> 2) & 1;
+    uint64_t delta = 0, field_count = 0;
+    if(index >= layout.id_count || (has_time && !read_varint(&spine, spine_end, &delta))
+        || (differs && !read_varint(&spine, spine_end, &field_count))) {
+      valid = false;
+      break;
+    }
+    if(!differs) {
+      field_count = usual_counts[index];
+    }
+    if(field_count > first_column[index + 1] - first_column[index]) {
+      valid = false;
+      break;
+    }
+    if(has_time) {
+      n = snprintf(number, sizeof(number), "\n%04X:%lX|", ids[index], (unsigned long) delta);
+    } else {
+      n = snprintf(number, sizeof(number), "\n%04X|", ids[index]);
+    }
+    valid = n <= layout.text_size - len;
+    if(valid) {
+      memcpy(dst + len, number, n);
+      len += n;
+    }
+    for(k = 0; valid && k < field_count; k ++) {
+      LoggerColumnarCursor *cursor = &cursors[first_column[index] + k];
+      valid = logger_columnar_cursor_next(cursor, &value);
+      if(!valid) {
+        break;
+      }
+      const char *text = value.string;
+      n = value.length;
+      if(value.is_number) {
+        n = columnar_render(cursor->spec, cursor->specifier, cursor->decimals, value.number, number, sizeof(number));
+        text = number;
+      }
+      valid = n + 1 <= layout.text_size - len;
+      if(valid) {
+        memcpy(dst + len, text, n);
+        dst[len + n] = '|';
+        len += n + 1;
+      }
+    }
+    valid = valid && len < layout.text_size;
+    if(valid) {
+      dst[len ++] = '\n';
+    }
+  }
+  free(cursors);
+
+  return valid && len == layout.text_size ? len : 0;
+}
@@ -0,0 +1,51 @@
+#ifndef LOGGER_COLUMNAR_H_
+#define LOGGER_COLUMNAR_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "logger.h"
+
+#define LOGGER_COLUMNAR_VERSION 1
+#define LOGGER_COLUMNAR_HEADER_SIZE 32
+#define LOGGER_COLUMNAR_MAX_IDS 256      // entries of other ids are kept as raw text
+#define LOGGER_COLUMNAR_MAX_SPEC_SIZE 12 // like MAX_LOG_FORMATTING_SIZE of the logger
+
+// a value of a column: a number or a string of the dictionary
+typedef struct {
+  bool is_number;
+  long long number;      // a float is scaled by 10^decimals
+  unsigned int decimals;
+  const char *string;    // points into the archive, it is not null terminated
+  size_t length;
+} LoggerColumnarValue;
+
+// reads the values of one parameter of one id without reading the others
+typedef struct {
+  const uint8_t *position;
+  const uint8_t *end;
+  const uint8_t *strings;        // offsets of the strings of the dictionary
+  uint32_t string_count;
+  char spec[LOGGER_COLUMNAR_MAX_SPEC_SIZE]; // formatting of the parameter
+  char specifier;                // 0 if the parameter is not a number
+  unsigned int decimals;
+  long long previous;
+} LoggerColumnarCursor;
+
+uint8_t *logger_columnar_encode(const char *src, size_t s_len, size_t *length);
+bool logger_columnar_read_header(const uint8_t *src, size_t s_len, size_t *text_size);
+size_t logger_columnar_decode(char *dst, size_t d_len, const uint8_t *src, size_t s_len);
+
+bool logger_columnar_cursor_init(LoggerColumnarCursor *cursor, const uint8_t *src, size_t s_len, LogId id, size_t field);
+bool logger_columnar_cursor_next(LoggerColumnarCursor *cursor, LoggerColumnarValue *value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOGGER_COLUMNAR_H_
@@ -0,0 +1,475 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "logger.h"
+#include "logger_formatdb.h"
+
+/*
+ * a format database holds the ids of a logger.defs so a decoder that was not
+ * built with them can decode the logs of that firmware. it is generated from
+ * the text of logger.defs and it is used where it is, in a buffer or a mapped
+ * file: opening it only checks the header and the sizes of the tables, and
+ * every lookup is a binary search in the sorted ids that checks the offsets
+ * it reads. the formats are checked when the database is built, so they
+ * only use the formatting of the logger.
+ *
+ * header: "LGFD", version (u16 LE), header size (u16 LE), firmware, id count,
+ *         pool size, checksum of what follows the header, 0 (u32 LE)
+ * ids:    id, parameter count (u16 LE), offset of the name, offset and length
+ *         of the format (u32 LE)
+ * pool:   the null terminated names and formats
+ */
+
+static const char FORMATDB_MAGIC[4] = { 'L', 'G', 'F', 'D' };
+
+#define MAX_FORMAT_LENGTH 0xFFFF
+
+typedef struct {
+  char *data;
+  size_t length;
+  size_t capacity;
+  bool failed;
+} FormatDbPool;
+
+typedef struct {
+  LogId id;
+  uint32_t name;   // offsets in the pool
+  uint32_t format;
+  uint32_t format_length;
+  size_t line;
+} FormatDbDefinition;
+
+
+
+static void write_u16(uint8_t *dst, uint16_t value) {
+  dst[0] = (uint8_t) value;
+  dst[1] = (uint8_t) (value >> 8);
+}
+
+static void write_u32(uint8_t *dst, uint32_t value) {
+  write_u16(dst, (uint16_t) value);
+  write_u16(dst + 2, (uint16_t) (value >> 16));
+}
+
+static uint16_t read_u16(const uint8_t *src) {
+  return (uint16_t) (src[0] | (src[1] << 8));
+}
+
+static uint32_t read_u32(const uint8_t *src) {
+  return read_u16(src) | ((uint32_t) read_u16(src + 2) << 16);
+}
+
+static uint32_t formatdb_checksum(const uint8_t *data, size_t length) {
+  uint32_t h = 2166136261u; // FNV-1a
+  size_t i;
+  for(i = 0; i < length; i ++) {
+    h = (h ^ data[i]) * 16777619u;
+  }
+  return h;
+}
+
+
+
+static void pool_append(FormatDbPool *pool, char c) {
+  if(pool->failed) {
+    return;
+  }
+  if(pool->length == pool->capacity) {
+    size_t capacity = pool->capacity ? 2 * pool->capacity : 4096;
+    char *data = (char *) realloc(pool->data, capacity);
+    if(data == NULL) {
+      pool->failed = true;
+      return;
+    }
+    pool->data = data;
+    pool->capacity = capacity;
+  }
+  pool->data[pool->length ++] = c;
+}
+
+static const char *formatdb_skip_spaces(const char *s, const char *end) {
+  while(s < end && (*s == ' ' || *s == '\t' || *s == '\r')) {
+    s ++;
+  }
+  return s;
+}
+
+/*
+ * append the characters of one or more adjacent string literals to the pool
+ * without the quotes and with the escape sequences replaced.
+ * return the position after the last literal or NULL if it is not valid.
+ */
+static const char *formatdb_parse_string(FormatDbPool *pool, const char *s, const char *end) {
+  const char *escapes = "n\nt\tr\r\\\\\"\"''";
+  const char *e;
+
+  if(s == end || *s != '"') {
+    return NULL;
+  }
+  while(s < end && *s == '"') {
+    for(s ++; s < end && *s != '"'; s ++) {
+      if(*s == '\n') {
+        return NULL;
+      }
+      if(*s != '\\') {
+        pool_append(pool, *s);
+        continue;
+      }
+      if(++ s == end) {
+        return NULL;
+      }
+      for(e = escapes; *e != 0 && *e != *s; e += 2) {
+      }
+      if(*e == 0) {
+        return NULL; // numeric escapes are not supported
+      }
+      pool_append(pool, e[1]);
+    }
+    if(s == end) {
+      return NULL;
+    }
+    s = formatdb_skip_spaces(s + 1, end);
+  }
+  pool_append(pool, 0);
+  return s;
+}
+
+/*
+ * parse LOG_ENTRY(name, value, "format") at the start of a line.
+ * return false if it is not valid.
+ */
+static bool formatdb_parse_entry(FormatDbPool *pool, FormatDbDefinition *definition, const char *s, const char *end) {
+  static const char L_PREFIX[] = "LOG_ENTRY(";
+  const size_t prefix_len = sizeof(L_PREFIX) - 1;
+  char value[16];
+  char *value_end;
+  size_t n;
+
+  s = formatdb_skip_spaces(s + prefix_len, end);
+  definition->name = (uint32_t) pool->length;
+  for(n = 0; s < end && (isalnum((unsigned char) *s) || *s == '_'); n ++) {
+    pool_append(pool, *s ++);
+  }
+  pool_append(pool, 0);
+  s = formatdb_skip_spaces(s, end);
+  if(n == 0 || s == end || *s != ',') {
+    return false;
+  }
+
+  s = formatdb_skip_spaces(s + 1, end);
+  for(n = 0; s < end && isalnum((unsigned char) *s) && n < sizeof(value) - 1; n ++) {
+    value[n] = *s ++;
+  }
+  value[n] = 0;
+  const unsigned long id = strtoul(value, &value_end, 0);
+  s = formatdb_skip_spaces(s, end);
+  if(n == 0 || *value_end != 0 || id > 0xFFFF || s == end || *s != ',') {
+    return false;
+  }
+  definition->id = (LogId) id;
+
+  definition->format = (uint32_t) pool->length;
+  if((s = formatdb_parse_string(pool, formatdb_skip_spaces(s + 1, end), end)) == NULL || s == end || *s != ')') {
+    return false;
+  }
+  definition->format_length = (uint32_t) (pool->length - 1 - definition->format);
+  return definition->format_length <= MAX_FORMAT_LENGTH;
+}
+
+/*
+ * find the next specifier of the format like the logger does.
+ * return its length, zero if there are no more specifiers or -1 if the
+ * formatting is not supported.
+ */
+static long formatdb_next_specifier(const char **format) {
+  const char *pos = strchr(*format, '%');
+  long len;
+
+  while(pos != NULL && pos[1] == '%') { // skip "%%"
+    pos = strchr(pos + 2, '%');
+  }
+  if(pos == NULL) {
+    return 0;
+  }
+  for(len = 1; pos[len] != 0 && strchr("+- #.0123456789l", pos[len]) != NULL; len ++) {
+  }
+  if(pos[len] == 0 || strchr("diuxXfFcsp", pos[len]) == NULL) {
+    return -1;
+  }
+  *format = pos;
+  return len + 1;
+}
+
+static int formatdb_compare(const void *a, const void *b) {
+  const FormatDbDefinition *da = (const FormatDbDefinition *) a;
+  const FormatDbDefinition *db = (const FormatDbDefinition *) b;
+  return (int) da->id - (int) db->id;
+}
+
+/*
+ * check that the specifiers of every format are supported.
+ * return false and set error_line if one is not.
+ */
+static bool formatdb_check_formats(const FormatDbPool *pool, const FormatDbDefinition *definitions, size_t count, size_t *error_line) {
+  size_t i;
+  long len;
+
+  for(i = 0; i < count; i ++) {
+    const char *fmt = pool->data + definitions[i].format;
+    uint32_t fields = 0;
+    while((len = formatdb_next_specifier(&fmt)) > 0 && len <= 0xFF) {
+      fmt += len;
+      fields ++;
+    }
+    if(len != 0 || fields > 0xFFFF) {
+      *error_line = definitions[i].line;
+      return false;
+    }
+  }
+  return true;
+}
+
+static uint8_t *formatdb_write(const FormatDbPool *pool, const FormatDbDefinition *definitions, size_t count, uint32_t firmware, size_t *length) {
+  const size_t size = LOGGER_FORMATDB_HEADER_SIZE + count * LOGGER_FORMATDB_ID_SIZE + pool->length;
+  uint8_t *db = (uint8_t *) malloc(size);
+  size_t i;
+  long len;
+
+  if(db == NULL) {
+    return NULL;
+  }
+  uint8_t *id = db + LOGGER_FORMATDB_HEADER_SIZE;
+  for(i = 0; i < count; i ++) {
+    const char *fmt = pool->data + definitions[i].format;
+    uint16_t fields = 0;
+
+    while((len = formatdb_next_specifier(&fmt)) > 0) {
+      fmt += len;
+      fields ++;
+    }
+    write_u16(id, definitions[i].id);
+    write_u16(id + 2, fields);
+    write_u32(id + 4, definitions[i].name);
+    write_u32(id + 8, definitions[i].format);
+    write_u32(id + 12, definitions[i].format_length);
+    id += LOGGER_FORMATDB_ID_SIZE;
+  }
+  memcpy(id, pool->data, pool->length);
+
+  memcpy(db, FORMATDB_MAGIC, sizeof(FORMATDB_MAGIC));
+  write_u16(db + 4, LOGGER_FORMATDB_VERSION);
+  write_u16(db + 6, LOGGER_FORMATDB_HEADER_SIZE);
+  write_u32(db + 8, firmware);
+  write_u32(db + 12, (uint32_t) count);
+  write_u32(db + 16, (uint32_t) pool->length);
+  write_u32(db + 20, formatdb_checksum(db + LOGGER_FORMATDB_HEADER_SIZE, size - LOGGER_FORMATDB_HEADER_SIZE));
+  write_u32(db + 24, 0);
+  *length = size;
+  return db;
+}
+
+/*
+ * parse the lines of the defs that start with LOG_ENTRY( and skip the others
+ * and the comments.
+ * return false and set error_line if an entry is not valid.
+ */
+static bool formatdb_parse_defs(FormatDbPool *pool, FormatDbDefinition **definitions, size_t *count, const char *defs, size_t defs_len, size_t *error_line) {
+  const char *s = defs, *end = defs + defs_len;
+  size_t capacity = 0, line = 0;
+  bool in_comment = false;
+
+  while(s < end) {
+    const char *next = (const char *) memchr(s, '\n', end - s);
+    const char *line_end = next != NULL ? next : end;
+    const char *t = formatdb_skip_spaces(s, line_end);
+    line ++;
+
+    if(in_comment || (line_end - t >= 2 && !strncmp(t, "/*", 2))) {
+      for(t = in_comment ? t : t + 2; t + 1 < line_end && strncmp(t, "*/", 2); t ++) {
+      }
+      in_comment = t + 1 >= line_end;
+    } else if(line_end - t >= 10 && !strncmp(t, "LOG_ENTRY(", 10)) {
+      if(*count == capacity) {
+        capacity = capacity ? 2 * capacity : 256;
+        FormatDbDefinition *p = (FormatDbDefinition *) realloc(*definitions, capacity * sizeof(FormatDbDefinition));
+        if(p == NULL) {
+          return false;
+        }
+        *definitions = p;
+      }
+      (*definitions)[*count].line = line;
+      if(!formatdb_parse_entry(pool, &(*definitions)[*count], t, line_end)) {
+        *error_line = line;
+        return false;
+      }
+      (*count) ++;
+    }
+    s = line_end + 1;
+  }
+  return !pool->failed && pool->length <= 0xFFFFFFFFu;
+}
+
+/*
+ * sort the definitions by id.
+ * return false and set error_line if an id is defined twice.
+ */
+static bool formatdb_sort(FormatDbDefinition *definitions, size_t count, size_t *error_line) {
+  size_t i;
+
+  qsort(definitions, count, sizeof(FormatDbDefinition), formatdb_compare);
+  for(i = 1; i < count; i ++) {
+    if(definitions[i].id == definitions[i - 1].id) {
+      *error_line = definitions[i].line > definitions[i - 1].line ? definitions[i].line : definitions[i - 1].line;
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * build a format database from the text of a logger.defs for a version of a
+ * firmware. the ids must be unique and their formats must only use the
+ * formatting of the logger.
+ * update length to the size of the database. set error_line to the line of
+ * the first error, or zero if there is not enough memory.
+ * return the database that the caller frees or NULL in case of error.
+ */
+uint8_t *logger_formatdb_build(const char *defs, size_t defs_len, uint32_t firmware, size_t *length, size_t *error_line) {
+  FormatDbDefinition *definitions = NULL;
+  FormatDbPool pool;
+  size_t count = 0;
+  uint8_t *db = NULL;
+
+  memset(&pool, 0, sizeof(pool));
+  *error_line = 0;
+  if(formatdb_parse_defs(&pool, &definitions, &count, defs, defs_len, error_line)
+      && formatdb_sort(definitions, count, error_line)
+      && formatdb_check_formats(&pool, definitions, count, error_line)) {
+    db = formatdb_write(&pool, definitions, count, firmware, length);
+  }
+  free(definitions);
+  free(pool.data);
+  return db;
+}
+
+
+
+/*
+ * open a database in a buffer that stays valid while it is used. only the
+ * header and the sizes of the tables are checked, the lookups check what they
+ * read.
+ * return false if it is not a database of this version.
+ */
+bool logger_formatdb_open(LoggerFormatDb *db, const uint8_t *data, size_t length) {
+  if(length < LOGGER_FORMATDB_HEADER_SIZE || memcmp(data, FORMATDB_MAGIC, sizeof(FORMATDB_MAGIC))
+      || read_u16(data + 4) != LOGGER_FORMATDB_VERSION || read_u16(data + 6) != LOGGER_FORMATDB_HEADER_SIZE) {
+    return false;
+  }
+  db->id_count = read_u32(data + 12);
+  db->pool_size = read_u32(data + 16);
+  const unsigned long long size = LOGGER_FORMATDB_HEADER_SIZE + (unsigned long long) db->id_count * LOGGER_FORMATDB_ID_SIZE + db->pool_size;
+  if(size != length || db->pool_size == 0 || data[length - 1] != 0) {
+    return false;
+  }
+  db->data = data;
+  db->length = length;
+  db->firmware = read_u32(data + 8);
+  db->ids = data + LOGGER_FORMATDB_HEADER_SIZE;
+  db->pool = (const char *) db->ids + (size_t) db->id_count * LOGGER_FORMATDB_ID_SIZE;
+  return true;
+}
+
+/*
+ * return true if the checksum of the database is right. it reads the whole
+ * database, so it is meant for when a database is installed and not for
+ * every start.
+ */
+bool logger_formatdb_verify(const LoggerFormatDb *db) {
+  return read_u32(db->data + 20) == formatdb_checksum(db->data + LOGGER_FORMATDB_HEADER_SIZE, db->length - LOGGER_FORMATDB_HEADER_SIZE);
+}
+
+/*
+ * map a database file read only and open it. the pages are shared by all the
+ * processes that map the same file and are only read when they are used.
+ * return false if the file cannot be mapped or it is not a database.
+ */
+bool logger_formatdb_map(LoggerFormatDb *db, const char *path) {
+  struct stat st;
+  void *data;
+
+  const int fd = open(path, O_RDONLY);
+  if(fd < 0) {
+    return false;
+  }
+  if(fstat(fd, &st) < 0 || st.st_size < LOGGER_FORMATDB_HEADER_SIZE) {
+    close(fd);
+    return false;
+  }
+  data = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(data == MAP_FAILED) {
+    return false;
+  }
+  if(!logger_formatdb_open(db, (const uint8_t *) data, (size_t) st.st_size)) {
+    munmap(data, (size_t) st.st_size);
+    return false;
+  }
+  return true;
+}
+
+void logger_formatdb_unmap(LoggerFormatDb *db) {
+  munmap((void *) db->data, db->length);
+  db->data = NULL;
+  db->length = 0;
+  db->id_count = 0;
+}
+
+/*
+ * find an id with a binary search and set the entry to it.
+ * return false if the id is not in the database or its record is not valid.
+ */
+bool logger_formatdb_find(const LoggerFormatDb *db, LogId id, LoggerFormatDbEntry *entry) {
+  uint32_t low = 0, high = db->id_count;
+
+  while(low < high) {
+    const uint32_t middle = low + (high - low) / 2;
+    const uint8_t *record = db->ids + (size_t) middle * LOGGER_FORMATDB_ID_SIZE;
+    const LogId middle_id = read_u16(record);
+
+    if(middle_id < id) {
+      low = middle + 1;
+    } else if(middle_id > id) {
+      high = middle;
+    } else {
+      const uint32_t name = read_u32(record + 4);
+      const uint32_t format = read_u32(record + 8);
+      const uint32_t format_length = read_u32(record + 12);
+      if(name >= db->pool_size || format >= db->pool_size || format_length >= db->pool_size - format
+          || db->pool[format + format_length] != 0) {
+        return false;
+      }
+      entry->id = id;
+      entry->name = db->pool + name;
+      entry->format = db->pool + format;
+      entry->format_length = format_length;
+      entry->field_count = read_u16(record + 2);
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+ * a LogFormatResolver for logger_set_format_resolver or
+ * logger_decoder_set_format_resolver whose context is a LoggerFormatDb.
+ */
+const char *logger_formatdb_resolve(void *db, LogId id) {
+  LoggerFormatDbEntry entry;
+  return logger_formatdb_find((const LoggerFormatDb *) db, id, &entry) ? entry.format : NULL;
+}
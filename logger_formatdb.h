@@ -0,0 +1,52 @@
+#ifndef LOGGER_FORMATDB_H_
+#define LOGGER_FORMATDB_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "logger.h"
+
+#define LOGGER_FORMATDB_VERSION 2
+#define LOGGER_FORMATDB_HEADER_SIZE 28
+#define LOGGER_FORMATDB_ID_SIZE 16
+
+// a format database that points into a buffer or a mapped file, nothing is copied
+typedef struct {
+  const uint8_t *data;
+  size_t length;
+  uint32_t firmware;           // version of the firmware given to the generator
+  uint32_t id_count;
+  const uint8_t *ids;          // sorted by id
+  const char *pool;            // null terminated names and formats
+  uint32_t pool_size;
+} LoggerFormatDb;
+
+// an id of the database
+typedef struct {
+  LogId id;
+  const char *name;
+  const char *format;
+  size_t format_length;
+  size_t field_count;
+} LoggerFormatDbEntry;
+
+uint8_t *logger_formatdb_build(const char *defs, size_t defs_len, uint32_t firmware, size_t *length, size_t *error_line);
+
+bool logger_formatdb_open(LoggerFormatDb *db, const uint8_t *data, size_t length);
+bool logger_formatdb_verify(const LoggerFormatDb *db);
+bool logger_formatdb_map(LoggerFormatDb *db, const char *path);
+void logger_formatdb_unmap(LoggerFormatDb *db);
+
+bool logger_formatdb_find(const LoggerFormatDb *db, LogId id, LoggerFormatDbEntry *entry);
+const char *logger_formatdb_resolve(void *db, LogId id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOGGER_FORMATDB_H_
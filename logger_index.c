@@ -0,0 +1,329 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "logger.h"
+#include "logger_index.h"
+
+/*
+ * the index keeps a small summary for every compressed packet: the range of
+ * ids and a bloom filter of the ids of the entries that start in that packet.
+ *
+ * packets are compressed independently (the dictionary is reset at every
+ * packet boundary), so a query only needs to decompress the packets whose
+ * summary may contain the requested ids. an entry belongs to the packet in
+ * which its first '\n' is written; the last entry of a packet may continue in
+ * the next packet, so the caller decompresses the next packet as well and
+ * passes the length of the owning packet's text as owned_len.
+ *
+ * the time of timestamped entries is the sum of the ticks of all the entries
+ * before them, so every packet also keeps the time of the log before its first
+ * entry and the selection adds the ticks of the entries it skips. the time is
+ * absolute from the first anchor of the log on.
+ *
+ * a packet is also flagged when it has definitions of dynamic ids
+ * (LOGGER_DEFINE_FORMAT), which are usually in other packets than the entries
+ * of the ids. a query of dynamic ids decompresses the flagged packets as well
+ * so the selection learns the formats.
+ */
+
+static const char INDEX_MAGIC[4] = { 'L', 'G', 'I', 'X' };
+static const uint8_t INDEX_VERSION = 3;
+
+
+
+static void write_u16(uint8_t *dst, uint16_t value) {
+  dst[0] = (uint8_t) value;
+  dst[1] = (uint8_t) (value >> 8);
+}
+
+static void write_u32(uint8_t *dst, uint32_t value) {
+  write_u16(dst, (uint16_t) value);
+  write_u16(dst + 2, (uint16_t) (value >> 16));
+}
+
+static uint16_t read_u16(const uint8_t *src) {
+  return (uint16_t) (src[0] | (src[1] << 8));
+}
+
+static uint32_t read_u32(const uint8_t *src) {
+  return read_u16(src) | ((uint32_t) read_u16(src + 2) << 16);
+}
+
+static void write_u64(uint8_t *dst, uint64_t value) {
+  write_u32(dst, (uint32_t) value);
+  write_u32(dst + 4, (uint32_t) (value >> 32));
+}
+
+static uint64_t read_u64(const uint8_t *src) {
+  return read_u32(src) | ((uint64_t) read_u32(src + 4) << 32);
+}
+
+
+
+static void logger_index_filter_bits(LogId id, unsigned int *bit1, unsigned int *bit2) {
+  uint32_t h = id * 2654435761u;
+  *bit1 = (h >> 24) % LOGGER_INDEX_FILTER_BITS;
+  *bit2 = (h >> 16) % LOGGER_INDEX_FILTER_BITS;
+}
+
+static bool logger_index_filter_test(const LoggerIndexPacket *packet, LogId id) {
+  unsigned int bit1, bit2;
+  logger_index_filter_bits(id, &bit1, &bit2);
+  return (packet->filter[bit1 / 8] & (1 << (bit1 % 8)))
+      && (packet->filter[bit2 / 8] & (1 << (bit2 % 8)));
+}
+
+static int logger_index_hex_value(char c) {
+  if('0' <= c && c <= '9') return c - '0';
+  if('A' <= c && c <= 'F') return c - 'A' + 10;
+  if('a' <= c && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+/*
+ * header points to "\nXXXX|" or to "\nXXXX:" or "\nXXXX@" for timestamped entries.
+ * return true and set id if the header is a valid encoded entry header.
+ */
+static bool logger_index_parse_header(const char *header, LogId *id) {
+  int i, v;
+  uint16_t value = 0;
+
+  if(header[0] != '\n' || (header[5] != '|' && header[5] != ':' && header[5] != '@')) {
+    return false;
+  }
+  for(i = 1; i <= 4; i ++) {
+    v = logger_index_hex_value(header[i]);
+    if(v < 0) {
+      return false;
+    }
+    value = (uint16_t) ((value << 4) | v);
+  }
+  *id = value;
+  return true;
+}
+
+static bool logger_index_ranges_contain(const LoggerIdRange *ranges, size_t range_count, LogId id) {
+  size_t i;
+  for(i = 0; i < range_count; i ++) {
+    if(ranges[i].first <= id && id <= ranges[i].last) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+
+void logger_index_packet_init(LoggerIndexPacket *packet) {
+  memset(packet, 0, sizeof(*packet));
+  packet->min_id = 0xFFFF;
+  packet->max_id = 0;
+}
+
+void logger_index_packet_add_id(LoggerIndexPacket *packet, LogId id) {
+  unsigned int bit1, bit2;
+  logger_index_filter_bits(id, &bit1, &bit2);
+  packet->filter[bit1 / 8] |= (uint8_t) (1 << (bit1 % 8));
+  packet->filter[bit2 / 8] |= (uint8_t) (1 << (bit2 % 8));
+
+  if(id == LOGGER_DEFINE_FORMAT) packet->has_definitions = true;
+  if(id < packet->min_id) packet->min_id = id;
+  if(id > packet->max_id) packet->max_id = id;
+  if(packet->count < 0xFFFF) packet->count ++;
+}
+
+/*
+ * return false only if no id in [first, last] is in the packet.
+ * small ranges are checked id by id against the filter, larger ranges only
+ * against the minimum and maximum ids.
+ */
+bool logger_index_packet_may_contain(const LoggerIndexPacket *packet, LogId first, LogId last) {
+  const unsigned long L_MAX_FILTERED_RANGE = 64;
+  unsigned long id;
+
+  if(packet->count == 0 || last < packet->min_id || first > packet->max_id) {
+    return false;
+  }
+  if(first < packet->min_id) first = packet->min_id;
+  if(last > packet->max_id) last = packet->max_id;
+
+  if((unsigned long) (last - first) >= L_MAX_FILTERED_RANGE) {
+    return true;
+  }
+  for(id = first; id <= last; id ++) {
+    if(logger_index_filter_test(packet, (LogId) id)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+
+void logger_index_builder_init(LoggerIndexBuilder *builder) {
+  memset(builder, 0, sizeof(*builder));
+}
+
+/*
+ * a header starts at a '\n' of the packet. the packet gets the time when
+ * its first header starts, after the headers of the previous packets ended.
+ */
+static void logger_index_builder_start_header(LoggerIndexBuilder *builder, LoggerIndexPacket *packet) {
+  if(!packet->has_time) {
+    packet->time = builder->time;
+    packet->has_time = true;
+  }
+  builder->header[0] = '\n';
+  builder->header_len = 1;
+  builder->in_delta = false;
+  builder->packet = packet;
+}
+
+/*
+ * scan the decompressed text of a packet and add the ids of the entries that
+ * start in it to the packet summary. the text of consecutive packets must be
+ * scanned in order because a header may be split between two packets.
+ */
+void logger_index_builder_scan(LoggerIndexBuilder *builder, LoggerIndexPacket *packet, const char *text, size_t len) {
+  const size_t L_MAX_DELTA_DIGITS = 8;
+  const char *end = text + len;
+  LogId id;
+
+  while(text < end) {
+    if(builder->header_len == 0) {
+      text = (const char *) memchr(text, '\n', end - text);
+      if(text == NULL) {
+        break;
+      }
+      text ++;
+      logger_index_builder_start_header(builder, packet);
+      continue;
+    }
+
+    char c = *text ++;
+    if(c == '\n') { // restart from this '\n'
+      logger_index_builder_start_header(builder, packet);
+      continue;
+    }
+
+    if(builder->in_delta) {
+      int v = logger_index_hex_value(c);
+      if(c == '|' && builder->delta_digits > 0) {
+        logger_decode_advance_time(&builder->time, builder->delta, builder->absolute);
+        builder->header_len = 0;
+      } else if(v < 0 || builder->delta_digits == L_MAX_DELTA_DIGITS) {
+        builder->header_len = 0;
+      } else {
+        builder->delta = (builder->delta << 4) | v;
+        builder->delta_digits ++;
+      }
+      continue;
+    }
+    builder->header[builder->header_len ++] = c;
+
+    if(builder->header_len == sizeof(builder->header)) {
+      builder->header_len = 0;
+      if(logger_index_parse_header(builder->header, &id)) {
+        logger_index_packet_add_id(builder->packet, id);
+        if(builder->header[5] == ':' || builder->header[5] == '@') { // the ticks follow
+          builder->in_delta = true;
+          builder->absolute = builder->header[5] == '@';
+          builder->delta = 0;
+          builder->delta_digits = 0;
+          builder->header_len = sizeof(builder->header);
+        }
+      }
+    }
+  }
+}
+
+/*
+ * decode the entries of source with an id in one of the ranges that start in
+ * the first owned_len bytes of the source.
+ * time is the time of the log before the first entry, the time of the packet
+ * for its first call, and is updated with the ticks of all the entries.
+ * the definitions of dynamic ids are learned in formats.
+ * update s_unused_bytes to show the number of unused bytes in the source.
+ * return the number of characters that are written to the destination.
+ */
+size_t logger_index_select(char *dst, size_t d_len, const char *src, size_t s_len, size_t *s_unused_bytes, size_t owned_len, const LoggerIdRange *ranges, size_t range_count, unsigned long long *time, LoggerFormats *formats) {
+  const size_t original_d_len = d_len;
+  const char *pos = src;
+  const char *end = src + s_len;
+  const char *entry;
+  LogId id;
+
+  while(pos < end && (size_t) (pos - src) < owned_len) {
+    entry = (const char *) memchr(pos, '\n', end - pos);
+    if(entry == NULL || (size_t) (entry - src) >= owned_len) {
+      pos = end;
+      break;
+    }
+    if(end - entry < 6 || !logger_index_parse_header(entry, &id)) {
+      pos = entry + 1;
+      continue;
+    }
+
+    const char *entry_end = (const char *) memchr(entry + 1, '\n', end - entry - 1);
+    if(entry_end == NULL) { // incomplete entry
+      pos = end;
+      break;
+    }
+
+    const size_t entry_len = entry_end - entry + 1;
+    if(logger_index_ranges_contain(ranges, range_count, id) || id == LOGGER_DEFINE_FORMAT) { // definitions are learned, not written
+      size_t unused;
+      size_t len = logger_decode_timed(dst, d_len, entry, entry_len, &unused, time, formats);
+      if(unused == entry_len) { // not enough space in the output
+        pos = entry;
+        break;
+      }
+      dst += len;
+      d_len -= len;
+    } else {
+      logger_decode_skip(entry, entry_len, time);
+    }
+    pos = entry_end; // the trailing '\n' may start the next entry
+  }
+
+  *s_unused_bytes = end - pos;
+  return original_d_len - d_len;
+}
+
+
+
+void logger_index_write_header(uint8_t *dst, size_t packet_size, uint32_t packet_count) {
+  memset(dst, 0, LOGGER_INDEX_HEADER_SIZE);
+  memcpy(dst, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+  dst[4] = INDEX_VERSION;
+  write_u32(dst + 8, (uint32_t) packet_size);
+  write_u32(dst + 12, packet_count);
+}
+
+bool logger_index_read_header(const uint8_t *src, size_t *packet_size, uint32_t *packet_count) {
+  if(memcmp(src, INDEX_MAGIC, sizeof(INDEX_MAGIC)) || src[4] != INDEX_VERSION) {
+    return false;
+  }
+  *packet_size = read_u32(src + 8);
+  *packet_count = read_u32(src + 12);
+  return *packet_size > 0;
+}
+
+void logger_index_write_packet(uint8_t *dst, const LoggerIndexPacket *packet) {
+  write_u16(dst, packet->min_id);
+  write_u16(dst + 2, packet->max_id);
+  write_u16(dst + 4, packet->count);
+  write_u64(dst + 6, packet->time);
+  dst[14] = packet->has_definitions ? 1 : 0;
+  memcpy(dst + 15, packet->filter, sizeof(packet->filter));
+}
+
+void logger_index_read_packet(LoggerIndexPacket *packet, const uint8_t *src) {
+  packet->min_id = read_u16(src);
+  packet->max_id = read_u16(src + 2);
+  packet->count = read_u16(src + 4);
+  packet->time = read_u64(src + 6);
+  packet->has_definitions = (src[14] & 1) != 0;
+  memcpy(packet->filter, src + 15, sizeof(packet->filter));
+}
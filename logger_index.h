@@ -0,0 +1,64 @@
+#ifndef LOGGER_INDEX_H_
+#define LOGGER_INDEX_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "logger.h"
+
+#define LOGGER_INDEX_FILTER_BITS 256
+
+#define LOGGER_INDEX_HEADER_SIZE 16
+#define LOGGER_INDEX_PACKET_SIZE (15 + LOGGER_INDEX_FILTER_BITS / 8)
+
+// summary of the ids of the entries that start in one compressed packet
+typedef struct {
+  LogId min_id;
+  LogId max_id;
+  uint16_t count;
+  bool has_definitions; // of dynamic ids, which a query learns even if it skips the ids of the packet
+  uint8_t filter[LOGGER_INDEX_FILTER_BITS / 8];
+  unsigned long long time; // of the log before the first entry that starts in the packet
+  bool has_time;           // the builder set the time, it is not serialized
+} LoggerIndexPacket;
+
+typedef struct {
+  LogId first;
+  LogId last;
+} LoggerIdRange;
+
+typedef struct {
+  char header[6];
+  size_t header_len;
+  LoggerIndexPacket *packet; // packet in which the pending header started
+  unsigned long long time; // sum of the ticks of the scanned headers
+  unsigned long delta;     // ticks of the pending header
+  size_t delta_digits;
+  bool absolute;           // the pending header is an anchor
+  bool in_delta;           // the pending header has an id and is followed by its ticks
+} LoggerIndexBuilder;
+
+void logger_index_packet_init(LoggerIndexPacket *packet);
+void logger_index_packet_add_id(LoggerIndexPacket *packet, LogId id);
+bool logger_index_packet_may_contain(const LoggerIndexPacket *packet, LogId first, LogId last);
+
+void logger_index_builder_init(LoggerIndexBuilder *builder);
+void logger_index_builder_scan(LoggerIndexBuilder *builder, LoggerIndexPacket *packet, const char *text, size_t len);
+
+size_t logger_index_select(char *dst, size_t d_len, const char *src, size_t s_len, size_t *s_unused_bytes, size_t owned_len, const LoggerIdRange *ranges, size_t range_count, unsigned long long *time, LoggerFormats *formats);
+
+void logger_index_write_header(uint8_t *dst, size_t packet_size, uint32_t packet_count);
+bool logger_index_read_header(const uint8_t *src, size_t *packet_size, uint32_t *packet_count);
+void logger_index_write_packet(uint8_t *dst, const LoggerIndexPacket *packet);
+void logger_index_read_packet(LoggerIndexPacket *packet, const uint8_t *src);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOGGER_INDEX_H_
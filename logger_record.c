@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "logger.h"
+#include "logger_record.h"
+
+/*
+ * emitters that write the records of logger_decode_record as one line of
+ * JSON or CSV. fields are typed by the specifiers of their format: integer
+ * and float fields are written as numbers if they are valid numbers and all
+ * the other fields are written as strings.
+ *
+ * JSON: {"id":32791,"time":100,"fields":[21.49,"text"]}
+ * CSV:  32791,100,21.49,text
+ *
+ * the time is omitted (or empty in CSV) for entries without a timestamp.
+ */
+
+typedef struct {
+  char *dst;
+  size_t d_len;
+  bool overflow;
+} RecordOutput;
+
+
+
+static void output_write(RecordOutput *output, const char *s, size_t n) {
+  if(n > output->d_len) {
+    output->overflow = true;
+    output->d_len = 0;
+    return;
+  }
+  memcpy(output->dst, s, n);
+  output->dst += n;
+  output->d_len -= n;
+}
+
+static void output_write_string(RecordOutput *output, const char *s) {
+  output_write(output, s, strlen(s));
+}
+
+static void output_write_header(RecordOutput *output, const LoggerRecord *record, bool json) {
+  char number[48];
+  if(json) {
+    snprintf(number, sizeof(number), "{\"id\":%u", (unsigned int) record->id);
+  } else {
+    snprintf(number, sizeof(number), "%u", (unsigned int) record->id);
+  }
+  output_write_string(output, number);
+
+  if(record->has_time) {
+    snprintf(number, sizeof(number), json ? ",\"time\":%llu" : ",%llu", record->time);
+    output_write_string(output, number);
+  } else if(!json) {
+    output_write(output, ",", 1);
+  }
+}
+
+
+
+/*
+ * remove the spaces that are added by the width of the specifier.
+ */
+static void logger_record_trim(const char **s, size_t *length) {
+  while(*length > 0 && **s == ' ') {
+    (*s) ++;
+    (*length) --;
+  }
+  while(*length > 0 && (*s)[*length - 1] == ' ') {
+    (*length) --;
+  }
+}
+
+static size_t logger_record_skip_digits(const char *s, size_t i, size_t length) {
+  while(i < length && '0' <= s[i] && s[i] <= '9') {
+    i ++;
+  }
+  return i;
+}
+
+/*
+ * return true if the text is a JSON number: [-]digits[.digits][e[+-]digits]
+ * where the integer part has no leading zero, so "%05d" is not a number.
+ */
+static bool logger_record_is_number(const char *s, size_t length, bool integer) {
+  size_t i = 0, start;
+
+  if(i < length && s[i] == '-') i ++;
+  start = i;
+  i = logger_record_skip_digits(s, i, length);
+  if(i == start || (s[start] == '0' && i - start > 1)) {
+    return false;
+  }
+  if(integer) {
+    return i == length;
+  }
+  if(i < length && s[i] == '.') {
+    start = ++ i;
+    i = logger_record_skip_digits(s, i, length);
+    if(i == start) {
+      return false;
+    }
+  }
+  if(i < length && (s[i] == 'e' || s[i] == 'E')) {
+    i ++;
+    if(i < length && (s[i] == '-' || s[i] == '+')) i ++;
+    start = i;
+    i = logger_record_skip_digits(s, i, length);
+    if(i == start) {
+      return false;
+    }
+  }
+  return i == length;
+}
+
+/*
+ * return true and update data and length to the number if the field is a
+ * number according to its specifier.
+ */
+static bool logger_record_get_number(const LoggerField *field, const char **data, size_t *length) {
+  const bool integer = field->specifier == 'd' || field->specifier == 'i' || field->specifier == 'u';
+  const bool real = field->specifier == 'f' || field->specifier == 'F';
+
+  *data = field->data;
+  *length = field->length;
+  if(!integer && !real) {
+    return false;
+  }
+  logger_record_trim(data, length);
+  if(*length > 0 && **data == '+') { // JSON does not allow the '+' flag
+    (*data) ++;
+    (*length) --;
+  }
+  return logger_record_is_number(*data, *length, integer);
+}
+
+
+
+static void logger_record_write_json_string(RecordOutput *output, const char *s, size_t length) {
+  char escape[8];
+  size_t i, start = 0;
+
+  output_write(output, "\"", 1);
+  for(i = 0; i < length; i ++) {
+    const unsigned char c = (unsigned char) s[i];
+    if(c != '"' && c != '\\' && c >= 0x20) {
+      continue;
+    }
+    output_write(output, s + start, i - start);
+    if(c == '"' || c == '\\') {
+      escape[0] = '\\';
+      escape[1] = (char) c;
+      escape[2] = 0;
+    } else {
+      snprintf(escape, sizeof(escape), "\\u%04X", c);
+    }
+    output_write_string(output, escape);
+    start = i + 1;
+  }
+  output_write(output, s + start, length - start);
+  output_write(output, "\"", 1);
+}
+
+/*
+ * write the record as a JSON object followed by '\n'.
+ * return the number of characters written or zero if destination is too small.
+ */
+size_t logger_record_write_json(const LoggerRecord *record, char *dst, size_t d_len) {
+  RecordOutput output = { dst, d_len, false };
+  const char *data;
+  size_t i, length;
+
+  output_write_header(&output, record, true);
+  output_write_string(&output, ",\"fields\":[");
+  for(i = 0; i < record->field_count; i ++) {
+    if(i > 0) {
+      output_write(&output, ",", 1);
+    }
+    if(logger_record_get_number(&record->fields[i], &data, &length)) {
+      output_write(&output, data, length);
+    } else {
+      logger_record_write_json_string(&output, record->fields[i].data, record->fields[i].length);
+    }
+  }
+  output_write_string(&output, "]}\n");
+
+  return output.overflow ? 0 : d_len - output.d_len;
+}
+
+
+
+static void logger_record_write_csv_field(RecordOutput *output, const char *s, size_t length) {
+  size_t i, start = 0;
+
+  if(memchr(s, ',', length) == NULL && memchr(s, '"', length) == NULL
+      && memchr(s, '\r', length) == NULL && memchr(s, '\n', length) == NULL) {
+    output_write(output, s, length);
+    return;
+  }
+  output_write(output, "\"", 1);
+  for(i = 0; i < length; i ++) {
+    if(s[i] == '"') { // double the quotes
+      output_write(output, s + start, i + 1 - start);
+      start = i;
+    }
+  }
+  output_write(output, s + start, length - start);
+  output_write(output, "\"", 1);
+}
+
+/*
+ * write the record as a CSV line: the id, the time and the fields.
+ * return the number of characters written or zero if destination is too small.
+ */
+size_t logger_record_write_csv(const LoggerRecord *record, char *dst, size_t d_len) {
+  RecordOutput output = { dst, d_len, false };
+  const char *data;
+  size_t i, length;
+
+  output_write_header(&output, record, false);
+  for(i = 0; i < record->field_count; i ++) {
+    output_write(&output, ",", 1);
+    if(logger_record_get_number(&record->fields[i], &data, &length)) {
+      output_write(&output, data, length);
+    } else {
+      logger_record_write_csv_field(&output, record->fields[i].data, record->fields[i].length);
+    }
+  }
+  output_write(&output, "\n", 1);
+
+  return output.overflow ? 0 : d_len - output.d_len;
+}
@@ -0,0 +1,21 @@
+#ifndef LOGGER_RECORD_H_
+#define LOGGER_RECORD_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "logger.h"
+
+size_t logger_record_write_json(const LoggerRecord *record, char *dst, size_t d_len);
+size_t logger_record_write_csv(const LoggerRecord *record, char *dst, size_t d_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOGGER_RECORD_H_
@@ -0,0 +1,367 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "logger.h"
+#include "logger_recorder.h"
+
+/*
+ * the flight recorder keeps the last entries of the logger in a file of a
+ * fixed size that is mapped in memory, so they survive when the process dies
+ * (the pages belong to the file, not to the process). appending an entry only
+ * copies it into the mapping: there are no system calls on the write path.
+ * logger_recorder_sync flushes the file for a power loss. the positions are
+ * reserved and the frame is written under the lock of the recorder, which is
+ * not contended when one thread logs, so threads can log at the same time.
+ *
+ * positions are byte counts since the file was created and the offset of a
+ * position is position % capacity. every entry is one frame:
+ *
+ * frame:  payload length (u32 LE), checksum of the sequence, the length and
+ *         the payload (u32 LE), sequence (u64 LE), the payload padded to 16
+ * header: "LRFR", version (u16 LE), header size (u16 LE), capacity (u64 LE),
+ *         head and tail positions (u64 in the byte order of the machine),
+ *         checksum of the first 16 bytes (u32 LE)
+ *
+ * a frame that does not fit before the end of the file is preceded by a
+ * padding frame (length 0xFFFFFFFF) until the end. before a frame overwrites
+ * the oldest frames the head is moved past them, so the head always points to
+ * a complete frame. the payload is written before the frame header and the
+ * tail is written last; the reader starts at the head and follows the
+ * sequence numbers while the checksums are right, so a frame that was torn
+ * by a crash ends the log and a frame that was written before the tail is
+ * updated is still read.
+ */
+
+static const char RECORDER_MAGIC[4] = { 'L', 'R', 'F', 'R' };
+
+#define PADDING_LENGTH 0xFFFFFFFFu
+#define FRAME_ALIGNMENT 16
+#define HEAD_OFFSET 16
+#define TAIL_OFFSET 24
+
+#if defined(__GNUC__)
+#define POSITION_STORE(_p_, _value_) __atomic_store_n((_p_), (_value_), __ATOMIC_RELEASE)
+#define POSITION_LOAD(_p_) __atomic_load_n((_p_), __ATOMIC_ACQUIRE)
+#define COMPILER_BARRIER() __atomic_signal_fence(__ATOMIC_SEQ_CST)
+#else
+#define POSITION_STORE(_p_, _value_) (*(_p_) = (_value_))
+#define POSITION_LOAD(_p_) (*(_p_))
+#define COMPILER_BARRIER()
+#endif
+
+static LoggerRecorder *active_recorder = NULL;
+
+
+
+static void write_u16(uint8_t *dst, uint16_t value) {
+  dst[0] = (uint8_t) value;
+  dst[1] = (uint8_t) (value >> 8);
+}
+
+static void write_u32(uint8_t *dst, uint32_t value) {
+  write_u16(dst, (uint16_t) value);
+  write_u16(dst + 2, (uint16_t) (value >> 16));
+}
+
+static void write_u64(uint8_t *dst, uint64_t value) {
+  write_u32(dst, (uint32_t) value);
+  write_u32(dst + 4, (uint32_t) (value >> 32));
+}
+
+static uint16_t read_u16(const uint8_t *src) {
+  return (uint16_t) (src[0] | (src[1] << 8));
+}
+
+static uint32_t read_u32(const uint8_t *src) {
+  return read_u16(src) | ((uint32_t) read_u16(src + 2) << 16);
+}
+
+static uint64_t read_u64(const uint8_t *src) {
+  return read_u32(src) | ((uint64_t) read_u32(src + 4) << 32);
+}
+
+static uint32_t recorder_checksum(uint32_t h, const uint8_t *data, size_t length) {
+  size_t i;
+  for(i = 0; i < length; i ++) {
+    h = (h ^ data[i]) * 16777619u; // FNV-1a
+  }
+  return h;
+}
+
+static uint32_t recorder_frame_checksum(const uint8_t *frame, const uint8_t *payload, size_t length) {
+  uint32_t h = recorder_checksum(2166136261u, frame + 8, 8); // sequence
+  h = recorder_checksum(h, frame, 4);                        // length
+  return recorder_checksum(h, payload, length);
+}
+
+static uint64_t recorder_frame_size(size_t length) {
+  return LOGGER_RECORDER_FRAME_HEADER_SIZE + ((length + FRAME_ALIGNMENT - 1) & ~(uint64_t) (FRAME_ALIGNMENT - 1));
+}
+
+static uint64_t *recorder_position(const uint8_t *map, size_t offset) {
+  return (uint64_t *) (map + offset); // aligned because the mapping is
+}
+
+
+
+/*
+ * return the size of the frame at the position or zero if it is not a valid
+ * frame of the sequence.
+ */
+static uint64_t recorder_check_frame(const uint8_t *frames, uint64_t capacity, uint64_t position, uint64_t sequence) {
+  const uint64_t offset = position % capacity;
+  const uint8_t *frame = frames + offset;
+  const uint32_t length = read_u32(frame);
+  uint64_t size;
+
+  if(length == PADDING_LENGTH) {
+    size = capacity - offset;
+  } else if(length <= capacity - offset - LOGGER_RECORDER_FRAME_HEADER_SIZE) {
+    size = recorder_frame_size(length);
+  } else {
+    return 0;
+  }
+  if(read_u64(frame + 8) != sequence
+      || read_u32(frame + 4) != recorder_frame_checksum(frame, frame + LOGGER_RECORDER_FRAME_HEADER_SIZE, length == PADDING_LENGTH ? 0 : length)) {
+    return 0;
+  }
+  return size;
+}
+
+/*
+ * write a frame at the tail after moving the head past the frames that it
+ * overwrites.
+ */
+static void recorder_write_frame(LoggerRecorder *recorder, const uint8_t *data, size_t length, uint64_t size) {
+  uint8_t *frame = recorder->frames + recorder->tail % recorder->capacity;
+
+  while(recorder->tail + size - recorder->head > recorder->capacity) {
+    const uint64_t offset = recorder->head % recorder->capacity;
+    const uint32_t head_length = read_u32(recorder->frames + offset);
+    recorder->head += head_length == PADDING_LENGTH ? recorder->capacity - offset : recorder_frame_size(head_length);
+  }
+  POSITION_STORE(recorder_position(recorder->map, HEAD_OFFSET), recorder->head);
+  COMPILER_BARRIER(); // the head is moved before the frames are overwritten
+
+  if(length != PADDING_LENGTH) {
+    memcpy(frame + LOGGER_RECORDER_FRAME_HEADER_SIZE, data, length);
+  }
+  write_u64(frame + 8, recorder->sequence);
+  write_u32(frame, (uint32_t) length);
+  COMPILER_BARRIER(); // the checksum is written last
+  write_u32(frame + 4, recorder_frame_checksum(frame, data, length == PADDING_LENGTH ? 0 : length));
+  recorder->sequence ++;
+  recorder->tail += size;
+}
+
+/*
+ * find the end of the frames of an existing file to continue after them.
+ */
+static void recorder_resume(LoggerRecorder *recorder) {
+  LoggerRecorderReader reader;
+  const uint8_t *data;
+  size_t length;
+
+  recorder->head = recorder->tail = POSITION_LOAD(recorder_position(recorder->map, HEAD_OFFSET));
+  recorder->sequence = 0;
+  if(logger_recorder_reader_init(&reader, recorder->map, recorder->map_length)) {
+    while(logger_recorder_reader_next(&reader, &data, &length)) {
+    }
+    if(reader.started) {
+      recorder->tail = reader.position;
+      recorder->sequence = reader.sequence;
+    }
+  }
+  POSITION_STORE(recorder_position(recorder->map, TAIL_OFFSET), recorder->tail);
+}
+
+static void recorder_write_header(uint8_t *map, uint64_t capacity) {
+  memset(map, 0, LOGGER_RECORDER_HEADER_SIZE);
+  memcpy(map, RECORDER_MAGIC, sizeof(RECORDER_MAGIC));
+  write_u16(map + 4, LOGGER_RECORDER_VERSION);
+  write_u16(map + 6, LOGGER_RECORDER_HEADER_SIZE);
+  write_u64(map + 8, capacity);
+  write_u32(map + 32, recorder_checksum(2166136261u, map, 16));
+}
+
+static bool recorder_check_header(const uint8_t *map, size_t length) {
+  return length >= LOGGER_RECORDER_HEADER_SIZE && !memcmp(map, RECORDER_MAGIC, sizeof(RECORDER_MAGIC))
+      && read_u16(map + 4) == LOGGER_RECORDER_VERSION && read_u16(map + 6) == LOGGER_RECORDER_HEADER_SIZE
+      && read_u32(map + 32) == recorder_checksum(2166136261u, map, 16)
+      && read_u64(map + 8) == length - LOGGER_RECORDER_HEADER_SIZE
+      && read_u64(map + 8) >= LOGGER_RECORDER_MIN_CAPACITY && read_u64(map + 8) % FRAME_ALIGNMENT == 0;
+}
+
+
+
+/*
+ * open or create a recorder file with a capacity for frames. an existing file
+ * with the same capacity keeps its frames and the new frames follow them;
+ * any other file is cleared.
+ * return false if the file cannot be created and mapped or the capacity is
+ * smaller than LOGGER_RECORDER_MIN_CAPACITY or not a multiple of 16.
+ */
+bool logger_recorder_open(LoggerRecorder *recorder, const char *path, size_t capacity) {
+  const size_t map_length = LOGGER_RECORDER_HEADER_SIZE + capacity;
+  struct stat st;
+  void *map;
+
+  if(capacity < LOGGER_RECORDER_MIN_CAPACITY || capacity % FRAME_ALIGNMENT != 0) {
+    return false;
+  }
+  const int fd = open(path, O_RDWR | O_CREAT, 0644);
+  if(fd < 0) {
+    return false;
+  }
+  if(fstat(fd, &st) < 0 || ((size_t) st.st_size != map_length && (ftruncate(fd, 0) < 0 || ftruncate(fd, map_length) < 0))) {
+    close(fd);
+    return false;
+  }
+  map = mmap(NULL, map_length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED) {
+    return false;
+  }
+
+  memset(recorder, 0, sizeof(LoggerRecorder));
+  recorder->map = (uint8_t *) map;
+  recorder->map_length = map_length;
+  recorder->frames = recorder->map + LOGGER_RECORDER_HEADER_SIZE;
+  recorder->capacity = capacity;
+  pthread_mutex_init(&recorder->lock, NULL);
+  if(!recorder_check_header(recorder->map, map_length)) {
+    memset(recorder->map, 0, map_length); // old frames must not follow the new ones
+    recorder_write_header(recorder->map, capacity);
+  }
+  recorder_resume(recorder);
+  return true;
+}
+
+void logger_recorder_close(LoggerRecorder *recorder) {
+  if(active_recorder == recorder) {
+    active_recorder = NULL;
+  }
+  munmap(recorder->map, recorder->map_length);
+  recorder->map = NULL;
+  pthread_mutex_destroy(&recorder->lock);
+}
+
+/*
+ * append an entry as one frame. the oldest frames are overwritten when the
+ * file is full.
+ * return false if the entry is larger than the file.
+ */
+bool logger_recorder_append(LoggerRecorder *recorder, const uint8_t *data, size_t length) {
+  const uint64_t size = recorder_frame_size(length);
+  pthread_mutex_lock(&recorder->lock);
+  if(size > recorder->capacity || length >= PADDING_LENGTH) {
+    recorder->dropped ++;
+    pthread_mutex_unlock(&recorder->lock);
+    return false;
+  }
+
+  const uint64_t room = recorder->capacity - recorder->tail % recorder->capacity;
+  if(size > room) {
+    recorder_write_frame(recorder, NULL, PADDING_LENGTH, room);
+  }
+  recorder_write_frame(recorder, data, length, size);
+  POSITION_STORE(recorder_position(recorder->map, TAIL_OFFSET), recorder->tail);
+  pthread_mutex_unlock(&recorder->lock);
+  return true;
+}
+
+/*
+ * write the mapped file to the storage so it also survives a power loss.
+ * this is a system call, it is not done when appending.
+ */
+bool logger_recorder_sync(LoggerRecorder *recorder) {
+  return msync(recorder->map, recorder->map_length, MS_SYNC) == 0;
+}
+
+/*
+ * set the recorder that logger_recorder_write appends to.
+ */
+void logger_recorder_set_active(LoggerRecorder *recorder) {
+  active_recorder = recorder;
+}
+
+/*
+ * a LogWriter for logger_register_log_writer that appends every entry to the
+ * active recorder.
+ */
+void logger_recorder_write(const uint8_t *data, const size_t length) {
+  if(active_recorder != NULL) {
+    logger_recorder_append(active_recorder, data, length);
+  }
+}
+
+
+
+/*
+ * start reading the frames of a recorder file in memory, e.g. a copy of the
+ * file after a crash.
+ * return false if it is not a recorder file.
+ */
+bool logger_recorder_reader_init(LoggerRecorderReader *reader, const uint8_t *file, size_t length) {
+  if(!recorder_check_header(file, length)) {
+    return false;
+  }
+  reader->frames = file + LOGGER_RECORDER_HEADER_SIZE;
+  reader->started = false;
+  reader->capacity = read_u64(file + 8);
+  reader->head = POSITION_LOAD(recorder_position(file, HEAD_OFFSET));
+  if(reader->head % FRAME_ALIGNMENT != 0) {
+    return false;
+  }
+  reader->position = reader->head;
+  reader->sequence = read_u64(reader->frames + reader->head % reader->capacity + 8);
+  return true;
+}
+
+/*
+ * set data and length to the payload of the next frame.
+ * return false at the end of the valid frames.
+ */
+bool logger_recorder_reader_next(LoggerRecorderReader *reader, const uint8_t **data, size_t *length) {
+  uint64_t size;
+
+  while(reader->position - reader->head < reader->capacity
+      && (size = recorder_check_frame(reader->frames, reader->capacity, reader->position, reader->sequence)) > 0
+      && reader->position + size - reader->head <= reader->capacity) {
+    const uint8_t *frame = reader->frames + reader->position % reader->capacity;
+    reader->position += size;
+    reader->sequence ++;
+    reader->started = true;
+    if(read_u32(frame) != PADDING_LENGTH) {
+      *data = frame + LOGGER_RECORDER_FRAME_HEADER_SIZE;
+      *length = read_u32(frame);
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+ * copy the payloads of the valid frames of a recorder file from the oldest
+ * one while they fit in destination, e.g. to feed them to logger_decode.
+ * return the number of bytes written.
+ */
+size_t logger_recorder_recover(uint8_t *dst, size_t d_len, const uint8_t *file, size_t length) {
+  LoggerRecorderReader reader;
+  const uint8_t *data;
+  size_t n, len = 0;
+
+  if(!logger_recorder_reader_init(&reader, file, length)) {
+    return 0;
+  }
+  while(logger_recorder_reader_next(&reader, &data, &n) && len + n <= d_len) {
+    memcpy(dst + len, data, n);
+    len += n;
+  }
+  return len;
+}
@@ -0,0 +1,59 @@
+#ifndef LOGGER_RECORDER_H_
+#define LOGGER_RECORDER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "logger.h"
+
+#define LOGGER_RECORDER_VERSION 1
+#define LOGGER_RECORDER_HEADER_SIZE 64
+#define LOGGER_RECORDER_FRAME_HEADER_SIZE 16
+#define LOGGER_RECORDER_MIN_CAPACITY 256 // the capacity is a multiple of 16
+
+// a circular file of frames that is mapped in memory
+typedef struct {
+  uint8_t *map;         // header followed by the frames
+  size_t map_length;
+  uint8_t *frames;
+  uint64_t capacity;
+  uint64_t head;        // position of the oldest frame
+  uint64_t tail;        // position after the newest frame
+  uint64_t sequence;    // of the next frame
+  uint32_t dropped;     // entries that did not fit in the file
+  pthread_mutex_t lock; // the logger calls the writer from several threads
+} LoggerRecorder;
+
+// reads the frames of a recorder file from the oldest one
+typedef struct {
+  const uint8_t *frames;
+  uint64_t capacity;
+  uint64_t head;
+  uint64_t position;
+  uint64_t sequence;    // of the next frame
+  bool started;
+} LoggerRecorderReader;
+
+bool logger_recorder_open(LoggerRecorder *recorder, const char *path, size_t capacity);
+void logger_recorder_close(LoggerRecorder *recorder);
+bool logger_recorder_append(LoggerRecorder *recorder, const uint8_t *data, size_t length);
+bool logger_recorder_sync(LoggerRecorder *recorder);
+
+void logger_recorder_set_active(LoggerRecorder *recorder);
+void logger_recorder_write(const uint8_t *data, const size_t length);
+
+bool logger_recorder_reader_init(LoggerRecorderReader *reader, const uint8_t *file, size_t length);
+bool logger_recorder_reader_next(LoggerRecorderReader *reader, const uint8_t **data, size_t *length);
+size_t logger_recorder_recover(uint8_t *dst, size_t d_len, const uint8_t *file, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOGGER_RECORDER_H_
@@ -0,0 +1,543 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // fallocate
+#endif
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#if defined(__linux__)
+#include <linux/io_uring.h>
+#endif
+
+#include "logger.h"
+#include "logger_sink.h"
+
+/*
+ * the file sink copies the entries into large buffers and a writer thread
+ * writes the buffers to the file, so the logging path does not make system
+ * calls: it takes a lock, copies the entry and, once per buffer, wakes the
+ * writer. an entry is dropped and counted when all the buffers are waiting to
+ * be written, the logging path never waits for the disk.
+ *
+ * the writer writes all the buffers that are ready with one pwritev, or with
+ * one writev of io_uring when it is available, and at least every
+ * flush_latency milliseconds it writes the buffer that is being filled. the
+ * file is preallocated with fallocate as it grows. the writer also rotates
+ * the files (path -> path.1 -> path.2 ...) when the next buffer would make the
+ * file larger than max_file_size or the file is older than max_file_age, so a
+ * rotation never stalls the logging path and an entry is never split across
+ * two files. after a rotation the next entry of every writer of the logger
+ * has the absolute time, so a rotated file can be decoded on its own.
+ */
+
+#define PREALLOCATED_BUFFERS 16 // the file grows by this many buffers when there is no size limit
+
+static LoggerSink *active_sink = NULL;
+
+
+
+static uint64_t sink_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void sink_deadline(struct timespec *deadline, uint32_t milliseconds) {
+  clock_gettime(CLOCK_MONOTONIC, deadline);
+  deadline->tv_sec += milliseconds / 1000;
+  deadline->tv_nsec += (long) (milliseconds % 1000) * 1000000;
+  if(deadline->tv_nsec >= 1000000000) {
+    deadline->tv_sec ++;
+    deadline->tv_nsec -= 1000000000;
+  }
+}
+
+
+
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+
+#define RING_LOAD(_p_) __atomic_load_n((_p_), __ATOMIC_ACQUIRE)
+#define RING_STORE(_p_, _value_) __atomic_store_n((_p_), (_value_), __ATOMIC_RELEASE)
+
+static void sink_ring_deinit(LoggerSinkRing *ring) {
+  if(ring->sqes != NULL) {
+    munmap(ring->sqes, ring->sqes_length);
+  }
+  if(ring->cq_map != NULL && ring->cq_map != ring->sq_map) {
+    munmap(ring->cq_map, ring->cq_map_length);
+  }
+  if(ring->sq_map != NULL) {
+    munmap(ring->sq_map, ring->sq_map_length);
+  }
+  close(ring->fd);
+}
+
+/*
+ * set up an io_uring with the system calls directly.
+ * return false if the kernel does not have io_uring or does not allow it.
+ */
+static bool sink_ring_init(LoggerSinkRing *ring, unsigned int entries) {
+  struct io_uring_params params;
+  void *map;
+
+  memset(ring, 0, sizeof(LoggerSinkRing));
+  memset(&params, 0, sizeof(params));
+  ring->fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+  if(ring->fd < 0) {
+    return false;
+  }
+
+  ring->sq_map_length = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+  ring->cq_map_length = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if(params.features & IORING_FEAT_SINGLE_MMAP) {
+    if(ring->cq_map_length > ring->sq_map_length) {
+      ring->sq_map_length = ring->cq_map_length;
+    }
+    ring->cq_map_length = ring->sq_map_length;
+  }
+  map = mmap(NULL, ring->sq_map_length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  ring->sq_map = map != MAP_FAILED ? map : NULL;
+  if(ring->sq_map != NULL && (params.features & IORING_FEAT_SINGLE_MMAP)) {
+    ring->cq_map = ring->sq_map;
+  } else if(ring->sq_map != NULL) {
+    map = mmap(NULL, ring->cq_map_length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    ring->cq_map = map != MAP_FAILED ? map : NULL;
+  }
+  ring->sqes_length = params.sq_entries * sizeof(struct io_uring_sqe);
+  map = mmap(NULL, ring->sqes_length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+  ring->sqes = map != MAP_FAILED ? map : NULL;
+  if(ring->sq_map == NULL || ring->cq_map == NULL || ring->sqes == NULL) {
+    sink_ring_deinit(ring);
+    return false;
+  }
+
+  uint8_t *sq = (uint8_t *) ring->sq_map;
+  uint8_t *cq = (uint8_t *) ring->cq_map;
+  ring->sq_head = (unsigned int *) (sq + params.sq_off.head);
+  ring->sq_tail = (unsigned int *) (sq + params.sq_off.tail);
+  ring->sq_mask = (unsigned int *) (sq + params.sq_off.ring_mask);
+  ring->sq_array = (unsigned int *) (sq + params.sq_off.array);
+  ring->cq_head = (unsigned int *) (cq + params.cq_off.head);
+  ring->cq_tail = (unsigned int *) (cq + params.cq_off.tail);
+  ring->cq_mask = (unsigned int *) (cq + params.cq_off.ring_mask);
+  ring->cqes = cq + params.cq_off.cqes;
+  return true;
+}
+
+/*
+ * write the vector at the offset with io_uring and wait for the completion.
+ * return the number of bytes written or a negative error.
+ */
+static ssize_t sink_ring_writev(LoggerSinkRing *ring, int fd, const struct iovec *iov, int count, uint64_t offset) {
+  const unsigned int tail = *ring->sq_tail;
+  const unsigned int index = tail & *ring->sq_mask;
+  struct io_uring_sqe *sqe = &((struct io_uring_sqe *) ring->sqes)[index];
+
+  memset(sqe, 0, sizeof(struct io_uring_sqe));
+  sqe->opcode = IORING_OP_WRITEV;
+  sqe->fd = fd;
+  sqe->addr = (uint64_t) (uintptr_t) iov;
+  sqe->len = (uint32_t) count;
+  sqe->off = offset;
+  ring->sq_array[index] = index;
+  RING_STORE(ring->sq_tail, tail + 1);
+
+  if(syscall(__NR_io_uring_enter, ring->fd, 1, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0) {
+    return -errno;
+  }
+  const unsigned int head = *ring->cq_head;
+  if(head == RING_LOAD(ring->cq_tail)) {
+    return -EIO;
+  }
+  const int result = ((struct io_uring_cqe *) ring->cqes)[head & *ring->cq_mask].res;
+  RING_STORE(ring->cq_head, head + 1);
+  return result;
+}
+
+#else
+
+static bool sink_ring_init(LoggerSinkRing *ring, unsigned int entries) {
+  (void) ring;
+  (void) entries;
+  return false;
+}
+
+static void sink_ring_deinit(LoggerSinkRing *ring) {
+  (void) ring;
+}
+
+static ssize_t sink_ring_writev(LoggerSinkRing *ring, int fd, const struct iovec *iov, int count, uint64_t offset) {
+  (void) ring;
+  (void) fd;
+  (void) iov;
+  (void) count;
+  (void) offset;
+  return -ENOSYS;
+}
+
+#endif
+
+
+
+/*
+ * preallocate the file so it has room for length more bytes.
+ */
+static void sink_preallocate(LoggerSink *sink, uint64_t length) {
+  if(sink->file_size + length <= sink->allocated) {
+    return;
+  }
+  uint64_t size = sink->config.max_file_size > 0 ? sink->config.max_file_size
+      : sink->allocated + PREALLOCATED_BUFFERS * (uint64_t) sink->config.buffer_size;
+  if(size < sink->file_size + length) {
+    size = sink->file_size + length;
+  }
+#if defined(__linux__)
+  fallocate(sink->fd, FALLOC_FL_KEEP_SIZE, (off_t) sink->allocated, (off_t) (size - sink->allocated)); // it is only a hint
+#endif
+  sink->allocated = size;
+}
+
+static bool sink_open_file(LoggerSink *sink, bool truncate) {
+  struct stat st;
+
+  sink->fd = open(sink->path, O_WRONLY | O_CREAT | (truncate ? O_TRUNC : 0), 0644);
+  if(sink->fd < 0 || fstat(sink->fd, &st) < 0) {
+    return false;
+  }
+  sink->file_size = sink->allocated = (uint64_t) st.st_size;
+  sink->file_opened = sink_now();
+  sink_preallocate(sink, 1);
+  return true;
+}
+
+/*
+ * release the preallocated space after the end and close the file.
+ */
+static bool sink_close_file(LoggerSink *sink) {
+  bool truncated = true;
+  if(sink->fd >= 0) {
+    truncated = ftruncate(sink->fd, (off_t) sink->file_size) == 0;
+    close(sink->fd);
+    sink->fd = -1;
+  }
+  return truncated;
+}
+
+static void sink_rotate(LoggerSink *sink, LoggerSinkStats *stats) {
+  char from[LOGGER_SINK_MAX_PATH + 12], to[LOGGER_SINK_MAX_PATH + 12];
+  unsigned int i;
+
+  if(!sink_close_file(sink)) {
+    stats->write_errors ++;
+  }
+  for(i = sink->config.max_files; i >= 1; i --) { // path.max_files is replaced
+    if(i == 1) {
+      snprintf(from, sizeof(from), "%s", sink->path);
+    } else {
+      snprintf(from, sizeof(from), "%s.%u", sink->path, i - 1);
+    }
+    snprintf(to, sizeof(to), "%s.%u", sink->path, i);
+    rename(from, to);
+  }
+  if(!sink_open_file(sink, true)) {
+    stats->write_errors ++;
+  }
+  logger_anchor_time(); // the entries that are still buffered only have deltas
+  stats->rotations ++;
+}
+
+static bool sink_needs_rotation(LoggerSink *sink, uint64_t pending, uint64_t length) {
+  if(sink->file_size + pending == 0) {
+    return false;
+  }
+  return (sink->config.max_file_size > 0 && sink->file_size + pending + length > sink->config.max_file_size)
+      || (sink->config.max_file_age > 0 && sink_now() - sink->file_opened >= sink->config.max_file_age * (uint64_t) 1000);
+}
+
+/*
+ * write the vector at the end of the file, again for the rest of a short write.
+ */
+static void sink_write_vector(LoggerSink *sink, struct iovec *iov, int count, uint64_t length, LoggerSinkStats *stats) {
+  if(count == 0 || sink->fd < 0) {
+    return;
+  }
+  sink_preallocate(sink, length);
+  while(count > 0) {
+    ssize_t n = sink->has_ring ? sink_ring_writev(&sink->ring, sink->fd, iov, count, sink->file_size)
+        : pwritev(sink->fd, iov, count, (off_t) sink->file_size);
+    stats->writes ++;
+    if(n < 0 && !sink->has_ring) {
+      n = -errno;
+    }
+    if(n == -EINTR || n == -EAGAIN) {
+      continue;
+    }
+    if(n <= 0) {
+      stats->write_errors ++;
+      return;
+    }
+    sink->file_size += n;
+    while(count > 0 && (size_t) n >= iov->iov_len) {
+      n -= iov->iov_len;
+      iov ++;
+      count --;
+    }
+    if(count > 0) {
+      iov->iov_base = (uint8_t *) iov->iov_base + n;
+      iov->iov_len -= n;
+    }
+  }
+}
+
+/*
+ * write count sealed buffers from first, rotating the file between buffers.
+ */
+static void sink_write_buffers(LoggerSink *sink, size_t first, size_t count, LoggerSinkStats *stats) {
+  struct iovec iov[LOGGER_SINK_BUFFERS];
+  uint64_t pending = 0;
+  int n = 0;
+  size_t i;
+
+  for(i = 0; i < count; i ++) {
+    const size_t b = (first + i) % LOGGER_SINK_BUFFERS;
+    if(sink_needs_rotation(sink, pending, sink->lengths[b])) {
+      sink_write_vector(sink, iov, n, pending, stats);
+      sink_rotate(sink, stats);
+      n = 0;
+      pending = 0;
+    }
+    iov[n].iov_base = sink->buffers[b];
+    iov[n].iov_len = sink->lengths[b];
+    pending += sink->lengths[b];
+    n ++;
+  }
+  sink_write_vector(sink, iov, n, pending, stats);
+}
+
+/*
+ * make the current buffer ready for the writer. the lock must be held and
+ * there must be a free buffer.
+ */
+static void sink_seal(LoggerSink *sink) {
+  sink->sealed_count ++;
+  sink->sealed_total ++;
+  sink->current = (sink->current + 1) % LOGGER_SINK_BUFFERS;
+}
+
+static void *sink_writer(void *argument) {
+  LoggerSink *sink = (LoggerSink *) argument;
+  struct timespec deadline;
+
+  pthread_mutex_lock(&sink->lock);
+  while(true) {
+    if(sink->sealed_count == 0) {
+      const bool has_entries = sink->lengths[sink->current] > 0;
+      if(has_entries && (sink->flush_requested || sink->stopping)) {
+        sink->flush_requested = false;
+        sink_seal(sink);
+      } else if(sink->stopping) {
+        break;
+      } else {
+        sink_deadline(&deadline, sink->config.flush_latency);
+        if(pthread_cond_timedwait(&sink->sealed, &sink->lock, &deadline) == ETIMEDOUT
+            && sink->sealed_count == 0 && sink->lengths[sink->current] > 0) {
+          sink_seal(sink);
+        }
+        continue;
+      }
+    }
+
+    const size_t first = sink->first_sealed;
+    const size_t count = sink->sealed_count;
+    LoggerSinkStats stats;
+    memset(&stats, 0, sizeof(stats));
+    pthread_mutex_unlock(&sink->lock);
+
+    sink_write_buffers(sink, first, count, &stats);
+
+    pthread_mutex_lock(&sink->lock);
+    size_t i;
+    for(i = 0; i < count; i ++) {
+      sink->lengths[(first + i) % LOGGER_SINK_BUFFERS] = 0;
+    }
+    sink->first_sealed = (first + count) % LOGGER_SINK_BUFFERS;
+    sink->sealed_count -= count;
+    sink->written_total += count;
+    sink->stats.writes += stats.writes;
+    sink->stats.rotations += stats.rotations;
+    sink->stats.write_errors += stats.write_errors;
+    pthread_cond_broadcast(&sink->written);
+  }
+  pthread_mutex_unlock(&sink->lock);
+  return NULL;
+}
+
+
+
+static void sink_free_buffers(LoggerSink *sink) {
+  size_t i;
+  for(i = 0; i < LOGGER_SINK_BUFFERS; i ++) {
+    free(sink->buffers[i]);
+    sink->buffers[i] = NULL;
+  }
+}
+
+/*
+ * close the file and release the ring, the buffers and the synchronization
+ * objects once the writer thread is stopped or was never started.
+ */
+static void sink_release(LoggerSink *sink) {
+  sink_close_file(sink);
+  if(sink->has_ring) {
+    sink_ring_deinit(&sink->ring);
+  }
+  sink_free_buffers(sink);
+  pthread_cond_destroy(&sink->written);
+  pthread_cond_destroy(&sink->sealed);
+  pthread_mutex_destroy(&sink->lock);
+}
+
+/*
+ * open the file of the configuration, appending to it if it exists, and start
+ * the writer thread.
+ * return false if the configuration is not valid or the file cannot be
+ * opened.
+ */
+bool logger_sink_init(LoggerSink *sink, const LoggerSinkConfig *config) {
+  pthread_condattr_t attributes;
+  size_t i;
+
+  memset(sink, 0, sizeof(LoggerSink));
+  sink->fd = -1;
+  const bool rotating = config->max_file_size > 0 || config->max_file_age > 0;
+  if(config->path == NULL || strlen(config->path) >= LOGGER_SINK_MAX_PATH
+      || (rotating && config->max_files == 0) || config->max_files > LOGGER_SINK_MAX_FILES) {
+    return false;
+  }
+  strcpy(sink->path, config->path);
+  sink->config = *config;
+  sink->config.path = sink->path;
+  if(sink->config.buffer_size == 0) {
+    sink->config.buffer_size = LOGGER_SINK_DEFAULT_BUFFER_SIZE;
+  }
+  sink->config.buffer_size = (sink->config.buffer_size + LOGGER_SINK_ALIGNMENT - 1) & ~(size_t) (LOGGER_SINK_ALIGNMENT - 1);
+  if(sink->config.flush_latency == 0) {
+    sink->config.flush_latency = LOGGER_SINK_DEFAULT_FLUSH_LATENCY;
+  }
+
+  for(i = 0; i < LOGGER_SINK_BUFFERS; i ++) {
+    void *buffer;
+    if(posix_memalign(&buffer, LOGGER_SINK_ALIGNMENT, sink->config.buffer_size) != 0) {
+      sink_free_buffers(sink);
+      return false;
+    }
+    sink->buffers[i] = (uint8_t *) buffer;
+  }
+  if(!sink_open_file(sink, false)) {
+    sink_close_file(sink);
+    sink_free_buffers(sink);
+    return false;
+  }
+  sink->has_ring = sink->config.use_io_uring && sink_ring_init(&sink->ring, LOGGER_SINK_BUFFERS);
+  sink->stats.io_uring = sink->has_ring;
+
+  pthread_mutex_init(&sink->lock, NULL);
+  pthread_condattr_init(&attributes);
+  pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+  pthread_cond_init(&sink->sealed, &attributes);
+  pthread_condattr_destroy(&attributes);
+  pthread_cond_init(&sink->written, NULL);
+  if(pthread_create(&sink->writer, NULL, sink_writer, sink) != 0) {
+    sink_release(sink); // there is no thread to join
+    return false;
+  }
+  return true;
+}
+
+/*
+ * write what is in the buffers, stop the writer thread and close the file.
+ */
+void logger_sink_deinit(LoggerSink *sink) {
+  if(active_sink == sink) {
+    active_sink = NULL;
+  }
+  if(sink->buffers[0] == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&sink->lock);
+  sink->stopping = true;
+  pthread_cond_signal(&sink->sealed);
+  pthread_mutex_unlock(&sink->lock);
+  pthread_join(sink->writer, NULL);
+  sink_release(sink);
+}
+
+/*
+ * copy an entry into the current buffer. a full buffer is passed to the
+ * writer thread.
+ * return false and count the entry as dropped if it is larger than a buffer
+ * or all the other buffers are not written yet.
+ */
+bool logger_sink_append(LoggerSink *sink, const uint8_t *data, size_t length) {
+  pthread_mutex_lock(&sink->lock);
+  if(length > sink->config.buffer_size
+      || (sink->lengths[sink->current] + length > sink->config.buffer_size && sink->sealed_count == LOGGER_SINK_BUFFERS - 1)) {
+    sink->stats.dropped_entries ++;
+    pthread_mutex_unlock(&sink->lock);
+    return false;
+  }
+  if(sink->lengths[sink->current] + length > sink->config.buffer_size) {
+    sink_seal(sink);
+    pthread_cond_signal(&sink->sealed);
+  }
+  memcpy(sink->buffers[sink->current] + sink->lengths[sink->current], data, length);
+  sink->lengths[sink->current] += length;
+  sink->stats.entries ++;
+  sink->stats.bytes += length;
+  pthread_mutex_unlock(&sink->lock);
+  return true;
+}
+
+/*
+ * wait until the entries that were appended before are written to the file.
+ */
+void logger_sink_flush(LoggerSink *sink) {
+  pthread_mutex_lock(&sink->lock);
+  const uint64_t target = sink->sealed_total + (sink->lengths[sink->current] > 0 ? 1 : 0);
+  sink->flush_requested = true;
+  pthread_cond_signal(&sink->sealed);
+  while(sink->written_total < target) {
+    pthread_cond_wait(&sink->written, &sink->lock);
+  }
+  pthread_mutex_unlock(&sink->lock);
+}
+
+void logger_sink_get_stats(LoggerSink *sink, LoggerSinkStats *stats) {
+  pthread_mutex_lock(&sink->lock);
+  *stats = sink->stats;
+  pthread_mutex_unlock(&sink->lock);
+}
+
+/*
+ * set the sink that logger_sink_write appends to.
+ */
+void logger_sink_set_active(LoggerSink *sink) {
+  active_sink = sink;
+}
+
+/*
+ * a LogWriter for logger_register_log_writer that appends every entry to the
+ * active sink.
+ */
+void logger_sink_write(const uint8_t *data, const size_t length) {
+  if(active_sink != NULL) {
+    logger_sink_append(active_sink, data, length);
+  }
+}
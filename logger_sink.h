@@ -0,0 +1,103 @@
+#ifndef LOGGER_SINK_H_
+#define LOGGER_SINK_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "logger.h"
+
+#define LOGGER_SINK_BUFFERS 4              // one is filled while the others are written
+#define LOGGER_SINK_ALIGNMENT 4096         // of the buffers and their size
+#define LOGGER_SINK_DEFAULT_BUFFER_SIZE (64 * 1024)
+#define LOGGER_SINK_DEFAULT_FLUSH_LATENCY 100 // milliseconds
+#define LOGGER_SINK_MAX_PATH 256
+#define LOGGER_SINK_MAX_FILES 99
+
+typedef struct {
+  const char *path;          // the rotated files are path.1 (newest) to path.max_files
+  size_t buffer_size;        // 0 for the default, rounded up to LOGGER_SINK_ALIGNMENT
+  uint64_t max_file_size;    // rotate before a file gets larger, 0 for no limit
+  uint32_t max_file_age;     // seconds, rotate a file that is older, 0 for no limit
+  unsigned int max_files;    // rotated files that are kept, at least 1 when rotating
+  uint32_t flush_latency;    // milliseconds an entry may wait in a buffer, 0 for the default
+  bool use_io_uring;         // submit the writes through io_uring when the kernel has it
+} LoggerSinkConfig;
+
+typedef struct {
+  uint64_t entries;
+  uint64_t bytes;
+  uint64_t dropped_entries;  // the buffers were all full or the entry was larger
+  uint64_t writes;           // system calls that wrote buffers
+  uint64_t rotations;
+  uint64_t write_errors;
+  bool io_uring;             // the writes are submitted through io_uring
+} LoggerSinkStats;
+
+typedef struct {
+  int fd;
+  unsigned int *sq_head;
+  unsigned int *sq_tail;
+  unsigned int *sq_mask;
+  unsigned int *sq_array;
+  unsigned int *cq_head;
+  unsigned int *cq_tail;
+  unsigned int *cq_mask;
+  void *sqes;
+  void *cqes;
+  void *sq_map;
+  size_t sq_map_length;
+  void *cq_map;
+  size_t cq_map_length;
+  size_t sqes_length;
+} LoggerSinkRing;
+
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t sealed;     // a buffer is ready to be written, a flush is requested or the sink stops
+  pthread_cond_t written;    // buffers were written
+
+  char path[LOGGER_SINK_MAX_PATH];
+  LoggerSinkConfig config;
+
+  uint8_t *buffers[LOGGER_SINK_BUFFERS];
+  size_t lengths[LOGGER_SINK_BUFFERS];
+  size_t current;            // buffer that is filled
+  size_t first_sealed;       // oldest buffer that is not written yet
+  size_t sealed_count;
+  uint64_t sealed_total;     // buffers sealed since the start
+  uint64_t written_total;    // buffers written since the start
+  bool flush_requested;
+  bool stopping;
+
+  int fd;                    // only used by the writer thread
+  uint64_t file_size;
+  uint64_t allocated;        // preallocated bytes of the file
+  uint64_t file_opened;      // milliseconds of the monotonic clock
+  LoggerSinkRing ring;
+  bool has_ring;
+
+  LoggerSinkStats stats;
+  pthread_t writer;
+} LoggerSink;
+
+bool logger_sink_init(LoggerSink *sink, const LoggerSinkConfig *config);
+void logger_sink_deinit(LoggerSink *sink);
+
+bool logger_sink_append(LoggerSink *sink, const uint8_t *data, size_t length);
+void logger_sink_flush(LoggerSink *sink);
+void logger_sink_get_stats(LoggerSink *sink, LoggerSinkStats *stats);
+
+void logger_sink_set_active(LoggerSink *sink);
+void logger_sink_write(const uint8_t *data, const size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOGGER_SINK_H_
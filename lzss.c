@@ -35,8 +35,9 @@
  * the dictionary must be always initialized to the same value for compressor
  * and decompressor.
  *
- * this algorithm is optimized for compressing ASCII text. do not use it for
- * binary compression.
+ * this algorithm is optimized for compressing ASCII text. binary input nearly
+ * doubles in size, so lzss_compress_packet writes packets that would not
+ * compress as stored packets (see lzss.h).
  *
  * the output never generates two consequent 0xff bytes and it ignores the same
  * consequence when decompressing. the is achieved by avoiding setting match length
@@ -51,9 +52,43 @@
 #define THRESHOLD 3                       // minimum match length. do not change!
 #define LOOKAHEAD_SIZE ((1 << MATCH_BITS) + THRESHOLD - 2) // lookahead buffer size
 
+#if LOOKAHEAD_SIZE != LZSS_MAX_COPY_LENGTH
+#error "LZSS_MAX_COPY_LENGTH must be the lookahead size"
+#endif
+
 
 #define MINIMUM(_a_,_b_) (((_a_) <= (_b_)) ? (_a_) : (_b_))
 
+
+/*
+ * compression statistics are only counted when the caller passes a stats
+ * structure, which it owns, so compressors in several threads do not share it.
+ */
+#define STATS_ADD(_stats_, _field_, _n_) do { if((_stats_) != NULL) (_stats_)->_field_ += (_n_); } while(0)
+
+static void stats_count_literal(LzssStats *stats, uint8_t c) {
+  if(stats != NULL) {
+    stats->literals ++;
+    if(c & 128) {
+      stats->escaped_literals ++;
+    }
+  }
+}
+
+static void stats_count_copy(LzssStats *stats, size_t tail, unsigned int position, unsigned int match_length) {
+  if(stats != NULL) {
+    unsigned int distance = (tail + DICTIONARY_SIZE - position) % DICTIONARY_SIZE;
+    unsigned int bucket = 0;
+    while(distance) {
+      distance >>= 1;
+      bucket ++;
+    }
+    stats->copies ++;
+    stats->copies_by_length[match_length - THRESHOLD] ++;
+    stats->copies_by_distance[bucket] ++;
+  }
+}
+
 /*
  * functions for writing/reading to/from the byte stream.
  */
@@ -174,13 +209,15 @@ static uint8_t dictionary_get_at(Dictionary *dictionary, unsigned int index) {
   return dictionary->buffer[index % DICTIONARY_SIZE];
 }
 
-static int dictionary_find_longest_match(Dictionary *dictionary, const uint8_t *src, unsigned int max, unsigned int *position) {
+static int dictionary_find_longest_match(Dictionary *dictionary, const uint8_t *src, unsigned int max, unsigned int *position, LzssStats *stats) {
   unsigned int match_length = 0;
   size_t i = dictionary->tail;
   unsigned int c = DICTIONARY_SIZE;
+  unsigned long probes = 0;
   while(c) {
     if(dictionary->buffer[i] == *src) {
       size_t j;
+      probes ++;
       for(j = 1; j < max; j ++) {
         if(dictionary_get_at(dictionary,(i+j)) != src[j]) {
           break;
@@ -197,6 +234,8 @@ static int dictionary_find_longest_match(Dictionary *dictionary, const uint8_t *
     i = i == 0 ? DICTIONARY_SIZE - 1 : i - 1;
     -- c;
   }
+  STATS_ADD(stats, searches, 1);
+  STATS_ADD(stats, probes, probes);
   return match_length;
 }
 
@@ -213,46 +252,77 @@ void lzss_dictionary_init(Dictionary *dictionary) {
 }
 
 /*
- * compress the source and write in destination.
- * do not write more than d_remaining_packet_len.
- * update s_len to the number of unused bytes in the source.
+ * initialize the dictionary and copy the preset to its end, or only initialize
+ * it if preset is NULL.
+ */
+void lzss_dictionary_init_preset(Dictionary *dictionary, const LzssPreset *preset) {
+  lzss_dictionary_init(dictionary);
+  if(preset != NULL) {
+    memcpy(&dictionary->buffer[DICTIONARY_SIZE - preset->length], preset->data, preset->length);
+  }
+}
+
+/*
+ * compress the tokens that start in the first s_len bytes of the source. a
+ * match may continue up to s_window_len bytes, so the source may be consumed
+ * beyond s_len.
+ * update s_consumed_bytes to the number of bytes consumed from the source.
+ * count the statistics in stats if it is not NULL.
  * return the number of bytes written into the destination.
  */
-size_t lzss_compress(Dictionary *dictionary, uint8_t *dst, size_t d_len, const uint8_t *src, size_t s_len, size_t *s_unused_bytes, size_t d_remaining_packet_len) {
+static size_t compress_window(Dictionary *dictionary, uint8_t *dst, size_t d_len, const uint8_t *src, size_t s_len, size_t s_window_len, size_t *s_consumed_bytes, size_t d_remaining_packet_len, LzssStats *stats) {
   const uint8_t *original_dst = dst;
+  const uint8_t *original_src = src;
+  const size_t original_remaining_packet_len = d_remaining_packet_len;
   unsigned int position = 0, match_length = 0, max = 0;
 
   d_len = MINIMUM(d_len, d_remaining_packet_len);
     
   while(s_len > 0) {
     unsigned int len;
-    max = MINIMUM(LOOKAHEAD_SIZE, s_len);
-    match_length = dictionary_find_longest_match(dictionary, src, max, &position);
+    max = MINIMUM(LOOKAHEAD_SIZE, s_window_len);
+    match_length = dictionary_find_longest_match(dictionary, src, max, &position, stats);
 
     if(match_length == 0 || match_length == 1) { // symbol is not in the dictionary or is a literal
       len = write_literal(dst, d_len, *src);
       match_length = 1;
+      if(len != 0) {
+        stats_count_literal(stats, *src);
+      }
     } else if(match_length == 2) { // write two literals instead of a copy
       len = write_two_literals(dst, d_len, *src, *(src + 1));
+      if(len != 0) {
+        STATS_ADD(stats, rejected_matches, 1);
+        stats_count_literal(stats, *src);
+        stats_count_literal(stats, *(src + 1));
+      }
     } else { // match_length >= 3, write a copy
       len = write_copy(dst, d_len, position, match_length);
+      if(len != 0) {
+        stats_count_copy(stats, dictionary->tail, position, match_length);
+      }
     }
 
     if(len == 0) { // not have enough space in the destination or in the packet
       if(d_len <= 3) { // try to add a literal if packet is not completely filled
         len = write_literal(dst, d_len, *src);
         match_length = len == 0 ? 0 : 1;
+        if(len != 0) {
+          stats_count_literal(stats, *src);
+        }
         dst += len;
         d_len -= len;
         d_remaining_packet_len -= len;
         dictionary_copy_from_buffer(dictionary, src, match_length);
         src += match_length;
         s_len -= match_length;
+        s_window_len -= match_length;
       }
       if(d_remaining_packet_len == 1 && d_len >= 1) { // if packet is not filled yet then write a filler
         *dst ++ = 0xff;
         d_len --;
         d_remaining_packet_len --;
+        STATS_ADD(stats, fillers, 1);
       }
       break;
     } else {
@@ -261,17 +331,48 @@ size_t lzss_compress(Dictionary *dictionary, uint8_t *dst, size_t d_len, const u
       d_remaining_packet_len -= len;
       dictionary_copy_from_buffer(dictionary, src, match_length);
       src += match_length;
-      s_len -= match_length;
+      s_len = match_length < s_len ? s_len - match_length : 0;
+      s_window_len -= match_length;
     }
   }
 
-  *s_unused_bytes = s_len;
+  if(original_remaining_packet_len > 0 && d_remaining_packet_len == 0) {
+    STATS_ADD(stats, packets, 1);
+  }
+
+  *s_consumed_bytes = src - original_src;
   return dst - original_dst;
 }
 
+/*
+ * compress the source and write in destination.
+ * do not write more than d_remaining_packet_len.
+ * update s_len to the number of unused bytes in the source.
+ * return the number of bytes written into the destination.
+ */
+size_t lzss_compress(Dictionary *dictionary, uint8_t *dst, size_t d_len, const uint8_t *src, size_t s_len, size_t *s_unused_bytes, size_t d_remaining_packet_len) {
+  return lzss_compress_with_stats(dictionary, dst, d_len, src, s_len, s_unused_bytes, d_remaining_packet_len, NULL);
+}
+
+/*
+ * like lzss_compress and add the compression statistics to stats, which the
+ * caller owns and zeroes before.
+ */
+size_t lzss_compress_with_stats(Dictionary *dictionary, uint8_t *dst, size_t d_len, const uint8_t *src, size_t s_len, size_t *s_unused_bytes, size_t d_remaining_packet_len, LzssStats *stats) {
+  size_t consumed;
+  size_t len = compress_window(dictionary, dst, d_len, src, s_len, s_len, &consumed, d_remaining_packet_len, stats);
+  *s_unused_bytes = s_len - consumed;
+  return len;
+}
+
 /*
  * decompress the source and write in destination.
  * do not decompress more than s_remaining_packet_len.
+ * the source is one stream of tokens: a stored packet is not decoded, the
+ * decompression stops before its header (0xff 0xff 'S') and leaves it unused,
+ * and the packets of a stream with sync markers, which are compressed from a
+ * fresh dictionary each, are not decoded right. use lzss_decompress_packet or
+ * the stream functions for them.
  * update s_unused_bytes to the number of unused bytes in the source.
  * return the number of bytes written into the destination.
  */
@@ -287,6 +388,10 @@ size_t lzss_decompress(Dictionary *dictionary, uint8_t *dst, size_t d_len, const
 
   while(s_len > 0) {
     len = skip_ffff_sequences(src, s_len);
+    if(len >= 2 && len < s_len && src[len] == 'S' && (len + 1 == s_len || src[len + 1] == LZSS_STORED_VERSION)) {
+      bytes_decmopressed += len - 2; // the header of a stored packet
+      break;
+    }
     src += len;
     s_len -= len;
     bytes_decmopressed += len;
@@ -320,3 +425,966 @@ size_t lzss_decompress(Dictionary *dictionary, uint8_t *dst, size_t d_len, const
   *s_unused_bytes = original_s_len - bytes_decmopressed;
   return dst - original_dst;
 }
+
+/*
+ * functions for joining and splitting streams. packets are independent, so
+ * streams with the same packet size and preset are joined by padding the last
+ * packet of every stream but the last one: 0xff 0xff sequences are skipped
+ * and a 0xff at the end of a packet is a filler.
+ */
+
+/*
+ * write the padding that fills a packet of packet_len bytes up to packet_size.
+ * destination has packet_size - packet_len bytes.
+ * return the number of bytes written into the destination.
+ */
+size_t lzss_pad_packet(uint8_t *dst, size_t packet_len, size_t packet_size) {
+  if(packet_len == 0 || packet_len >= packet_size) {
+    return 0;
+  }
+  memset(dst, 0xff, packet_size - packet_len);
+  return packet_size - packet_len;
+}
+
+/*
+ * concatenate compressed streams into destination, padding the last packet of
+ * every stream but the last one.
+ * return the number of bytes written into the destination or zero if they do
+ * not fit.
+ */
+size_t lzss_concatenate(uint8_t *dst, size_t d_len, const LzssConstSegment *streams, size_t count, size_t packet_size) {
+  size_t i, len = 0;
+
+  for(i = 0; i < count; i ++) {
+    size_t padding = i + 1 < count ? (packet_size - streams[i].length % packet_size) % packet_size : 0;
+    if(d_len - len < streams[i].length + padding) {
+      return 0;
+    }
+    memmove(dst + len, streams[i].data, streams[i].length);
+    len += streams[i].length;
+    memset(dst + len, 0xff, padding);
+    len += padding;
+  }
+  return len;
+}
+
+/*
+ * set slice to count packets of the stream starting from packet first. the
+ * slice is shorter if the stream ends before.
+ * return false if the stream has no packet first.
+ */
+bool lzss_slice_packets(const uint8_t *src, size_t s_len, size_t packet_size, size_t first, size_t count, LzssConstSegment *slice) {
+  const size_t packets = (s_len + packet_size - 1) / packet_size;
+  if(first >= packets) {
+    return false;
+  }
+  slice->data = src + first * packet_size;
+  slice->length = MINIMUM(count, packets - first) * packet_size;
+  slice->length = MINIMUM(slice->length, s_len - first * packet_size);
+  return true;
+}
+
+
+
+/*
+ * functions for scattered buffers. the codec works directly on the segments
+ * and only copies the few bytes around a boundary between two segments into a
+ * small staging buffer, so that a token or a match may cross the boundary.
+ */
+
+typedef struct {
+  size_t index;  // current segment
+  size_t offset; // offset in the current segment
+  size_t total;  // bytes from the offset to the end of the last segment
+} SegmentCursor;
+
+/*
+ * move the cursor by n bytes and past the segments that are used up.
+ */
+static void source_cursor_advance(SegmentCursor *cursor, const LzssConstSegment *src, size_t s_count, size_t n) {
+  cursor->total -= n;
+  cursor->offset += n;
+  while(cursor->index < s_count && cursor->offset >= src[cursor->index].length) {
+    cursor->offset -= src[cursor->index].length;
+    cursor->index ++;
+  }
+}
+
+static void destination_cursor_advance(SegmentCursor *cursor, const LzssSegment *dst, size_t d_count, size_t n) {
+  cursor->total -= n;
+  cursor->offset += n;
+  while(cursor->index < d_count && cursor->offset >= dst[cursor->index].length) {
+    cursor->offset -= dst[cursor->index].length;
+    cursor->index ++;
+  }
+}
+
+static void source_cursor_init(SegmentCursor *cursor, const LzssConstSegment *src, size_t s_count) {
+  size_t i;
+  cursor->index = 0;
+  cursor->offset = 0;
+  cursor->total = 0;
+  for(i = 0; i < s_count; i ++) {
+    cursor->total += src[i].length;
+  }
+  source_cursor_advance(cursor, src, s_count, 0);
+}
+
+static void destination_cursor_init(SegmentCursor *cursor, const LzssSegment *dst, size_t d_count) {
+  size_t i;
+  cursor->index = 0;
+  cursor->offset = 0;
+  cursor->total = 0;
+  for(i = 0; i < d_count; i ++) {
+    cursor->total += dst[i].length;
+  }
+  destination_cursor_advance(cursor, dst, d_count, 0);
+}
+
+/*
+ * copy up to n bytes of the source from the cursor into buffer without moving
+ * the cursor. return the number of bytes copied.
+ */
+static size_t segments_gather(const LzssConstSegment *src, size_t s_count, const SegmentCursor *cursor, uint8_t *buffer, size_t n) {
+  size_t i = cursor->index, offset = cursor->offset, len = 0;
+  while(len < n && i < s_count) {
+    size_t k = MINIMUM(n - len, src[i].length - offset);
+    memcpy(buffer + len, src[i].data + offset, k);
+    len += k;
+    offset = 0;
+    i ++;
+  }
+  return len;
+}
+
+/*
+ * copy n bytes from buffer into the destination from the cursor.
+ */
+static void segments_scatter(const LzssSegment *dst, size_t d_count, const SegmentCursor *cursor, const uint8_t *buffer, size_t n) {
+  size_t i = cursor->index, offset = cursor->offset;
+  while(n > 0 && i < d_count) {
+    size_t k = MINIMUM(n, dst[i].length - offset);
+    memcpy(dst[i].data + offset, buffer, k);
+    buffer += k;
+    n -= k;
+    offset = 0;
+    i ++;
+  }
+}
+
+/*
+ * like lzss_compress but the source and the destination are arrays of
+ * segments.
+ */
+size_t lzss_compressv(Dictionary *dictionary, const LzssSegment *dst, size_t d_count, const LzssConstSegment *src, size_t s_count, size_t *s_unused_bytes, size_t d_remaining_packet_len) {
+  uint8_t s_staging[2 * LOOKAHEAD_SIZE];
+  uint8_t d_staging[4]; // two non-ASCII literals
+  SegmentCursor s_cursor, d_cursor;
+  size_t written = 0;
+
+  source_cursor_init(&s_cursor, src, s_count);
+  destination_cursor_init(&d_cursor, dst, d_count);
+
+  while(s_cursor.total > 0 && d_cursor.total > 0) {
+    const uint8_t *window;
+    size_t s_len, window_len, d_len, consumed, len;
+    uint8_t *out;
+
+    // tokens start in the current segment and matches may continue in the next ones
+    size_t rest = src[s_cursor.index].length - s_cursor.offset;
+    if(rest >= LOOKAHEAD_SIZE || rest == s_cursor.total) {
+      window = src[s_cursor.index].data + s_cursor.offset;
+      window_len = rest;
+    } else {
+      window_len = segments_gather(src, s_count, &s_cursor, s_staging, rest + LOOKAHEAD_SIZE - 1);
+      window = s_staging;
+    }
+    s_len = window_len == s_cursor.total ? window_len : window_len - (LOOKAHEAD_SIZE - 1);
+
+    rest = dst[d_cursor.index].length - d_cursor.offset;
+    if(rest >= sizeof(d_staging) || rest == d_cursor.total) {
+      out = dst[d_cursor.index].data + d_cursor.offset;
+      d_len = rest;
+    } else {
+      out = d_staging;
+      d_len = MINIMUM(sizeof(d_staging), d_cursor.total);
+    }
+
+    len = compress_window(dictionary, out, d_len, window, s_len, window_len, &consumed, d_remaining_packet_len, NULL);
+    if(out == d_staging) {
+      segments_scatter(dst, d_count, &d_cursor, d_staging, len);
+    }
+    source_cursor_advance(&s_cursor, src, s_count, consumed);
+    destination_cursor_advance(&d_cursor, dst, d_count, len);
+    d_remaining_packet_len -= len;
+    written += len;
+    if(d_remaining_packet_len == 0 || (consumed == 0 && len == 0)) {
+      break;
+    }
+  }
+
+  *s_unused_bytes = s_cursor.total;
+  return written;
+}
+
+/*
+ * like lzss_decompress but the source and the destination are arrays of
+ * segments. it also stops before the header of a stored packet that is split
+ * between segments.
+ */
+size_t lzss_decompressv(Dictionary *dictionary, const LzssSegment *dst, size_t d_count, const LzssConstSegment *src, size_t s_count, size_t *s_unused_bytes, size_t s_remaining_packet_len) {
+  uint8_t s_staging[2];
+  uint8_t d_staging[LOOKAHEAD_SIZE];
+  SegmentCursor s_cursor, d_cursor;
+  size_t written = 0;
+
+  source_cursor_init(&s_cursor, src, s_count);
+  destination_cursor_init(&d_cursor, dst, d_count);
+
+  while(s_cursor.total > 0 && s_remaining_packet_len > 0) {
+    const uint8_t *window;
+    size_t s_len, d_len, unused, len;
+    uint8_t *out;
+
+    // a token that is split between two segments is staged
+    size_t rest = src[s_cursor.index].length - s_cursor.offset;
+    if(rest >= 2 || rest == s_cursor.total) {
+      window = src[s_cursor.index].data + s_cursor.offset;
+      s_len = rest;
+    } else {
+      s_len = segments_gather(src, s_count, &s_cursor, s_staging, sizeof(s_staging));
+      window = s_staging;
+    }
+
+    rest = d_cursor.total > 0 ? dst[d_cursor.index].length - d_cursor.offset : 0;
+    if(rest >= sizeof(d_staging) || rest == d_cursor.total) {
+      out = rest > 0 ? dst[d_cursor.index].data + d_cursor.offset : d_staging;
+      d_len = rest;
+    } else {
+      out = d_staging;
+      d_len = MINIMUM(sizeof(d_staging), d_cursor.total);
+    }
+
+    len = lzss_decompress(dictionary, out, d_len, window, s_len, &unused, s_remaining_packet_len);
+    if(out == d_staging) {
+      segments_scatter(dst, d_count, &d_cursor, d_staging, len);
+    }
+    size_t consumed = s_len - unused;
+    bool stored = false;
+    if(unused == 0 && s_len >= 2 && window[s_len - 2] == 0xff && window[s_len - 1] == 0xff) {
+      // the window ends with a skipped 0xff 0xff, which may start a stored packet in the next segment
+      SegmentCursor next = s_cursor;
+      uint8_t header[2];
+      source_cursor_advance(&next, src, s_count, s_len);
+      const size_t n = segments_gather(src, s_count, &next, header, sizeof(header));
+      if(n >= 1 && header[0] == 'S' && (n == 1 || header[1] == LZSS_STORED_VERSION)) {
+        consumed -= 2;
+        stored = true;
+      }
+    }
+    source_cursor_advance(&s_cursor, src, s_count, consumed);
+    destination_cursor_advance(&d_cursor, dst, d_count, len);
+    s_remaining_packet_len -= MINIMUM(consumed, s_remaining_packet_len);
+    written += len;
+    if(stored || (consumed == 0 && len == 0)) {
+      break;
+    }
+  }
+
+  *s_unused_bytes = s_cursor.total;
+  return written;
+}
+
+
+
+/*
+ * functions for records. every record is compressed independently, starting
+ * from the same snapshot of a dictionary. the snapshot is never copied: the
+ * bytes of the record are kept at their positions in a separate buffer and
+ * the snapshot is read where the record has not written yet.
+ */
+
+typedef struct {
+  const Dictionary *snapshot;
+  uint8_t buffer[DICTIONARY_SIZE];
+  size_t tail;
+  size_t length; // bytes of the record in the buffer
+} RecordDictionary;
+
+static void record_dictionary_init(RecordDictionary *dictionary, const Dictionary *snapshot) {
+  dictionary->snapshot = snapshot;
+  dictionary->tail = snapshot->tail;
+  dictionary->length = 0;
+}
+
+static uint8_t record_dictionary_get_at(const RecordDictionary *dictionary, unsigned int index) {
+  index %= DICTIONARY_SIZE;
+  if((index - dictionary->snapshot->tail - 1) % DICTIONARY_SIZE < dictionary->length) {
+    return dictionary->buffer[index];
+  }
+  return dictionary->snapshot->buffer[index];
+}
+
+static void record_dictionary_copy_from_buffer(RecordDictionary *dictionary, const uint8_t *s, unsigned int n) {
+  while(n) {
+    dictionary->tail = (dictionary->tail + 1) % DICTIONARY_SIZE;
+    dictionary->buffer[dictionary->tail] = *s ++;
+    if(dictionary->length < DICTIONARY_SIZE) {
+      dictionary->length ++;
+    }
+    -- n;
+  }
+}
+
+static void record_dictionary_copy_to_buffer(const RecordDictionary *dictionary, uint8_t *buf, unsigned int position, unsigned int n) {
+  while(n) {
+    *buf ++ = record_dictionary_get_at(dictionary, position ++);
+    -- n;
+  }
+}
+
+/*
+ * the same search as dictionary_find_longest_match.
+ */
+static unsigned int record_dictionary_find_longest_match(const RecordDictionary *dictionary, const uint8_t *src, unsigned int max, unsigned int *position) {
+  unsigned int match_length = 0;
+  size_t i = dictionary->tail;
+  unsigned int c = DICTIONARY_SIZE;
+  while(c) {
+    if(record_dictionary_get_at(dictionary, (unsigned int) i) == *src) {
+      unsigned int j;
+      for(j = 1; j < max; j ++) {
+        if(record_dictionary_get_at(dictionary, (unsigned int) (i + j)) != src[j]) {
+          break;
+        }
+      }
+      if(j > match_length) {
+        *position = (unsigned int) i;
+        match_length = j;
+      }
+      if(j == max) {
+        break;
+      }
+    }
+    i = i == 0 ? DICTIONARY_SIZE - 1 : i - 1;
+    -- c;
+  }
+  return match_length;
+}
+
+/*
+ * compress a whole record like lzss_compress does without packets.
+ * return the number of bytes written into the destination or zero if the
+ * record does not fit.
+ */
+static size_t compress_record(RecordDictionary *dictionary, uint8_t *dst, size_t d_len, const uint8_t *src, size_t s_len) {
+  const uint8_t *original_dst = dst;
+  unsigned int position = 0, match_length;
+
+  while(s_len > 0) {
+    size_t len;
+    match_length = record_dictionary_find_longest_match(dictionary, src, MINIMUM(LOOKAHEAD_SIZE, s_len), &position);
+    if(match_length <= 1) {
+      len = write_literal(dst, d_len, *src);
+      match_length = 1;
+    } else if(match_length == 2) {
+      len = write_two_literals(dst, d_len, src[0], src[1]);
+    } else {
+      len = write_copy(dst, d_len, position, match_length);
+    }
+    if(len == 0) {
+      return 0;
+    }
+    record_dictionary_copy_from_buffer(dictionary, src, match_length);
+    dst += len;
+    d_len -= len;
+    src += match_length;
+    s_len -= match_length;
+  }
+  return dst - original_dst;
+}
+
+/*
+ * compress every record independently starting from the snapshot, which is
+ * usually initialized with lzss_dictionary_init_preset. record i is written at
+ * offsets[i] and ends at offsets[i + 1], so offsets has count + 1 elements.
+ * return the number of records that are written; the records that follow do
+ * not fit in the destination.
+ */
+size_t lzss_compress_records(const Dictionary *snapshot, uint8_t *dst, size_t d_len, const LzssConstSegment *records, size_t count, size_t *offsets) {
+  RecordDictionary dictionary;
+  size_t i, len = 0;
+
+  offsets[0] = 0;
+  for(i = 0; i < count; i ++) {
+    record_dictionary_init(&dictionary, snapshot);
+    size_t n = compress_record(&dictionary, dst + len, d_len - len, records[i].data, records[i].length);
+    if(n == 0 && records[i].length > 0) {
+      break;
+    }
+    len += n;
+    offsets[i + 1] = len;
+  }
+  return i;
+}
+
+/*
+ * decompress a single record that is compressed by lzss_compress_records with
+ * the same snapshot.
+ * return the number of bytes written into the destination, which stops at the
+ * first copy that does not fit.
+ */
+size_t lzss_decompress_record(const Dictionary *snapshot, uint8_t *dst, size_t d_len, const uint8_t *src, size_t s_len) {
+  RecordDictionary dictionary;
+  const uint8_t *original_dst = dst;
+  unsigned int position, match_length, len;
+  uint8_t character;
+
+  record_dictionary_init(&dictionary, snapshot);
+  while(s_len > 0) {
+    len = skip_ffff_sequences(src, s_len);
+    src += len;
+    s_len -= len;
+    len = read_literal_or_copy(src, s_len, &character, &position, &match_length);
+    if(len == 0 || match_length == 0 || d_len < match_length) {
+      break;
+    }
+    if(len == 1 || match_length == 1) { // literal
+      *dst = character;
+    } else { // copy
+      record_dictionary_copy_to_buffer(&dictionary, dst, position, match_length);
+    }
+    record_dictionary_copy_from_buffer(&dictionary, dst, match_length);
+    src += len;
+    s_len -= len;
+    dst += match_length;
+    d_len -= match_length;
+  }
+  return dst - original_dst;
+}
+
+
+
+static bool is_sync_marker(const uint8_t *src) {
+  return src[0] == 0xff && src[1] == 0xff && src[2] == 0xff && src[3] == 0xff;
+}
+
+/*
+ * return true if a packet of a stream with sync markers may start at source.
+ */
+static bool is_packet_start(const uint8_t *src, size_t s_len) {
+  return s_len >= LZSS_SYNC_MARKER_SIZE && src[0] == 0xff && src[1] == 0xff
+      && ((src[2] == 0xff && src[3] == 0xff) || (src[2] == 'S' && src[3] == LZSS_STORED_VERSION));
+}
+
+/*
+ * return the offset of the first packet of a stream with sync markers, which
+ * is confirmed by the start of the next packet, or s_len if there is none.
+ * a compressed packet starts with the sync marker and a stored packet with its
+ * header. the sync marker may follow a filler or padding and a packet may
+ * start with a 0xff token, so there are a few candidates for every run of
+ * 0xff bytes.
+ */
+size_t lzss_find_packet(const uint8_t *src, size_t s_len, size_t packet_size) {
+  const uint8_t *pos = src;
+  const uint8_t *end = src + s_len;
+
+  while((pos = (const uint8_t *) memchr(pos, 0xff, end - pos)) != NULL) {
+    const uint8_t *run_end = pos;
+    while(run_end < end && *run_end == 0xff) {
+      run_end ++;
+    }
+    const size_t run_len = run_end - pos;
+    const size_t candidates[] = { 2, LZSS_SYNC_MARKER_SIZE, LZSS_SYNC_MARKER_SIZE + 1 };
+    size_t i;
+    for(i = 0; i < sizeof(candidates) / sizeof(candidates[0]); i ++) {
+      if(run_len < candidates[i]) {
+        continue;
+      }
+      const size_t offset = run_end - candidates[i] - src;
+      if(is_packet_start(src + offset, s_len - offset) && (offset + packet_size >= s_len
+          || is_packet_start(src + offset + packet_size, s_len - offset - packet_size))) {
+        return offset;
+      }
+    }
+    pos = run_end;
+  }
+  return s_len;
+}
+
+/*
+ * return true if the header starts a stored packet and set the length of its
+ * data. header has LZSS_STORED_HEADER_SIZE bytes.
+ */
+static bool read_stored_header(const uint8_t *header, size_t packet_size, size_t *length) {
+  if(header[0] != 0xff || header[1] != 0xff || header[2] != 'S' || header[3] != LZSS_STORED_VERSION) {
+    return false;
+  }
+  *length = header[4] | (header[5] << 8);
+  return packet_size == 0 || *length <= packet_size - LZSS_STORED_HEADER_SIZE;
+}
+
+/*
+ * compress a single packet starting from a freshly initialized dictionary with
+ * the given preset, which may be NULL. if the packet would hold less of the
+ * source than a stored packet, write a stored packet instead. if sync is true,
+ * a compressed packet starts with a sync marker, so that lzss_find_packet can
+ * find the packets of a damaged stream.
+ * destination has packet_size bytes. the packet is filled unless the source
+ * runs out, so the source must hold the rest of the input or at least
+ * LZSS_MAX_DECOMPRESSED_SIZE(packet_size) bytes.
+ * update s_unused_bytes to the number of unused bytes in the source.
+ * add the compression statistics to stats if it is not NULL; those of a
+ * packet that is stored are only its packet counts.
+ * return the number of bytes written into the destination.
+ */
+size_t lzss_compress_packet(const LzssPreset *preset, uint8_t *dst, size_t packet_size, const uint8_t *src, size_t s_len, size_t *s_unused_bytes, bool sync, LzssStats *stats) {
+  const size_t marker_len = sync ? LZSS_SYNC_MARKER_SIZE : 0;
+  Dictionary dictionary;
+  LzssStats saved;
+  size_t len;
+
+  assert(packet_size > LZSS_STORED_HEADER_SIZE && packet_size - LZSS_STORED_HEADER_SIZE <= 0xffff);
+  if(stats != NULL) {
+    saved = *stats;
+  }
+
+  memset(dst, 0xff, marker_len);
+  lzss_dictionary_init_preset(&dictionary, preset);
+  len = marker_len + lzss_compress_with_stats(&dictionary, dst + marker_len, packet_size - marker_len, src, s_len, s_unused_bytes, packet_size - marker_len, stats);
+
+  const size_t consumed = s_len - *s_unused_bytes;
+  const size_t stored_consumed = MINIMUM(s_len, packet_size - LZSS_STORED_HEADER_SIZE);
+  if(consumed > stored_consumed || (consumed == stored_consumed && len <= stored_consumed + LZSS_STORED_HEADER_SIZE)) {
+    return len;
+  }
+
+  if(stats != NULL) {
+    *stats = saved;
+  }
+  STATS_ADD(stats, stored_packets, 1);
+  if(stored_consumed == packet_size - LZSS_STORED_HEADER_SIZE) {
+    STATS_ADD(stats, packets, 1);
+  }
+  dst[0] = 0xff;
+  dst[1] = 0xff;
+  dst[2] = 'S';
+  dst[3] = LZSS_STORED_VERSION;
+  dst[4] = (uint8_t) stored_consumed;
+  dst[5] = (uint8_t) (stored_consumed >> 8);
+  memcpy(dst + LZSS_STORED_HEADER_SIZE, src, stored_consumed);
+  *s_unused_bytes = s_len - stored_consumed;
+  return stored_consumed + LZSS_STORED_HEADER_SIZE;
+}
+
+/*
+ * decompress a single packet starting from a freshly initialized dictionary
+ * with the given preset, which may be NULL.
+ * s_len is the length of the packet (the last packet of a stream may be
+ * shorter than the packet size).
+ * return the number of bytes written into the destination.
+ */
+size_t lzss_decompress_packet(const LzssPreset *preset, uint8_t *dst, size_t d_len, const uint8_t *src, size_t s_len) {
+  Dictionary dictionary;
+  size_t s_unused_bytes, length;
+
+  if(s_len >= 2 && src[0] == 0xff && src[1] == 0xff && !(s_len >= LZSS_SYNC_MARKER_SIZE && is_sync_marker(src))) { // a stored packet
+    if(s_len < LZSS_STORED_HEADER_SIZE || !read_stored_header(src, s_len, &length)) {
+      return 0;
+    }
+    length = MINIMUM(length, d_len);
+    memcpy(dst, src + LZSS_STORED_HEADER_SIZE, length);
+    return length;
+  }
+
+  lzss_dictionary_init_preset(&dictionary, preset);
+  return lzss_decompress(&dictionary, dst, d_len, src, s_len, &s_unused_bytes, s_len);
+}
+
+
+
+/*
+ * functions for decompressing a stream.
+ */
+
+static size_t stream_flush_output(LzssStream *stream, uint8_t *dst, size_t d_len) {
+  size_t n = MINIMUM(d_len, stream->output_length - stream->output_position);
+  memcpy(dst, &stream->output[stream->output_position], n);
+  stream->output_position += n;
+  return n;
+}
+
+/*
+ * write the output of a copy to the destination or keep what does not fit.
+ * return the number of bytes written into the destination.
+ */
+static size_t stream_write_copy(LzssStream *stream, uint8_t *dst, size_t d_len, unsigned int position, unsigned int match_length) {
+  if(d_len >= match_length) {
+    dictionary_copy_to_buffer(&stream->dictionary, dst, position, match_length);
+    dictionary_copy_from_buffer(&stream->dictionary, dst, match_length);
+    return match_length;
+  }
+  dictionary_copy_to_buffer(&stream->dictionary, stream->output, position, match_length);
+  dictionary_copy_from_buffer(&stream->dictionary, stream->output, match_length);
+  stream->output_position = 0;
+  stream->output_length = match_length;
+  return stream_flush_output(stream, dst, d_len);
+}
+
+/*
+ * packet_size must be the packet size of the compressor or zero if it does not
+ * split its output into packets. the preset may be NULL.
+ */
+void lzss_stream_init(LzssStream *stream, const LzssPreset *preset, size_t packet_size) {
+  lzss_dictionary_init_preset(&stream->dictionary, preset);
+  stream->preset = preset;
+  stream->packet_size = packet_size;
+  stream->packet_position = 0;
+  stream->has_token = false;
+  stream->output_position = 0;
+  stream->output_length = 0;
+  stream->stored_header_length = 0;
+  stream->stored_length = 0;
+}
+
+/*
+ * consume the bytes of a stored packet, which are copied as they are.
+ * return the number of bytes consumed from the source.
+ */
+static size_t stream_read_stored(LzssStream *stream, uint8_t *dst, size_t d_len, const uint8_t *src, size_t s_len, size_t *d_written) {
+  size_t n = MINIMUM(s_len, stream->packet_size - stream->packet_position);
+  *d_written = 0;
+
+  if(stream->stored_header_length < LZSS_STORED_HEADER_SIZE) {
+    // read the sync marker first, which is as long as the start of the header
+    const size_t header_len = stream->stored_header_length < LZSS_SYNC_MARKER_SIZE ? LZSS_SYNC_MARKER_SIZE : LZSS_STORED_HEADER_SIZE;
+    n = MINIMUM(n, header_len - stream->stored_header_length);
+    memcpy(&stream->stored_header[stream->stored_header_length], src, n);
+    stream->stored_header_length += n;
+    if(stream->stored_header_length == LZSS_SYNC_MARKER_SIZE && is_sync_marker(stream->stored_header)) {
+      stream->stored_header_length = 0; // the tokens of a compressed packet follow
+    } else if(stream->stored_header_length == LZSS_STORED_HEADER_SIZE
+        && !read_stored_header(stream->stored_header, stream->packet_size, &stream->stored_length)) {
+      stream->stored_length = 0; // skip an unknown packet
+    }
+  } else if(stream->stored_length > 0) {
+    n = MINIMUM(MINIMUM(n, d_len), stream->stored_length);
+    memcpy(dst, src, n);
+    stream->stored_length -= n;
+    *d_written = n;
+  }
+  stream->packet_position += n;
+
+  if(stream->packet_position == stream->packet_size) {
+    lzss_dictionary_init_preset(&stream->dictionary, stream->preset);
+    stream->packet_position = 0;
+    stream->stored_header_length = 0;
+    stream->stored_length = 0;
+  }
+  return n;
+}
+
+/*
+ * decompress the source and write in destination. the source is consumed until
+ * it is empty or the destination is full, and the caller continues from the
+ * first byte that is not consumed. the output of the last copy may be kept in
+ * the stream; call again with an empty source to get it.
+ * update s_consumed_bytes to the number of bytes consumed from the source.
+ * return the number of bytes written into the destination.
+ */
+size_t lzss_stream_decompress(LzssStream *stream, uint8_t *dst, size_t d_len, const uint8_t *src, size_t s_len, size_t *s_consumed_bytes) {
+  const uint8_t *original_dst = dst;
+  const uint8_t *original_src = src;
+  size_t len;
+
+  len = stream_flush_output(stream, dst, d_len);
+  dst += len;
+  d_len -= len;
+
+  while(d_len > 0 && s_len > 0) {
+    if(stream->stored_header_length > 0) {
+      size_t n = stream_read_stored(stream, dst, d_len, src, s_len, &len);
+      src += n;
+      s_len -= n;
+      dst += len;
+      d_len -= len;
+      continue;
+    }
+
+    const uint8_t c = *src ++;
+    s_len --;
+    stream->packet_position ++;
+    const bool packet_end = stream->packet_size != 0 && stream->packet_position == stream->packet_size;
+
+    if(stream->has_token) {
+      const uint8_t c1 = stream->token;
+      stream->has_token = false;
+      if(c1 == 0xff && c == 0xff) {
+        if(stream->packet_size != 0 && stream->packet_position == 2 && !packet_end) { // a stored packet
+          stream->stored_header[0] = stream->stored_header[1] = 0xff;
+          stream->stored_header_length = 2;
+          continue;
+        }
+        // skip the sequence
+      } else if((c & 0x0f) == 15) { // non-ASCII literal
+        *dst = c1;
+        dictionary_copy_from_buffer(&stream->dictionary, &c1, 1);
+        dst ++;
+        d_len --;
+      } else { // copy
+        unsigned int position = ((c1 & 127) << 4) | ((c & 0x0f0) >> 4);
+        len = stream_write_copy(stream, dst, d_len, position, (c & 0x0f) + THRESHOLD);
+        dst += len;
+        d_len -= len;
+      }
+    } else if(c & 128) {
+      if(!packet_end) { // otherwise it is a filler
+        stream->token = c;
+        stream->has_token = true;
+      }
+    } else { // literal
+      *dst = c;
+      dictionary_copy_from_buffer(&stream->dictionary, &c, 1);
+      dst ++;
+      d_len --;
+    }
+
+    if(packet_end) {
+      lzss_dictionary_init_preset(&stream->dictionary, stream->preset);
+      stream->packet_position = 0;
+    }
+  }
+
+  *s_consumed_bytes = src - original_src;
+  return dst - original_dst;
+}
+
+/*
+ * return the number of decompressed bytes that are kept in the stream.
+ */
+size_t lzss_stream_pending(const LzssStream *stream) {
+  return stream->output_length - stream->output_position;
+}
+
+
+
+/*
+ * functions for creating and serializing presets.
+ */
+
+#define PRESET_DMER_SIZE 6     // length of the substrings that are counted
+#define PRESET_SEGMENT_SIZE 32 // length of the segments that are selected
+#define PRESET_HASH_BITS 16
+
+static const uint8_t PRESET_MAGIC[4] = { 'L', 'Z', 'P', 'D' };
+
+static uint32_t preset_checksum(const uint8_t *data, size_t length) {
+  uint32_t h = 2166136261u; // FNV-1a
+  while(length --) {
+    h ^= *data ++;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static unsigned int preset_hash_dmer(const uint8_t *s) {
+  uint32_t h = 0;
+  int i;
+  for(i = 0; i < PRESET_DMER_SIZE; i ++) {
+    h = (h ^ s[i]) * 16777619u;
+  }
+  return h >> (32 - PRESET_HASH_BITS);
+}
+
+static void preset_write_u32(uint8_t *dst, uint32_t value) {
+  dst[0] = (uint8_t) value;
+  dst[1] = (uint8_t) (value >> 8);
+  dst[2] = (uint8_t) (value >> 16);
+  dst[3] = (uint8_t) (value >> 24);
+}
+
+static uint32_t preset_read_u32(const uint8_t *src) {
+  return src[0] | (src[1] << 8) | (src[2] << 16) | ((uint32_t) src[3] << 24);
+}
+
+/*
+ * use the last DICTIONARY_SIZE bytes of data as the preset.
+ */
+void lzss_preset_init(LzssPreset *preset, const uint8_t *data, size_t length) {
+  if(length > DICTIONARY_SIZE) {
+    data += length - DICTIONARY_SIZE;
+    length = DICTIONARY_SIZE;
+  }
+  memcpy(preset->data, data, length);
+  preset->length = length;
+  preset->id = preset_checksum(preset->data, preset->length);
+}
+
+/*
+ * build a preset from sample logs. the samples are split into one epoch per
+ * segment of the preset and the segment of each epoch whose substrings are the
+ * most frequent in all the samples is selected. the substrings of a selected
+ * segment do not count for the next selections.
+ * return false if there is not enough memory.
+ */
+bool lzss_preset_build(LzssPreset *preset, const uint8_t *samples, size_t s_len) {
+  const size_t segments = DICTIONARY_SIZE / PRESET_SEGMENT_SIZE;
+  uint16_t *counts;
+  size_t i, epoch, length = 0;
+
+  if(s_len <= DICTIONARY_SIZE) {
+    lzss_preset_init(preset, samples, s_len);
+    return true;
+  }
+
+  counts = (uint16_t *) calloc(1 << PRESET_HASH_BITS, sizeof(uint16_t));
+  if(counts == NULL) {
+    return false;
+  }
+  for(i = 0; i + PRESET_DMER_SIZE <= s_len; i ++) {
+    unsigned int h = preset_hash_dmer(&samples[i]);
+    if(counts[h] < 0xffff) counts[h] ++;
+  }
+
+  const size_t epoch_size = s_len / segments;
+  for(epoch = 0; epoch < segments; epoch ++) {
+    const uint8_t *start = &samples[epoch * epoch_size];
+    const size_t dmers = epoch_size - PRESET_DMER_SIZE + 1;
+    const size_t window = PRESET_SEGMENT_SIZE - PRESET_DMER_SIZE + 1;
+    unsigned long score = 0, best_score = 0;
+    size_t best = 0;
+
+    if(epoch_size < PRESET_SEGMENT_SIZE) {
+      break;
+    }
+    for(i = 0; i < dmers; i ++) { // slide a window of dmers over the epoch
+      score += counts[preset_hash_dmer(&start[i])];
+      if(i >= window) {
+        score -= counts[preset_hash_dmer(&start[i - window])];
+      }
+      if(i + 1 >= window && score > best_score) {
+        best_score = score;
+        best = i + 1 - window;
+      }
+    }
+    for(i = 0; i < window; i ++) {
+      counts[preset_hash_dmer(&start[best + i])] = 0;
+    }
+    memcpy(&preset->data[length], &start[best], PRESET_SEGMENT_SIZE);
+    length += PRESET_SEGMENT_SIZE;
+  }
+  free(counts);
+
+  preset->length = length;
+  preset->id = preset_checksum(preset->data, preset->length);
+  return true;
+}
+
+/*
+ * serialize the preset with a header that has its version, id and length.
+ * return the number of bytes written or zero if destination is too small.
+ */
+size_t lzss_preset_write(const LzssPreset *preset, uint8_t *dst, size_t d_len) {
+  if(d_len < LZSS_PRESET_HEADER_SIZE + preset->length) {
+    return 0;
+  }
+  memset(dst, 0, LZSS_PRESET_HEADER_SIZE);
+  memcpy(dst, PRESET_MAGIC, sizeof(PRESET_MAGIC));
+  dst[4] = LZSS_PRESET_VERSION;
+  preset_write_u32(dst + 8, preset->id);
+  preset_write_u32(dst + 12, (uint32_t) preset->length);
+  memcpy(dst + LZSS_PRESET_HEADER_SIZE, preset->data, preset->length);
+  return LZSS_PRESET_HEADER_SIZE + preset->length;
+}
+
+/*
+ * return false if the source is not a valid serialized preset.
+ */
+bool lzss_preset_read(LzssPreset *preset, const uint8_t *src, size_t s_len) {
+  if(s_len < LZSS_PRESET_HEADER_SIZE || memcmp(src, PRESET_MAGIC, sizeof(PRESET_MAGIC))
+      || src[4] != LZSS_PRESET_VERSION) {
+    return false;
+  }
+  const uint32_t id = preset_read_u32(src + 8);
+  const size_t length = preset_read_u32(src + 12);
+  if(length > DICTIONARY_SIZE || s_len < LZSS_PRESET_HEADER_SIZE + length) {
+    return false;
+  }
+  lzss_preset_init(preset, src + LZSS_PRESET_HEADER_SIZE, length);
+  return preset->id == id;
+}
+
+
+
+/*
+ * functions for checkpoints of streams.
+ */
+
+static const uint8_t CHECKPOINT_MAGIC[4] = { 'L', 'Z', 'C', 'K' };
+
+/*
+ * serialize the state of the stream.
+ * return LZSS_CHECKPOINT_SIZE or zero if the destination is too small.
+ */
+size_t lzss_stream_save(const LzssStream *stream, uint8_t *dst, size_t d_len) {
+  const size_t pending = lzss_stream_pending(stream);
+
+  if(d_len < LZSS_CHECKPOINT_SIZE) {
+    return 0;
+  }
+  memset(dst, 0, LZSS_CHECKPOINT_HEADER_SIZE);
+  memcpy(dst, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+  dst[4] = LZSS_CHECKPOINT_VERSION;
+  dst[5] = stream->has_token;
+  dst[6] = stream->token;
+  dst[7] = (uint8_t) stream->stored_header_length;
+  preset_write_u32(dst + 8, stream->preset ? stream->preset->id : 0);
+  preset_write_u32(dst + 12, (uint32_t) stream->packet_size);
+  preset_write_u32(dst + 16, (uint32_t) stream->packet_position);
+  preset_write_u32(dst + 20, (uint32_t) stream->stored_length);
+  preset_write_u32(dst + 24, (uint32_t) stream->dictionary.tail);
+  dst[28] = stream->preset != NULL;
+  dst[29] = (uint8_t) pending;
+  memcpy(dst + 30, stream->stored_header, LZSS_STORED_HEADER_SIZE);
+  memcpy(dst + 36, stream->output + stream->output_position, pending);
+  memcpy(dst + LZSS_CHECKPOINT_HEADER_SIZE, stream->dictionary.buffer, DICTIONARY_SIZE);
+  preset_write_u32(dst + LZSS_CHECKPOINT_HEADER_SIZE + DICTIONARY_SIZE,
+      preset_checksum(dst, LZSS_CHECKPOINT_HEADER_SIZE + DICTIONARY_SIZE));
+  return LZSS_CHECKPOINT_SIZE;
+}
+
+/*
+ * restore the state of the stream from a checkpoint. the preset must be the one
+ * that the saved stream used.
+ * return false if the checkpoint is not valid or the preset is different.
+ */
+bool lzss_stream_restore(LzssStream *stream, const LzssPreset *preset, const uint8_t *src, size_t s_len) {
+  if(s_len < LZSS_CHECKPOINT_SIZE || memcmp(src, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC))
+      || src[4] != LZSS_CHECKPOINT_VERSION
+      || preset_read_u32(src + LZSS_CHECKPOINT_HEADER_SIZE + DICTIONARY_SIZE) != preset_checksum(src, LZSS_CHECKPOINT_HEADER_SIZE + DICTIONARY_SIZE)) {
+    return false;
+  }
+  if(src[28] != (preset != NULL) || (preset != NULL && preset_read_u32(src + 8) != preset->id)) {
+    return false;
+  }
+  const size_t packet_size = preset_read_u32(src + 12);
+  const size_t packet_position = preset_read_u32(src + 16);
+  const size_t tail = preset_read_u32(src + 24);
+  if((packet_size != 0 && packet_position >= packet_size) || tail >= DICTIONARY_SIZE
+      || src[7] > LZSS_STORED_HEADER_SIZE || src[29] > LZSS_MAX_COPY_LENGTH) {
+    return false;
+  }
+
+  lzss_stream_init(stream, preset, packet_size);
+  stream->packet_position = packet_position;
+  stream->has_token = src[5] != 0;
+  stream->token = src[6];
+  stream->stored_header_length = src[7];
+  stream->stored_length = preset_read_u32(src + 20);
+  memcpy(stream->stored_header, src + 30, LZSS_STORED_HEADER_SIZE);
+  stream->output_length = src[29];
+  memcpy(stream->output, src + 36, stream->output_length);
+  memcpy(stream->dictionary.buffer, src + LZSS_CHECKPOINT_HEADER_SIZE, DICTIONARY_SIZE);
+  stream->dictionary.tail = tail;
+  return true;
+}
@@ -9,6 +9,7 @@ extern "C" {
 #include <stdlib.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdbool.h>
 
 /*
  * do not change these values or otherwise older logs won't be readable in new
@@ -22,11 +23,138 @@ typedef struct {
   size_t tail;
 } Dictionary;
 
+/*
+ * a preset is copied to the end of the dictionary when it is initialized, so
+ * the first bytes of every packet can be compressed with copies. the id is a
+ * checksum of the content that identifies the preset. the compressor and the
+ * decompressor must use the same preset.
+ */
+#define LZSS_PRESET_VERSION 1 // version of the serialized preset
+#define LZSS_PRESET_HEADER_SIZE 16
+#define LZSS_PRESET_MAX_SERIALIZED_SIZE (LZSS_PRESET_HEADER_SIZE + DICTIONARY_SIZE)
+
+typedef struct {
+  uint32_t id;
+  size_t length;
+  uint8_t data[DICTIONARY_SIZE];
+} LzssPreset;
+
+/*
+ * a stored packet keeps input that does not compress as it is. it starts with
+ * 0xff 0xff, which the compressor never writes otherwise, 'S', the version and
+ * the length of the data (LE), followed by the data. older decoders skip the
+ * 0xff 0xff and read the rest as tokens, so they must be updated before the
+ * compressor starts writing stored packets.
+ */
+#define LZSS_STORED_VERSION 1
+#define LZSS_STORED_HEADER_SIZE 6
+
+/*
+ * a compressed packet may start with a sync marker of four 0xff bytes, which
+ * every decoder skips. as the compressor never writes 0xff 0xff otherwise, the
+ * markers and the headers of stored packets show where the packets start.
+ */
+#define LZSS_SYNC_MARKER_SIZE 4
+
+// a two bytes copy expands to at most 17 bytes
+#define LZSS_MAX_COPY_LENGTH 17
+#define LZSS_MAX_DECOMPRESSED_SIZE(_s_len_) ((_s_len_) * 9)
+
+/*
+ * a stream decompresses input that is pushed in chunks of any size. it keeps
+ * the first byte of a token that is split between two chunks and the output
+ * of a copy that did not fit in the destination, and it resets the dictionary
+ * at every packet boundary.
+ */
+typedef struct {
+  Dictionary dictionary;
+  const LzssPreset *preset; // dictionary content at the start of every packet, may be NULL
+  size_t packet_size;       // zero if the input is not split into packets
+  size_t packet_position;   // number of bytes of the current packet that are consumed
+  uint8_t token;            // first byte of a two bytes token
+  bool has_token;
+  uint8_t output[LZSS_MAX_COPY_LENGTH];
+  size_t output_position;
+  size_t output_length;
+  uint8_t stored_header[LZSS_STORED_HEADER_SIZE];
+  size_t stored_header_length; // bytes of the header of a stored packet or of a sync marker
+  size_t stored_length;        // bytes of the data of the stored packet to copy
+} LzssStream;
+
+/*
+ * a checkpoint is the serialized state of a stream, so that decompressing a
+ * growing file can continue after the bytes that were already consumed. it has
+ * the version, the packet state, the partial token and header, the output that
+ * is not flushed yet, the dictionary and a checksum. the preset is not part of
+ * the checkpoint, only a flag and its id to check that the same one is given.
+ */
+#define LZSS_CHECKPOINT_VERSION 1
+#define LZSS_CHECKPOINT_HEADER_SIZE 56
+#define LZSS_CHECKPOINT_SIZE (LZSS_CHECKPOINT_HEADER_SIZE + DICTIONARY_SIZE + 4)
+
+/*
+ * segments of a scattered buffer, like struct iovec. the segments are used
+ * in order as if they were one contiguous buffer.
+ */
+typedef struct {
+  uint8_t *data;
+  size_t length;
+} LzssSegment;
+
+typedef struct {
+  const uint8_t *data;
+  size_t length;
+} LzssConstSegment;
+
+#define LZSS_STATS_LENGTH_BUCKETS 15                // one bucket per copy length from 3 to 17
+#define LZSS_STATS_DISTANCE_BUCKETS (DICT_BITS + 1) // bucket i counts distances in [2^(i-1), 2^i)
+
+typedef struct {
+  unsigned long literals;          // including the escaped literals
+  unsigned long escaped_literals;  // non-ASCII literals written as two bytes
+  unsigned long copies;
+  unsigned long copies_by_length[LZSS_STATS_LENGTH_BUCKETS];
+  unsigned long copies_by_distance[LZSS_STATS_DISTANCE_BUCKETS];
+  unsigned long rejected_matches;  // matches of two bytes written as two literals
+  unsigned long fillers;
+  unsigned long packets;           // packets that are completely filled
+  unsigned long stored_packets;    // packets written as stored packets
+  unsigned long searches;          // searches for the longest match
+  unsigned long probes;            // dictionary positions compared during the searches
+} LzssStats;
+
 void lzss_dictionary_init(Dictionary *dictionary);
+void lzss_dictionary_init_preset(Dictionary *dictionary, const LzssPreset *preset);
+
+void lzss_preset_init(LzssPreset *preset, const uint8_t *data, size_t length);
+bool lzss_preset_build(LzssPreset *preset, const uint8_t *samples, size_t s_len);
+size_t lzss_preset_write(const LzssPreset *preset, uint8_t *dst, size_t d_len);
+bool lzss_preset_read(LzssPreset *preset, const uint8_t *src, size_t s_len);
 
 size_t lzss_compress(Dictionary *dictionary, uint8_t *dst, size_t d_len, const uint8_t *src, size_t s_len, size_t *s_unused_bytes, size_t d_remaining_packet_len);
+size_t lzss_compress_with_stats(Dictionary *dictionary, uint8_t *dst, size_t d_len, const uint8_t *src, size_t s_len, size_t *s_unused_bytes, size_t d_remaining_packet_len, LzssStats *stats);
 size_t lzss_decompress(Dictionary *dictionary, uint8_t *dst, size_t d_len, const uint8_t *src, size_t s_len, size_t *s_unused_bytes, size_t s_remaining_packet_len);
 
+size_t lzss_compressv(Dictionary *dictionary, const LzssSegment *dst, size_t d_count, const LzssConstSegment *src, size_t s_count, size_t *s_unused_bytes, size_t d_remaining_packet_len);
+size_t lzss_decompressv(Dictionary *dictionary, const LzssSegment *dst, size_t d_count, const LzssConstSegment *src, size_t s_count, size_t *s_unused_bytes, size_t s_remaining_packet_len);
+
+size_t lzss_compress_records(const Dictionary *snapshot, uint8_t *dst, size_t d_len, const LzssConstSegment *records, size_t count, size_t *offsets);
+size_t lzss_decompress_record(const Dictionary *snapshot, uint8_t *dst, size_t d_len, const uint8_t *src, size_t s_len);
+
+size_t lzss_pad_packet(uint8_t *dst, size_t packet_len, size_t packet_size);
+size_t lzss_concatenate(uint8_t *dst, size_t d_len, const LzssConstSegment *streams, size_t count, size_t packet_size);
+bool lzss_slice_packets(const uint8_t *src, size_t s_len, size_t packet_size, size_t first, size_t count, LzssConstSegment *slice);
+
+size_t lzss_compress_packet(const LzssPreset *preset, uint8_t *dst, size_t packet_size, const uint8_t *src, size_t s_len, size_t *s_unused_bytes, bool sync, LzssStats *stats);
+size_t lzss_find_packet(const uint8_t *src, size_t s_len, size_t packet_size);
+size_t lzss_decompress_packet(const LzssPreset *preset, uint8_t *dst, size_t d_len, const uint8_t *src, size_t s_len);
+
+void lzss_stream_init(LzssStream *stream, const LzssPreset *preset, size_t packet_size);
+size_t lzss_stream_decompress(LzssStream *stream, uint8_t *dst, size_t d_len, const uint8_t *src, size_t s_len, size_t *s_consumed_bytes);
+size_t lzss_stream_pending(const LzssStream *stream);
+size_t lzss_stream_save(const LzssStream *stream, uint8_t *dst, size_t d_len);
+bool lzss_stream_restore(LzssStream *stream, const LzssPreset *preset, const uint8_t *src, size_t s_len);
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,393 @@
+#ifndef LZSS_HPP_
+#define LZSS_HPP_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+/*
+ * a header-only LZSS codec templated on the number of window bits and length
+ * bits. it generalizes the format of lzss.c:
+ *
+ * a copy is one bit '1', the position in the window and the length field,
+ * written big endian in COPY_BYTES bytes. a literal is one byte with a '0' MSB.
+ * non-ASCII literals are the literal followed by COPY_BYTES - 1 bytes where the
+ * length field is all ones. copies are at least COPY_BYTES + 1 bytes long.
+ *
+ * Codec<DICT_BITS, 4> (LegacyCodec) is the format of lzss.c and its output is
+ * bit-identical to lzss_compress without packets. it searches the whole
+ * window like lzss.c. larger windows search hash chains instead, which is
+ * only a different choice of matches and does not change the format.
+ *
+ * fillers and packets are only used by firmwares and they are not
+ * supported; sequences of 0xff pairs are skipped by the legacy format only
+ * (larger copies may have two consecutive 0xff bytes).
+ *
+ * archives are streams of a profile that start with a tag of four bytes:
+ * 'L', 'Z', window bits and length bits.
+ */
+
+namespace lzss {
+
+template <unsigned WindowBits, unsigned LengthBits>
+class Codec {
+ public:
+  static const unsigned WINDOW_SIZE = 1u << WindowBits;
+  static const unsigned COPY_BYTES = (1 + WindowBits + LengthBits) / 8;
+  static const unsigned THRESHOLD = COPY_BYTES + 1;                   // minimum copy length
+  static const unsigned LENGTH_MASK = (1u << LengthBits) - 1;         // all ones is a literal
+  static const unsigned MAX_MATCH = LENGTH_MASK - 1 + THRESHOLD;
+  static const bool SKIPS_FFFF = COPY_BYTES == 2;
+  static const bool SEARCHES_WHOLE_WINDOW = WindowBits <= 12;
+  static const unsigned TAG_SIZE = 4;
+
+  Codec() : window(WINDOW_SIZE), head(SEARCHES_WHOLE_WINDOW ? 0 : HASH_SIZE), chain(SEARCHES_WHOLE_WINDOW ? 0 : WINDOW_SIZE) {
+    reset();
+  }
+
+  /*
+   * the initial content of the window must be the same for the compressor and
+   * the decompressor, like lzss_dictionary_init.
+   */
+  void reset() {
+    memset(&window[0], 0, WINDOW_SIZE);
+    tail = WINDOW_SIZE - 1;
+    written = 0;
+    if(!SEARCHES_WHOLE_WINDOW) {
+      memset(&head[0], 0xff, HASH_SIZE * sizeof(head[0]));
+    }
+  }
+
+  /*
+   * compress the source and write in destination.
+   * update s_unused_bytes to the number of unused bytes in the source.
+   * return the number of bytes written into the destination.
+   */
+  size_t compress(uint8_t *dst, size_t d_len, const uint8_t *src, size_t s_len, size_t *s_unused_bytes) {
+    const uint8_t *original_dst = dst;
+    unsigned int position = 0;
+
+    while(s_len > 0) {
+      const unsigned int max = s_len < MAX_MATCH ? (unsigned int) s_len : MAX_MATCH;
+      unsigned int match_length = find_longest_match(src, max, &position);
+      size_t len;
+
+      if(match_length <= 1) {
+        match_length = 1;
+        len = write_literal(dst, d_len, *src);
+      } else if(match_length < THRESHOLD) { // write literals instead of a short copy
+        len = write_literals(dst, d_len, src, match_length);
+      } else {
+        len = write_copy(dst, d_len, position, match_length);
+      }
+
+      if(len == 0) { // try to add a literal if destination is almost full
+        if(d_len < 2 * COPY_BYTES && (len = write_literal(dst, d_len, *src)) != 0) {
+          append(src, 1, s_len);
+          dst += len;
+          src ++;
+          s_len --;
+        }
+        break;
+      }
+      append(src, match_length, s_len);
+      dst += len;
+      d_len -= len;
+      src += match_length;
+      s_len -= match_length;
+    }
+
+    *s_unused_bytes = s_len;
+    return dst - original_dst;
+  }
+
+  /*
+   * decompress the source and write in destination.
+   * update s_unused_bytes to the number of unused bytes in the source.
+   * return the number of bytes written into the destination.
+   */
+  size_t decompress(uint8_t *dst, size_t d_len, const uint8_t *src, size_t s_len, size_t *s_unused_bytes) {
+    const uint8_t *original_dst = dst;
+
+    while(s_len > 0) {
+      if(SKIPS_FFFF && s_len >= 2 && src[0] == 0xff && src[1] == 0xff) {
+        src += 2;
+        s_len -= 2;
+        continue;
+      }
+      if(!(src[0] & 128)) { // literal
+        if(d_len < 1) {
+          break;
+        }
+        *dst = src[0];
+        append_to_window(dst, 1);
+        dst ++;
+        d_len --;
+        src ++;
+        s_len --;
+        continue;
+      }
+      if(s_len < COPY_BYTES) { // first bytes of a copy
+        break;
+      }
+
+      uint32_t value = 0;
+      unsigned int i;
+      for(i = 0; i < COPY_BYTES; i ++) {
+        value = (value << 8) | src[i];
+      }
+      const unsigned int length_field = value & LENGTH_MASK;
+      if(length_field == LENGTH_MASK) { // non-ASCII literal
+        if(d_len < 1) {
+          break;
+        }
+        *dst = src[0];
+        append_to_window(dst, 1);
+        dst ++;
+        d_len --;
+      } else {
+        const unsigned int length = length_field + THRESHOLD;
+        if(d_len < length) {
+          break;
+        }
+        unsigned int position = (value >> LengthBits) & (WINDOW_SIZE - 1);
+        for(i = 0; i < length; i ++) {
+          dst[i] = window[(position + i) & (WINDOW_SIZE - 1)];
+        }
+        append_to_window(dst, length);
+        dst += length;
+        d_len -= length;
+      }
+      src += COPY_BYTES;
+      s_len -= COPY_BYTES;
+    }
+
+    *s_unused_bytes = s_len;
+    return dst - original_dst;
+  }
+
+  static void write_tag(uint8_t *dst) {
+    dst[0] = 'L';
+    dst[1] = 'Z';
+    dst[2] = WindowBits;
+    dst[3] = LengthBits;
+  }
+
+  static bool has_tag(const uint8_t *src, size_t s_len) {
+    return s_len >= TAG_SIZE && src[0] == 'L' && src[1] == 'Z' && src[2] == WindowBits && src[3] == LengthBits;
+  }
+
+ private:
+  static const unsigned HASH_BITS = 16;
+  static const unsigned HASH_SIZE = 1u << HASH_BITS;
+  static const unsigned HASH_BYTES = 3;
+  static const unsigned MAX_CHAIN = 128;     // candidates compared in a chain
+  static const uint32_t NO_POSITION = 0xffffffffu;
+
+  std::vector<uint8_t> window;
+  std::vector<uint32_t> head;  // last position of every hash
+  std::vector<uint32_t> chain; // previous position with the same hash
+  size_t tail;                 // index of the last byte written in the window
+  uint32_t written;            // number of bytes written in the window, archives must be smaller than 4 GB
+
+  static_assert((1 + WindowBits + LengthBits) % 8 == 0, "a copy must be a whole number of bytes");
+  static_assert(COPY_BYTES <= 4 && LengthBits >= 2 && LengthBits <= 8, "a copy must fit in 32 bits");
+
+  static unsigned int hash(const uint8_t *s) {
+    return ((s[0] << 16 | s[1] << 8 | s[2]) * 2654435761u) >> (32 - HASH_BITS);
+  }
+
+  static size_t write_literal(uint8_t *dst, size_t d_len, uint8_t c) {
+    if(!(c & 128)) {
+      if(d_len < 1) {
+        return 0;
+      }
+      *dst = c;
+      return 1;
+    }
+    if(d_len < COPY_BYTES) {
+      return 0;
+    }
+    write_value(dst, ((uint32_t) c << (8 * (COPY_BYTES - 1))) | LENGTH_MASK);
+    return COPY_BYTES;
+  }
+
+  static size_t write_literals(uint8_t *dst, size_t d_len, const uint8_t *src, unsigned int n) {
+    uint8_t tmp[THRESHOLD * COPY_BYTES];
+    size_t len = 0;
+    unsigned int i;
+    for(i = 0; i < n; i ++) {
+      len += write_literal(&tmp[len], sizeof(tmp) - len, src[i]);
+    }
+    if(len > d_len) {
+      return 0;
+    }
+    memcpy(dst, tmp, len);
+    return len;
+  }
+
+  static size_t write_copy(uint8_t *dst, size_t d_len, unsigned int position, unsigned int match_length) {
+    if(d_len < COPY_BYTES) {
+      return 0;
+    }
+    write_value(dst, (1u << (WindowBits + LengthBits)) | (position << LengthBits) | (match_length - THRESHOLD));
+    return COPY_BYTES;
+  }
+
+  static void write_value(uint8_t *dst, uint32_t value) {
+    unsigned int i;
+    for(i = 0; i < COPY_BYTES; i ++) {
+      dst[i] = (uint8_t) (value >> (8 * (COPY_BYTES - 1 - i)));
+    }
+  }
+
+  void append_to_window(const uint8_t *s, unsigned int n) {
+    while(n --) {
+      tail = (tail + 1) & (WINDOW_SIZE - 1);
+      window[tail] = *s ++;
+    }
+  }
+
+  /*
+   * append the bytes to the window and add their positions to the chains.
+   * remaining is the number of source bytes from s.
+   */
+  void append(const uint8_t *s, unsigned int n, size_t remaining) {
+    unsigned int i;
+    if(!SEARCHES_WHOLE_WINDOW) {
+      for(i = 0; i < n && i + HASH_BYTES <= remaining; i ++) {
+        const unsigned int h = hash(s + i);
+        chain[(written + i) & (WINDOW_SIZE - 1)] = head[h];
+        head[h] = written + i;
+      }
+    }
+    append_to_window(s, n);
+    written += n;
+  }
+
+  unsigned int match_at(size_t i, const uint8_t *src, unsigned int max) const {
+    unsigned int j;
+    for(j = 0; j < max; j ++) {
+      if(window[(i + j) & (WINDOW_SIZE - 1)] != src[j]) {
+        break;
+      }
+    }
+    return j;
+  }
+
+  unsigned int find_longest_match(const uint8_t *src, unsigned int max, unsigned int *position) const {
+    return SEARCHES_WHOLE_WINDOW ? find_longest_match_in_window(src, max, position) : find_longest_match_in_chain(src, max, position);
+  }
+
+  /*
+   * the same search as dictionary_find_longest_match in lzss.c.
+   */
+  unsigned int find_longest_match_in_window(const uint8_t *src, unsigned int max, unsigned int *position) const {
+    unsigned int match_length = 0;
+    size_t i = tail;
+    unsigned int c;
+    for(c = 0; c < WINDOW_SIZE; c ++) {
+      if(window[i] == *src) {
+        const unsigned int j = match_at(i, src, max);
+        if(j > match_length) {
+          *position = (unsigned int) i;
+          match_length = j;
+        }
+        if(j == max) {
+          break;
+        }
+      }
+      i = (i - 1) & (WINDOW_SIZE - 1);
+    }
+    return match_length;
+  }
+
+  unsigned int find_longest_match_in_chain(const uint8_t *src, unsigned int max, unsigned int *position) const {
+    unsigned int match_length = 0;
+    unsigned int c;
+    if(max < HASH_BYTES) {
+      return 0;
+    }
+    uint32_t candidate = head[hash(src)];
+    for(c = 0; c < MAX_CHAIN && candidate != NO_POSITION && written - candidate <= WINDOW_SIZE; c ++) {
+      const size_t i = candidate & (WINDOW_SIZE - 1);
+      const unsigned int j = match_at(i, src, max);
+      if(j > match_length) {
+        *position = (unsigned int) i;
+        match_length = j;
+        if(j == max) {
+          break;
+        }
+      }
+      const uint32_t previous = chain[i];
+      if(previous != NO_POSITION && previous >= candidate) { // the chain continues in overwritten positions
+        break;
+      }
+      candidate = previous;
+    }
+    return match_length;
+  }
+};
+
+typedef Codec<11, 4> LegacyCodec;  // the format of lzss.c
+typedef Codec<16, 7> ArchiveCodec; // 64 KB window and copies of up to 130 bytes
+
+/*
+ * compress the whole source into an archive that starts with the tag of the
+ * profile.
+ */
+template <class Profile>
+std::vector<uint8_t> compress_archive(const uint8_t *src, size_t s_len) {
+  static const size_t CHUNK = 65536;
+  std::vector<uint8_t> archive(Profile::TAG_SIZE);
+  Profile codec;
+  size_t s_unused_bytes;
+
+  Profile::write_tag(&archive[0]);
+  while(s_len > 0) {
+    const size_t offset = archive.size();
+    archive.resize(offset + CHUNK);
+    const size_t len = codec.compress(&archive[offset], CHUNK, src, s_len, &s_unused_bytes);
+    archive.resize(offset + len);
+    src += s_len - s_unused_bytes;
+    s_len = s_unused_bytes;
+  }
+  return archive;
+}
+
+/*
+ * decompress an archive of the profile.
+ * return false if the tag is not the tag of the profile or if the archive is
+ * truncated.
+ */
+template <class Profile>
+bool decompress_archive(const uint8_t *src, size_t s_len, std::vector<uint8_t> &text) {
+  static const size_t CHUNK = 65536;
+  size_t s_unused_bytes;
+
+  if(!Profile::has_tag(src, s_len)) {
+    return false;
+  }
+  src += Profile::TAG_SIZE;
+  s_len -= Profile::TAG_SIZE;
+
+  Profile codec;
+  text.clear();
+  while(s_len > 0) {
+    const size_t offset = text.size();
+    text.resize(offset + CHUNK);
+    const size_t len = codec.decompress(&text[offset], CHUNK, src, s_len, &s_unused_bytes);
+    text.resize(offset + len);
+    if(len == 0) { // a truncated copy
+      break;
+    }
+    src += s_len - s_unused_bytes;
+    s_len = s_unused_bytes;
+  }
+  return s_len == 0;
+}
+
+} // namespace lzss
+
+#endif // LZSS_HPP_
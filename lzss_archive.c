@@ -0,0 +1,677 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdint.h>
+
+#include "lzss.h"
+#include "lzss_archive.h"
+
+/*
+ * an archive recodes a compressed stream of lzss.c with Huffman codes and it
+ * is transcoded back to exactly the same bytes.
+ *
+ * the stream is read token by token like lzss_decompress does. every token is
+ * a symbol of the main alphabet:
+ *   0..255   a literal (non-ASCII literals are the two bytes c 0x0f)
+ *   256      a 0xff filler at the end of a packet
+ *   257      a 0xff 0xff sequence
+ *   258      any other single byte, followed by 8 bits
+ *   259      any other two bytes token, followed by 16 bits
+ *   260..274 a copy of length 3..17, followed by its distance
+ * copies store the distance from the tail of the dictionary instead of the
+ * position, which is much more skewed. a distance is a symbol of the distance
+ * alphabet, which is its number of bits, followed by the bits below its MSB.
+ * the tail is tracked from the lengths of the tokens and it is reset at
+ * every packet boundary like the dictionary.
+ *
+ * header: "LZHA", version, 3 reserved bytes, packet size, stream size (LE)
+ * block:  type, stream bytes, payload bytes (LE) and the payload:
+ *   raw:     the bytes of the stream
+ *   huffman: the 4 bits code lengths of both alphabets and the codes
+ * a block is raw when the codes would not be smaller.
+ */
+
+#define MINIMUM(_a_,_b_) (((_a_) <= (_b_)) ? (_a_) : (_b_))
+
+#define ARCHIVE_VERSION 1
+
+#define SYMBOL_FILLER 256
+#define SYMBOL_FFFF 257
+#define SYMBOL_RAW1 258
+#define SYMBOL_RAW2 259
+#define SYMBOL_COPY 260
+#define SYMBOLS (SYMBOL_COPY + 15)
+#define DISTANCE_SYMBOLS (DICT_BITS + 1)
+
+#define MAX_CODE_BITS 12
+#define TABLE_SIZE (1 << MAX_CODE_BITS)
+#define CODE_LENGTHS_SIZE ((SYMBOLS + DISTANCE_SYMBOLS + 1) / 2)
+
+#define BLOCK_RAW 0
+#define BLOCK_HUFFMAN 1
+
+static const uint8_t ARCHIVE_MAGIC[4] = { 'L', 'Z', 'H', 'A' };
+
+typedef struct {
+  uint16_t symbol;
+  uint16_t extra; // distance of a copy or bytes of a raw token
+} ArchiveToken;
+
+typedef struct {
+  size_t packet_size;
+  size_t packet_position;
+  unsigned int tail;
+} WireState;
+
+typedef struct {
+  uint8_t *dst;
+  size_t d_len;
+  size_t len;
+  uint64_t bits;
+  unsigned int count;
+} BitWriter;
+
+typedef struct {
+  const uint8_t *src;
+  size_t s_len;
+  size_t position;
+  uint64_t bits;
+  unsigned int count;
+} BitReader;
+
+typedef struct {
+  uint8_t lengths[SYMBOLS];
+  uint16_t codes[SYMBOLS];
+  uint8_t distance_lengths[DISTANCE_SYMBOLS];
+  uint16_t distance_codes[DISTANCE_SYMBOLS];
+} Codes;
+
+typedef struct {
+  uint16_t table[TABLE_SIZE];          // symbol << 4 | length for the next bits
+  uint16_t distance_table[TABLE_SIZE];
+} Tables;
+
+
+
+static void write_u32(uint8_t *dst, uint32_t value) {
+  dst[0] = (uint8_t) value;
+  dst[1] = (uint8_t) (value >> 8);
+  dst[2] = (uint8_t) (value >> 16);
+  dst[3] = (uint8_t) (value >> 24);
+}
+
+static uint32_t read_u32(const uint8_t *src) {
+  return src[0] | (src[1] << 8) | (src[2] << 16) | ((uint32_t) src[3] << 24);
+}
+
+
+
+/*
+ * functions for reading and writing the tokens of the stream.
+ */
+
+static void wire_state_init(WireState *state, size_t packet_size) {
+  state->packet_size = packet_size;
+  state->packet_position = 0;
+  state->tail = DICTIONARY_SIZE - 1;
+}
+
+static unsigned int distance_symbol(unsigned int distance) {
+  unsigned int bits = 0;
+  while(distance) {
+    distance >>= 1;
+    bits ++;
+  }
+  return bits;
+}
+
+/*
+ * read the next token at source like lzss_decompress.
+ * return the number of bytes of the token.
+ */
+static size_t archive_read_token(const WireState *state, const uint8_t *src, size_t s_len, ArchiveToken *token) {
+  const size_t remaining = state->packet_size ? state->packet_size - state->packet_position : s_len;
+  const size_t available = MINIMUM(s_len, remaining);
+  const uint8_t c1 = src[0];
+
+  if(available >= 2 && c1 == 0xff && src[1] == 0xff) {
+    token->symbol = SYMBOL_FFFF;
+    return 2;
+  }
+  if(!(c1 & 128)) {
+    token->symbol = c1;
+    return 1;
+  }
+  if(state->packet_size && remaining == 1) { // a filler
+    token->symbol = c1 == 0xff ? SYMBOL_FILLER : SYMBOL_RAW1;
+    token->extra = c1;
+    return 1;
+  }
+  if(available < 2) { // the first byte of a copy at the end of the stream
+    token->symbol = SYMBOL_RAW1;
+    token->extra = c1;
+    return 1;
+  }
+
+  const uint8_t c2 = src[1];
+  if((c2 & 0x0f) == 15) { // non-ASCII literal
+    token->symbol = c2 == 0x0f ? c1 : SYMBOL_RAW2;
+    token->extra = (uint16_t) (c1 << 8 | c2);
+  } else { // copy
+    unsigned int position = ((c1 & 127) << 4) | ((c2 & 0x0f0) >> 4);
+    token->symbol = SYMBOL_COPY + (c2 & 0x0f);
+    token->extra = (uint16_t) ((state->tail - position) & (DICTIONARY_SIZE - 1));
+  }
+  return 2;
+}
+
+/*
+ * write the bytes of the token into destination, which has space for two.
+ * return the number of bytes of the token.
+ */
+static size_t archive_write_token(const WireState *state, uint8_t *dst, const ArchiveToken *token) {
+  if(token->symbol < 128) {
+    dst[0] = (uint8_t) token->symbol;
+    return 1;
+  }
+  if(token->symbol < 256) {
+    dst[0] = (uint8_t) token->symbol;
+    dst[1] = 0x0f;
+    return 2;
+  }
+  switch(token->symbol) {
+    case SYMBOL_FILLER:
+      dst[0] = 0xff;
+      return 1;
+    case SYMBOL_FFFF:
+      dst[0] = dst[1] = 0xff;
+      return 2;
+    case SYMBOL_RAW1:
+      dst[0] = (uint8_t) token->extra;
+      return 1;
+    case SYMBOL_RAW2:
+      dst[0] = (uint8_t) (token->extra >> 8);
+      dst[1] = (uint8_t) token->extra;
+      return 2;
+  }
+  unsigned int position = (state->tail - token->extra) & (DICTIONARY_SIZE - 1);
+  dst[0] = (uint8_t) (128 | (position >> 4));
+  dst[1] = (uint8_t) (((position << 4) & 0x0f0) | (token->symbol - SYMBOL_COPY));
+  return 2;
+}
+
+/*
+ * move the tail by the length of the decompressed token and reset it at the
+ * end of a packet.
+ */
+static void archive_advance(WireState *state, const ArchiveToken *token, size_t len) {
+  if(token->symbol < 256 || token->symbol == SYMBOL_RAW2) {
+    state->tail ++;
+  } else if(token->symbol >= SYMBOL_COPY) {
+    state->tail += token->symbol - SYMBOL_COPY + 3;
+  }
+  state->tail &= DICTIONARY_SIZE - 1;
+
+  state->packet_position += len;
+  if(state->packet_size && state->packet_position >= state->packet_size) {
+    wire_state_init(state, state->packet_size);
+  }
+}
+
+
+
+/*
+ * functions for building Huffman codes.
+ */
+
+typedef struct {
+  uint32_t weight;
+  uint16_t symbol;
+} Leaf;
+
+static int archive_compare_leaves(const void *a, const void *b) {
+  const Leaf *l1 = (const Leaf *) a;
+  const Leaf *l2 = (const Leaf *) b;
+  if(l1->weight != l2->weight) {
+    return l1->weight < l2->weight ? -1 : 1;
+  }
+  return l1->symbol - l2->symbol;
+}
+
+/*
+ * set the lengths of a Huffman code for the weights.
+ * return the longest length.
+ */
+static unsigned int archive_huffman_lengths(const uint32_t *weights, unsigned int n, uint8_t *lengths) {
+  Leaf leaves[SYMBOLS];
+  uint64_t node_weights[2 * SYMBOLS];
+  uint16_t parents[2 * SYMBOLS];
+  uint8_t depths[2 * SYMBOLS];
+  unsigned int i, m = 0, next_leaf = 0, next_node, last_node, max = 0;
+
+  memset(lengths, 0, n);
+  for(i = 0; i < n; i ++) {
+    if(weights[i] > 0) {
+      leaves[m].weight = weights[i];
+      leaves[m].symbol = (uint16_t) i;
+      m ++;
+    }
+  }
+  if(m <= 1) {
+    if(m == 1) {
+      lengths[leaves[0].symbol] = 1;
+    }
+    return m;
+  }
+  qsort(leaves, m, sizeof(leaves[0]), archive_compare_leaves);
+
+  // merge the two lightest of the sorted leaves and of the nodes in creation order
+  for(i = 0; i < m; i ++) {
+    node_weights[i] = leaves[i].weight;
+  }
+  next_node = m;
+  for(last_node = m; last_node < 2 * m - 1; last_node ++) {
+    unsigned int k, child;
+    node_weights[last_node] = 0;
+    for(k = 0; k < 2; k ++) {
+      if(next_leaf < m && (next_node == last_node || node_weights[next_leaf] <= node_weights[next_node])) {
+        child = next_leaf ++;
+      } else {
+        child = next_node ++;
+      }
+      node_weights[last_node] += node_weights[child];
+      parents[child] = (uint16_t) last_node;
+    }
+  }
+
+  depths[2 * m - 2] = 0;
+  for(i = 2 * m - 2; i -- > 0; ) {
+    depths[i] = depths[parents[i]] + 1;
+  }
+  for(i = 0; i < m; i ++) {
+    lengths[leaves[i].symbol] = depths[i];
+    if(depths[i] > max) {
+      max = depths[i];
+    }
+  }
+  return max;
+}
+
+/*
+ * set the lengths of a Huffman code that has no code longer than
+ * MAX_CODE_BITS by flattening the weights until it fits.
+ */
+static void archive_build_lengths(const uint32_t *weights, unsigned int n, uint8_t *lengths) {
+  uint32_t w[SYMBOLS];
+  unsigned int i;
+
+  memcpy(w, weights, n * sizeof(w[0]));
+  while(archive_huffman_lengths(w, n, lengths) > MAX_CODE_BITS) {
+    for(i = 0; i < n; i ++) {
+      if(w[i] > 0) {
+        w[i] = (w[i] >> 1) | 1;
+      }
+    }
+  }
+}
+
+static uint16_t archive_reverse_bits(uint16_t code, unsigned int n) {
+  uint16_t r = 0;
+  while(n --) {
+    r = (uint16_t) ((r << 1) | (code & 1));
+    code >>= 1;
+  }
+  return r;
+}
+
+/*
+ * set the canonical codes of the lengths, bit reversed because the bits are
+ * written from the LSB.
+ */
+static void archive_assign_codes(const uint8_t *lengths, unsigned int n, uint16_t *codes) {
+  uint16_t count[MAX_CODE_BITS + 1] = { 0 };
+  uint16_t next[MAX_CODE_BITS + 1];
+  unsigned int i, code = 0;
+
+  for(i = 0; i < n; i ++) {
+    count[lengths[i]] ++;
+  }
+  count[0] = 0;
+  for(i = 1; i <= MAX_CODE_BITS; i ++) {
+    code = (code + count[i - 1]) << 1;
+    next[i] = (uint16_t) code;
+  }
+  for(i = 0; i < n; i ++) {
+    if(lengths[i]) {
+      codes[i] = archive_reverse_bits(next[lengths[i]] ++, lengths[i]);
+    }
+  }
+}
+
+static void archive_build_table(const uint8_t *lengths, unsigned int n, uint16_t *table) {
+  uint16_t codes[SYMBOLS];
+  unsigned int i, k;
+
+  archive_assign_codes(lengths, n, codes);
+  memset(table, 0, TABLE_SIZE * sizeof(table[0]));
+  for(i = 0; i < n; i ++) {
+    if(lengths[i]) {
+      for(k = codes[i]; k < TABLE_SIZE; k += 1 << lengths[i]) {
+        table[k] = (uint16_t) (i << 4 | lengths[i]);
+      }
+    }
+  }
+}
+
+
+
+/*
+ * functions for writing and reading bits from the LSB.
+ */
+
+static void bits_put(BitWriter *writer, uint32_t value, unsigned int n) {
+  writer->bits |= (uint64_t) value << writer->count;
+  writer->count += n;
+  while(writer->count >= 8) {
+    if(writer->len < writer->d_len) {
+      writer->dst[writer->len] = (uint8_t) writer->bits;
+    }
+    writer->len ++;
+    writer->bits >>= 8;
+    writer->count -= 8;
+  }
+}
+
+static void bits_flush(BitWriter *writer) {
+  if(writer->count > 0) {
+    bits_put(writer, 0, 8 - writer->count);
+  }
+}
+
+static void bits_refill(BitReader *reader) {
+  while(reader->count <= 56) {
+    uint8_t b = reader->position < reader->s_len ? reader->src[reader->position] : 0;
+    reader->position ++;
+    reader->bits |= (uint64_t) b << reader->count;
+    reader->count += 8;
+  }
+}
+
+static uint32_t bits_get(BitReader *reader, unsigned int n) {
+  uint32_t value = (uint32_t) (reader->bits & ((1u << n) - 1));
+  reader->bits >>= n;
+  reader->count -= n;
+  return value;
+}
+
+/*
+ * return the next symbol or -1 if the bits are not a code.
+ */
+static int bits_get_symbol(BitReader *reader, const uint16_t *table) {
+  const uint16_t entry = table[reader->bits & (TABLE_SIZE - 1)];
+  if(entry == 0) {
+    return -1;
+  }
+  bits_get(reader, entry & 0x0f);
+  return entry >> 4;
+}
+
+static bool bits_overrun(const BitReader *reader) {
+  return reader->position - reader->count / 8 > reader->s_len;
+}
+
+
+
+/*
+ * functions for encoding and decoding blocks.
+ */
+
+static void archive_write_block_header(uint8_t *dst, uint8_t type, size_t stream_len, size_t payload_len) {
+  dst[0] = type;
+  write_u32(dst + 1, (uint32_t) stream_len);
+  write_u32(dst + 5, (uint32_t) payload_len);
+}
+
+/*
+ * write the Huffman codes of the tokens into destination.
+ * return the number of bytes written or zero if they do not fit.
+ */
+static size_t archive_encode_tokens(uint8_t *dst, size_t d_len, const ArchiveToken *tokens, size_t count, Codes *codes) {
+  uint32_t weights[SYMBOLS] = { 0 };
+  uint32_t distance_weights[DISTANCE_SYMBOLS] = { 0 };
+  BitWriter writer = { dst, d_len, 0, 0, 0 };
+  size_t i;
+
+  for(i = 0; i < count; i ++) {
+    weights[tokens[i].symbol] ++;
+    if(tokens[i].symbol >= SYMBOL_COPY) {
+      distance_weights[distance_symbol(tokens[i].extra)] ++;
+    }
+  }
+  archive_build_lengths(weights, SYMBOLS, codes->lengths);
+  archive_build_lengths(distance_weights, DISTANCE_SYMBOLS, codes->distance_lengths);
+  archive_assign_codes(codes->lengths, SYMBOLS, codes->codes);
+  archive_assign_codes(codes->distance_lengths, DISTANCE_SYMBOLS, codes->distance_codes);
+
+  for(i = 0; i < SYMBOLS; i ++) {
+    bits_put(&writer, codes->lengths[i], 4);
+  }
+  for(i = 0; i < DISTANCE_SYMBOLS; i ++) {
+    bits_put(&writer, codes->distance_lengths[i], 4);
+  }
+  bits_flush(&writer);
+
+  for(i = 0; i < count && writer.len <= d_len; i ++) {
+    const unsigned int symbol = tokens[i].symbol;
+    bits_put(&writer, codes->codes[symbol], codes->lengths[symbol]);
+    if(symbol == SYMBOL_RAW1) {
+      bits_put(&writer, tokens[i].extra, 8);
+    } else if(symbol == SYMBOL_RAW2) {
+      bits_put(&writer, tokens[i].extra, 16);
+    } else if(symbol >= SYMBOL_COPY) {
+      const unsigned int d = distance_symbol(tokens[i].extra);
+      bits_put(&writer, codes->distance_codes[d], codes->distance_lengths[d]);
+      if(d > 1) {
+        bits_put(&writer, tokens[i].extra & ((1u << (d - 1)) - 1), d - 1);
+      }
+    }
+  }
+  bits_flush(&writer);
+
+  return writer.len <= d_len ? writer.len : 0;
+}
+
+/*
+ * decode the payload of a Huffman block until stream_len bytes are written.
+ * return false if the payload is not valid.
+ */
+static bool archive_decode_tokens(WireState *state, uint8_t *dst, size_t stream_len, const uint8_t *src, size_t s_len, Tables *tables) {
+  uint8_t lengths[SYMBOLS];
+  uint8_t distance_lengths[DISTANCE_SYMBOLS];
+  BitReader reader = { src, s_len, 0, 0, 0 };
+  ArchiveToken token;
+  size_t i, len = 0;
+
+  if(s_len < CODE_LENGTHS_SIZE) {
+    return false;
+  }
+  bits_refill(&reader);
+  for(i = 0; i < SYMBOLS + DISTANCE_SYMBOLS; i ++) {
+    uint8_t l = (uint8_t) bits_get(&reader, 4);
+    if(l > MAX_CODE_BITS) {
+      return false;
+    }
+    if(i < SYMBOLS) {
+      lengths[i] = l;
+    } else {
+      distance_lengths[i - SYMBOLS] = l;
+    }
+    bits_refill(&reader);
+  }
+  bits_get(&reader, reader.count % 8); // skip to the next byte
+  archive_build_table(lengths, SYMBOLS, tables->table);
+  archive_build_table(distance_lengths, DISTANCE_SYMBOLS, tables->distance_table);
+
+  while(len < stream_len) {
+    bits_refill(&reader);
+    int symbol = bits_get_symbol(&reader, tables->table);
+    if(symbol < 0) {
+      return false;
+    }
+    token.symbol = (uint16_t) symbol;
+    if(symbol == SYMBOL_RAW1) {
+      token.extra = (uint16_t) bits_get(&reader, 8);
+    } else if(symbol == SYMBOL_RAW2) {
+      token.extra = (uint16_t) bits_get(&reader, 16);
+    } else if(symbol >= SYMBOL_COPY) {
+      int d = bits_get_symbol(&reader, tables->distance_table);
+      if(d < 0) {
+        return false;
+      }
+      token.extra = (uint16_t) (d <= 1 ? (unsigned int) d : (1u << (d - 1)) | bits_get(&reader, d - 1));
+    }
+
+    uint8_t bytes[2];
+    size_t n = archive_write_token(state, bytes, &token);
+    if(len + n > stream_len) {
+      return false;
+    }
+    memcpy(dst + len, bytes, n);
+    len += n;
+    archive_advance(state, &token, n);
+  }
+  return !bits_overrun(&reader);
+}
+
+/*
+ * move the state over the tokens of a raw block.
+ */
+static void archive_skip_tokens(WireState *state, const uint8_t *src, size_t s_len) {
+  ArchiveToken token;
+  while(s_len > 0) {
+    size_t n = archive_read_token(state, src, s_len, &token);
+    archive_advance(state, &token, n);
+    src += n;
+    s_len -= n;
+  }
+}
+
+
+
+/*
+ * transcode a compressed stream into an archive. packet_size is the packet
+ * size of the compressor or zero if it does not split its output into packets.
+ * destination must have LZSS_ARCHIVE_MAX_SIZE(s_len) bytes.
+ * return the number of bytes written or zero if there is not enough memory
+ * or space in destination.
+ */
+size_t lzss_archive_encode(uint8_t *dst, size_t d_len, const uint8_t *src, size_t s_len, size_t packet_size) {
+  const size_t max_tokens = LZSS_ARCHIVE_BLOCK_SIZE + 1;
+  WireState state;
+  Codes codes;
+  size_t len = LZSS_ARCHIVE_HEADER_SIZE;
+
+  if(d_len < LZSS_ARCHIVE_MAX_SIZE(s_len) || s_len > UINT32_MAX) {
+    return 0;
+  }
+  ArchiveToken *tokens = (ArchiveToken *) malloc(max_tokens * sizeof(ArchiveToken));
+  if(tokens == NULL) {
+    return 0;
+  }
+
+  memset(dst, 0, LZSS_ARCHIVE_HEADER_SIZE);
+  memcpy(dst, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+  dst[4] = ARCHIVE_VERSION;
+  write_u32(dst + 8, (uint32_t) packet_size);
+  write_u32(dst + 12, (uint32_t) s_len);
+
+  wire_state_init(&state, packet_size);
+  while(s_len > 0) {
+    size_t block_len = 0, count = 0;
+    while(block_len < LZSS_ARCHIVE_BLOCK_SIZE && block_len < s_len) {
+      size_t n = archive_read_token(&state, src + block_len, s_len - block_len, &tokens[count]);
+      archive_advance(&state, &tokens[count], n);
+      block_len += n;
+      count ++;
+    }
+
+    uint8_t *block = dst + len;
+    uint8_t *payload = block + LZSS_ARCHIVE_BLOCK_HEADER_SIZE;
+    size_t payload_len = archive_encode_tokens(payload, block_len - 1, tokens, count, &codes);
+    if(payload_len == 0) {
+      memcpy(payload, src, block_len);
+      payload_len = block_len;
+      archive_write_block_header(block, BLOCK_RAW, block_len, payload_len);
+    } else {
+      archive_write_block_header(block, BLOCK_HUFFMAN, block_len, payload_len);
+    }
+    len += LZSS_ARCHIVE_BLOCK_HEADER_SIZE + payload_len;
+    src += block_len;
+    s_len -= block_len;
+  }
+
+  free(tokens);
+  return len;
+}
+
+/*
+ * read the packet size and the size of the compressed stream of an archive.
+ */
+bool lzss_archive_read_header(const uint8_t *src, size_t s_len, size_t *packet_size, size_t *stream_size) {
+  if(s_len < LZSS_ARCHIVE_HEADER_SIZE || memcmp(src, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC))
+      || src[4] != ARCHIVE_VERSION) {
+    return false;
+  }
+  *packet_size = read_u32(src + 8);
+  *stream_size = read_u32(src + 12);
+  return true;
+}
+
+/*
+ * transcode an archive back into the compressed stream.
+ * return the number of bytes written or zero if the archive is not valid or
+ * destination is smaller than the stream.
+ */
+size_t lzss_archive_decode(uint8_t *dst, size_t d_len, const uint8_t *src, size_t s_len) {
+  size_t packet_size, stream_size, len = 0;
+  WireState state;
+
+  if(!lzss_archive_read_header(src, s_len, &packet_size, &stream_size) || d_len < stream_size) {
+    return 0;
+  }
+  Tables *tables = (Tables *) malloc(sizeof(Tables));
+  if(tables == NULL) {
+    return 0;
+  }
+  src += LZSS_ARCHIVE_HEADER_SIZE;
+  s_len -= LZSS_ARCHIVE_HEADER_SIZE;
+
+  wire_state_init(&state, packet_size);
+  while(len < stream_size) {
+    if(s_len < LZSS_ARCHIVE_BLOCK_HEADER_SIZE) {
+      break;
+    }
+    const uint8_t type = src[0];
+    const size_t block_len = read_u32(src + 1);
+    const size_t payload_len = read_u32(src + 5);
+    src += LZSS_ARCHIVE_BLOCK_HEADER_SIZE;
+    s_len -= LZSS_ARCHIVE_BLOCK_HEADER_SIZE;
+    if(payload_len > s_len || block_len > stream_size - len) {
+      break;
+    }
+
+    if(type == BLOCK_RAW && payload_len == block_len) {
+      memcpy(dst + len, src, block_len);
+      archive_skip_tokens(&state, src, block_len);
+    } else if(type != BLOCK_HUFFMAN || !archive_decode_tokens(&state, dst + len, block_len, src, payload_len, tables)) {
+      break;
+    }
+    len += block_len;
+    src += payload_len;
+    s_len -= payload_len;
+  }
+
+  free(tables);
+  return len == stream_size ? len : 0;
+}
@@ -0,0 +1,30 @@
+#ifndef LZSS_ARCHIVE_H_
+#define LZSS_ARCHIVE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "lzss.h"
+
+#define LZSS_ARCHIVE_HEADER_SIZE 16
+#define LZSS_ARCHIVE_BLOCK_HEADER_SIZE 9
+#define LZSS_ARCHIVE_BLOCK_SIZE (256 * 1024) // bytes of compressed stream per block
+
+// an archive is never larger than the stream it was transcoded from plus this
+#define LZSS_ARCHIVE_MAX_SIZE(_s_len_) (LZSS_ARCHIVE_HEADER_SIZE + (_s_len_) \
+    + ((_s_len_) / LZSS_ARCHIVE_BLOCK_SIZE + 2) * LZSS_ARCHIVE_BLOCK_HEADER_SIZE)
+
+size_t lzss_archive_encode(uint8_t *dst, size_t d_len, const uint8_t *src, size_t s_len, size_t packet_size);
+size_t lzss_archive_decode(uint8_t *dst, size_t d_len, const uint8_t *src, size_t s_len);
+bool lzss_archive_read_header(const uint8_t *src, size_t s_len, size_t *packet_size, size_t *stream_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LZSS_ARCHIVE_H_
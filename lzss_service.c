@@ -0,0 +1,331 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <assert.h>
+
+#include "lzss.h"
+#include "lzss_service.h"
+
+/*
+ * the service decompresses many streams with a few workers.
+ *
+ * the states of the streams are allocated in slabs and reused through a free
+ * list, so opening and closing streams does not allocate. the chunks that are
+ * submitted to a stream are copied into its queue. a stream with chunks is in
+ * the ready queue until a worker takes it; the worker decodes one chunk and
+ * puts the stream back at the end of the queue if it has more chunks, so a
+ * busy stream does not starve the others and the chunks of a stream are
+ * decoded in order by one worker at a time.
+ *
+ * the bytes of the queued chunks are limited: submit blocks until the workers
+ * release enough bytes.
+ */
+
+#define SLOT_BITS 32
+
+struct LzssServiceChunk {
+  LzssServiceChunk *next;
+  size_t length;
+  uint8_t data[1];
+};
+
+struct LzssServiceStream {
+  LzssStream stream;
+  uint32_t slot;
+  uint32_t generation;  // incremented when the slot is opened
+  bool open;
+  bool running;         // a worker decodes its chunk
+  bool ready;           // in the ready queue
+  LzssServiceChunk *head;
+  LzssServiceChunk *tail;
+  LzssServiceStream *next; // in the free list or in the ready queue
+};
+
+
+
+static LzssServiceStreamId service_stream_id(const LzssServiceStream *stream) {
+  return ((LzssServiceStreamId) stream->generation << SLOT_BITS) | stream->slot;
+}
+
+/*
+ * return the open stream of the id or NULL. the lock must be held.
+ */
+static LzssServiceStream *service_find_stream(LzssService *service, LzssServiceStreamId id) {
+  const size_t slot = (size_t) (id & 0xffffffffu);
+  if(slot >= service->slab_count * LZSS_SERVICE_SLAB_SIZE) {
+    return NULL;
+  }
+  LzssServiceStream *stream = &service->slabs[slot / LZSS_SERVICE_SLAB_SIZE][slot % LZSS_SERVICE_SLAB_SIZE];
+  if(!stream->open || stream->generation != (uint32_t) (id >> SLOT_BITS)) {
+    return NULL;
+  }
+  return stream;
+}
+
+/*
+ * add a slab of streams to the free list. the lock must be held.
+ */
+static bool service_add_slab(LzssService *service) {
+  size_t i;
+
+  LzssServiceStream **slabs = (LzssServiceStream **) realloc(service->slabs, (service->slab_count + 1) * sizeof(slabs[0]));
+  if(slabs == NULL) {
+    return false;
+  }
+  service->slabs = slabs;
+  LzssServiceStream *slab = (LzssServiceStream *) calloc(LZSS_SERVICE_SLAB_SIZE, sizeof(LzssServiceStream));
+  if(slab == NULL) {
+    return false;
+  }
+  for(i = LZSS_SERVICE_SLAB_SIZE; i -- > 0; ) { // the lowest slot is used first
+    slab[i].slot = (uint32_t) (service->slab_count * LZSS_SERVICE_SLAB_SIZE + i);
+    slab[i].next = service->free_streams;
+    service->free_streams = &slab[i];
+  }
+  service->slabs[service->slab_count ++] = slab;
+  return true;
+}
+
+static void service_release_stream(LzssService *service, LzssServiceStream *stream) {
+  stream->next = service->free_streams;
+  service->free_streams = stream;
+  service->open_streams --;
+}
+
+static void service_push_ready(LzssService *service, LzssServiceStream *stream) {
+  stream->ready = true;
+  stream->next = NULL;
+  if(service->ready_tail != NULL) {
+    service->ready_tail->next = stream;
+  } else {
+    service->ready_head = stream;
+  }
+  service->ready_tail = stream;
+  pthread_cond_signal(&service->ready);
+}
+
+static LzssServiceStream *service_pop_ready(LzssService *service) {
+  LzssServiceStream *stream = service->ready_head;
+  service->ready_head = stream->next;
+  if(service->ready_head == NULL) {
+    service->ready_tail = NULL;
+  }
+  stream->ready = false;
+  return stream;
+}
+
+static void service_decode_chunk(LzssService *service, LzssServiceStream *stream, const LzssServiceChunk *chunk) {
+  uint8_t output[LZSS_SERVICE_OUTPUT_SIZE];
+  const LzssServiceStreamId id = service_stream_id(stream);
+  const uint8_t *src = chunk->data;
+  size_t s_len = chunk->length, consumed;
+
+  do {
+    size_t len = lzss_stream_decompress(&stream->stream, output, sizeof(output), src, s_len, &consumed);
+    src += consumed;
+    s_len -= consumed;
+    if(len > 0) {
+      service->sink(service->context, id, output, len);
+    }
+  } while(s_len > 0 || lzss_stream_pending(&stream->stream) > 0);
+}
+
+static void *service_worker(void *argument) {
+  LzssService *service = (LzssService *) argument;
+
+  pthread_mutex_lock(&service->lock);
+  while(true) {
+    while(service->ready_head == NULL && !service->stopping) {
+      pthread_cond_wait(&service->ready, &service->lock);
+    }
+    if(service->ready_head == NULL) {
+      break;
+    }
+
+    LzssServiceStream *stream = service_pop_ready(service);
+    LzssServiceChunk *chunk = stream->head;
+    stream->head = chunk->next;
+    if(stream->head == NULL) {
+      stream->tail = NULL;
+    }
+    stream->running = true;
+    pthread_mutex_unlock(&service->lock);
+
+    service_decode_chunk(service, stream, chunk);
+
+    pthread_mutex_lock(&service->lock);
+    service->queued_bytes -= chunk->length;
+    pthread_cond_broadcast(&service->space);
+    free(chunk);
+    stream->running = false;
+
+    if(stream->head != NULL) {
+      service_push_ready(service, stream);
+    } else {
+      if(!stream->open) {
+        service_release_stream(service, stream);
+      }
+      if(-- service->busy_streams == 0) {
+        pthread_cond_broadcast(&service->idle);
+      }
+    }
+  }
+  pthread_mutex_unlock(&service->lock);
+  return NULL;
+}
+
+
+
+/*
+ * start worker_count workers for at most max_streams streams. submit blocks
+ * while the queued chunks hold more than max_queued_bytes bytes. the sink is
+ * called with the decompressed output of every stream.
+ * return false if the workers cannot be started.
+ */
+bool lzss_service_init(LzssService *service, size_t max_streams, size_t worker_count, size_t max_queued_bytes, LzssServiceSink sink, void *context) {
+  memset(service, 0, sizeof(*service));
+  if(worker_count == 0 || worker_count > LZSS_SERVICE_MAX_WORKERS || max_streams > ((size_t) 1 << SLOT_BITS)) {
+    return false;
+  }
+  service->max_streams = max_streams;
+  service->max_queued_bytes = max_queued_bytes;
+  service->sink = sink;
+  service->context = context;
+
+  pthread_mutex_init(&service->lock, NULL);
+  pthread_cond_init(&service->ready, NULL);
+  pthread_cond_init(&service->space, NULL);
+  pthread_cond_init(&service->idle, NULL);
+
+  for(service->worker_count = 0; service->worker_count < worker_count; service->worker_count ++) {
+    if(pthread_create(&service->workers[service->worker_count], NULL, service_worker, service) != 0) {
+      lzss_service_deinit(service);
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * decode the queued chunks, stop the workers and free the streams.
+ */
+void lzss_service_deinit(LzssService *service) {
+  size_t i;
+
+  lzss_service_drain(service);
+  pthread_mutex_lock(&service->lock);
+  service->stopping = true;
+  pthread_cond_broadcast(&service->ready);
+  pthread_cond_broadcast(&service->space);
+  pthread_mutex_unlock(&service->lock);
+  for(i = 0; i < service->worker_count; i ++) {
+    pthread_join(service->workers[i], NULL);
+  }
+
+  for(i = 0; i < service->slab_count; i ++) {
+    free(service->slabs[i]);
+  }
+  free(service->slabs);
+  pthread_cond_destroy(&service->idle);
+  pthread_cond_destroy(&service->space);
+  pthread_cond_destroy(&service->ready);
+  pthread_mutex_destroy(&service->lock);
+}
+
+/*
+ * open a stream that is decompressed with the preset, which may be NULL, and
+ * packet_size like lzss_stream_init.
+ * return false if there are already max_streams streams or no memory.
+ */
+bool lzss_service_open(LzssService *service, const LzssPreset *preset, size_t packet_size, LzssServiceStreamId *id) {
+  pthread_mutex_lock(&service->lock);
+  if(service->open_streams == service->max_streams || (service->free_streams == NULL && !service_add_slab(service))) {
+    pthread_mutex_unlock(&service->lock);
+    return false;
+  }
+  LzssServiceStream *stream = service->free_streams;
+  service->free_streams = stream->next;
+  service->open_streams ++;
+
+  stream->generation ++;
+  stream->open = true;
+  stream->head = stream->tail = NULL;
+  lzss_stream_init(&stream->stream, preset, packet_size);
+  *id = service_stream_id(stream);
+  pthread_mutex_unlock(&service->lock);
+  return true;
+}
+
+/*
+ * queue a copy of the next bytes of the compressed stream.
+ * return false if the stream is not open or there is no memory.
+ */
+bool lzss_service_submit(LzssService *service, LzssServiceStreamId id, const uint8_t *data, size_t length) {
+  if(length == 0) {
+    return true;
+  }
+  LzssServiceChunk *chunk = (LzssServiceChunk *) malloc(offsetof(LzssServiceChunk, data) + length);
+  if(chunk == NULL) {
+    return false;
+  }
+  memcpy(chunk->data, data, length);
+  chunk->length = length;
+  chunk->next = NULL;
+
+  pthread_mutex_lock(&service->lock);
+  while(service->queued_bytes > 0 && service->queued_bytes + length > service->max_queued_bytes && !service->stopping) {
+    pthread_cond_wait(&service->space, &service->lock);
+  }
+  LzssServiceStream *stream = service_find_stream(service, id);
+  if(stream == NULL || service->stopping) {
+    pthread_mutex_unlock(&service->lock);
+    free(chunk);
+    return false;
+  }
+
+  if(stream->tail != NULL) {
+    stream->tail->next = chunk;
+  } else {
+    stream->head = chunk;
+    if(!stream->running) {
+      service->busy_streams ++;
+      service_push_ready(service, stream);
+    }
+  }
+  stream->tail = chunk;
+  service->queued_bytes += length;
+  pthread_mutex_unlock(&service->lock);
+  return true;
+}
+
+/*
+ * close the stream. its queued chunks are still decoded and the state is
+ * reused when they are done.
+ * return false if the stream is not open.
+ */
+bool lzss_service_close(LzssService *service, LzssServiceStreamId id) {
+  pthread_mutex_lock(&service->lock);
+  LzssServiceStream *stream = service_find_stream(service, id);
+  if(stream == NULL) {
+    pthread_mutex_unlock(&service->lock);
+    return false;
+  }
+  stream->open = false;
+  if(!stream->running && stream->head == NULL) {
+    service_release_stream(service, stream);
+  }
+  pthread_mutex_unlock(&service->lock);
+  return true;
+}
+
+/*
+ * wait until every queued chunk is decoded.
+ */
+void lzss_service_drain(LzssService *service) {
+  pthread_mutex_lock(&service->lock);
+  while(service->busy_streams > 0) {
+    pthread_cond_wait(&service->idle, &service->lock);
+  }
+  pthread_mutex_unlock(&service->lock);
+}
@@ -0,0 +1,70 @@
+#ifndef LZSS_SERVICE_H_
+#define LZSS_SERVICE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "lzss.h"
+
+#define LZSS_SERVICE_SLAB_SIZE 256     // stream states allocated at once
+#define LZSS_SERVICE_MAX_WORKERS 64
+#define LZSS_SERVICE_OUTPUT_SIZE 4096  // decompressed bytes per call of the sink
+
+typedef uint64_t LzssServiceStreamId;  // generation << 32 | slot
+
+/*
+ * called by a worker with the decompressed output of a stream. the output of
+ * a stream is passed in order and never from two workers at the same time, but
+ * different streams are passed concurrently.
+ */
+typedef void (*LzssServiceSink)(void *context, LzssServiceStreamId id, const uint8_t *data, size_t length);
+
+typedef struct LzssServiceChunk LzssServiceChunk;
+typedef struct LzssServiceStream LzssServiceStream;
+
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t ready;      // a stream has chunks to decode or the service stops
+  pthread_cond_t space;      // queued bytes were released
+  pthread_cond_t idle;       // the last chunk was decoded
+
+  LzssServiceStream **slabs;
+  size_t slab_count;
+  size_t max_streams;
+  LzssServiceStream *free_streams;
+  size_t open_streams;
+
+  LzssServiceStream *ready_head; // streams with chunks and no worker, in order
+  LzssServiceStream *ready_tail;
+
+  size_t queued_bytes;
+  size_t max_queued_bytes;
+  size_t busy_streams;       // streams with queued chunks or a worker
+
+  LzssServiceSink sink;
+  void *context;
+
+  pthread_t workers[LZSS_SERVICE_MAX_WORKERS];
+  size_t worker_count;
+  bool stopping;
+} LzssService;
+
+bool lzss_service_init(LzssService *service, size_t max_streams, size_t worker_count, size_t max_queued_bytes, LzssServiceSink sink, void *context);
+void lzss_service_deinit(LzssService *service);
+
+bool lzss_service_open(LzssService *service, const LzssPreset *preset, size_t packet_size, LzssServiceStreamId *id);
+bool lzss_service_submit(LzssService *service, LzssServiceStreamId id, const uint8_t *data, size_t length);
+bool lzss_service_close(LzssService *service, LzssServiceStreamId id);
+void lzss_service_drain(LzssService *service);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LZSS_SERVICE_H_
@@ -0,0 +1,114 @@
+extern "C"
+{
+#include "logger.h"
+#include "logger_columnar.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "logger_columnar.c"
+}
+
+#define BUFSIZE (65536)
+
+//CppUTest includes should be after your system includes
+#include "CppUTest/TestHarness.h"
+
+
+
+static char text[BUFSIZE];
+static char restored[BUFSIZE];
+
+TEST_GROUP(LOGGER_COLUMNAR) {
+  size_t text_len;
+  uint8_t *archive;
+  size_t archive_len;
+
+  void setup() {
+    archive = NULL;
+  }
+
+  void teardown() {
+    free(archive);
+  }
+
+  /*
+   * a log of a dynamic id with a float, a crc and a counter, and debug text.
+   */
+  void generate_log(size_t entries) {
+    unsigned long seed = 11;
+    size_t i;
+    text_len = sprintf(text, "\n1004|F000|temp %%.2f crc %%08X n %%d|\n");
+    for(i = 0; i < entries; i ++) {
+      seed = seed * 1103515245 + 12345;
+      const unsigned long r = (seed >> 16) & 0x7fff;
+      if(i % 4 == 3) {
+        text_len += sprintf(text + text_len, "\n1000:%lX|debug value %lu|\n", r % 300 + 1, r % 7);
+      } else {
+        text_len += sprintf(text + text_len, "\nF000|%.2f|%08X|%d|\n", 20 + (r % 50) / 100.0, (unsigned int) (seed >> 8), (int) i);
+      }
+    }
+  }
+
+  void check_round_trip() {
+    archive = logger_columnar_encode(text, text_len, &archive_len);
+    CHECK(archive != NULL);
+
+    size_t text_size;
+    CHECK_TRUE(logger_columnar_read_header(archive, archive_len, &text_size));
+    CHECK_EQUAL(text_len, text_size);
+    size_t n = logger_columnar_decode(restored, BUFSIZE, archive, archive_len);
+    CHECK_EQUAL(text_len, n);
+    MEMCMP_EQUAL(text, restored, n);
+  }
+
+};
+
+TEST(LOGGER_COLUMNAR, LoggerColumnar_EncodedLog_IsRestoredExactlyAndSmaller) {
+  generate_log(400);
+  check_round_trip();
+  CHECK(archive_len < text_len / 2);
+}
+
+TEST(LOGGER_COLUMNAR, LoggerColumnar_TextThatIsNotCanonical_IsRestoredExactly) {
+  text_len = sprintf(text, "garbage\n\n8001|\n\n800a|lower|\n\nF000|1.5|x|\n\n8009:0A|1|2|\n"
+      "\n8009:A|1|2|3|\n\n8009|1|2|\n\n1000|no end\n\n1000|%s|\n\n8017|", "x|y");
+  check_round_trip();
+}
+
+TEST(LOGGER_COLUMNAR, LoggerColumnar_Cursor_ReadsOneParameterOfAnId) {
+  LoggerColumnarCursor cursor;
+  LoggerColumnarValue value;
+  text_len = sprintf(text, "\n1004|F000|temp %%.2f crc %%08X n %%d|\n\nF000|21.49|0000ABCD|1|\n"
+      "\n1000|debug|\n\nF000|20.50|0000ABCE|2|\n\nF000|nan|00000001|3|\n");
+  archive = logger_columnar_encode(text, text_len, &archive_len);
+
+  CHECK_TRUE(logger_columnar_cursor_init(&cursor, archive, archive_len, 0xF000, 0));
+  CHECK_TRUE(logger_columnar_cursor_next(&cursor, &value));
+  CHECK_TRUE(value.is_number);
+  CHECK_EQUAL(2149, value.number);
+  CHECK_EQUAL(2, value.decimals);
+  CHECK_TRUE(logger_columnar_cursor_next(&cursor, &value));
+  CHECK_EQUAL(2050, value.number);
+  CHECK_TRUE(logger_columnar_cursor_next(&cursor, &value));
+  CHECK_FALSE(value.is_number);
+  CHECK_EQUAL(3, value.length);
+  MEMCMP_EQUAL("nan", value.string, value.length);
+  CHECK_FALSE(logger_columnar_cursor_next(&cursor, &value));
+
+  CHECK_TRUE(logger_columnar_cursor_init(&cursor, archive, archive_len, 0xF000, 1));
+  CHECK_TRUE(logger_columnar_cursor_next(&cursor, &value));
+  CHECK_EQUAL(0xABCD, value.number);
+  CHECK_FALSE(logger_columnar_cursor_init(&cursor, archive, archive_len, 0xF000, 3));
+  CHECK_FALSE(logger_columnar_cursor_init(&cursor, archive, archive_len, 0x8001, 0));
+}
+
+TEST(LOGGER_COLUMNAR, LoggerColumnar_DamagedArchive_IsRejected) {
+  generate_log(50);
+  check_round_trip();
+
+  CHECK_EQUAL(0, logger_columnar_decode(restored, text_len - 1, archive, archive_len));
+  CHECK_EQUAL(0, logger_columnar_decode(restored, BUFSIZE, archive, archive_len - 1));
+  archive[0] = 'X';
+  CHECK_EQUAL(0, logger_columnar_decode(restored, BUFSIZE, archive, archive_len));
+}
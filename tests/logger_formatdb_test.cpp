@@ -0,0 +1,131 @@
+extern "C"
+{
+#include "logger.h"
+#include "logger_formatdb.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "logger_formatdb.c"
+}
+
+//CppUTest includes should be after your system includes
+#include "CppUTest/TestHarness.h"
+
+
+
+static const char DEFS[] =
+    "LOG_ENTRY(FIRST,   0x8002, \"[T] bank %d: crc 0x%08X\")\n"
+    "/* a comment with LOG_ENTRY(NOT_AN_ENTRY, 0x0001, \"\")\n"
+    " * on two lines */\n"
+    "  LOG_ENTRY(SECOND,  0x8001, \"[T] Test\\t%4.2f \\\"C\\\"\" \" 100%%\")\n"
+    "LOG_ENTRY(DECIMAL, 10, \"\")\n";
+
+static const char DEFS_V2[] =
+    "LOG_ENTRY(FIRST,   0x8002, \"[T] bank %d written, crc %08X\")\n";
+
+TEST_GROUP(LOGGER_FORMATDB) {
+  uint8_t *data;
+  uint8_t *data_v2;
+  size_t length;
+  size_t length_v2;
+  size_t error_line;
+  LoggerFormatDb db;
+  LoggerFormatDb db_v2;
+
+  void setup() {
+    data = logger_formatdb_build(DEFS, strlen(DEFS), 1, &length, &error_line);
+    data_v2 = logger_formatdb_build(DEFS_V2, strlen(DEFS_V2), 2, &length_v2, &error_line);
+    CHECK(data != NULL && data_v2 != NULL);
+    CHECK_TRUE(logger_formatdb_open(&db, data, length));
+    CHECK_TRUE(logger_formatdb_open(&db_v2, data_v2, length_v2));
+  }
+
+  void teardown() {
+    free(data);
+    free(data_v2);
+    logger_set_format_resolver(NULL, NULL);
+  }
+
+  void check_invalid_defs(const char *defs, size_t line) {
+    size_t n;
+    uint8_t *p = logger_formatdb_build(defs, strlen(defs), 1, &n, &error_line);
+    free(p);
+    POINTERS_EQUAL(NULL, p);
+    CHECK_EQUAL(line, error_line);
+  }
+};
+
+TEST(LOGGER_FORMATDB, LoggerFormatDb_Build_KeepsTheEntriesOfTheDefsSortedById) {
+  LoggerFormatDbEntry entry;
+
+  CHECK_TRUE(logger_formatdb_verify(&db));
+  CHECK_EQUAL(1, db.firmware);
+  CHECK_EQUAL(3, db.id_count);
+
+  CHECK_TRUE(logger_formatdb_find(&db, 0x8001, &entry));
+  STRCMP_EQUAL("SECOND", entry.name);
+  STRCMP_EQUAL("[T] Test\t%4.2f \"C\" 100%%", entry.format);
+  CHECK_EQUAL(1, entry.field_count);
+
+  CHECK_TRUE(logger_formatdb_find(&db, 0x8002, &entry));
+  CHECK_EQUAL(2, entry.field_count);
+  STRCMP_EQUAL("FIRST", entry.name);
+
+  CHECK_TRUE(logger_formatdb_find(&db, 10, &entry));
+  STRCMP_EQUAL("", entry.format);
+  CHECK_FALSE(logger_formatdb_find(&db, 0x0001, &entry));
+  CHECK_FALSE(logger_formatdb_find(&db, 0xFFFF, &entry));
+}
+
+TEST(LOGGER_FORMATDB, LoggerFormatDb_InvalidDefs_ReturnTheLineOfTheError) {
+  check_invalid_defs("LOG_ENTRY(A, 0x1, \"a\")\n\nLOG_ENTRY(B, 0x1, \"b\")\n", 3);
+  check_invalid_defs("LOG_ENTRY(A, 0x1, \"a\")\nLOG_ENTRY(B, 0x2, \"%q\")\n", 2);
+  check_invalid_defs("LOG_ENTRY(A, 0x1, \"a)\n", 1);
+  check_invalid_defs("LOG_ENTRY(A, 0x10000, \"a\")\n", 1);
+  check_invalid_defs("LOG_ENTRY(A 0x1, \"a\")\n", 1);
+}
+
+TEST(LOGGER_FORMATDB, LoggerFormatDb_DecodersOfTwoFirmwares_UseTheirOwnFormats) {
+  const char *src = "\n8002|3|0000ABCD|\n";
+  char dst[256];
+  size_t consumed, n;
+  LoggerDecoder decoder, decoder_v2;
+
+  logger_decoder_init(&decoder);
+  logger_decoder_init(&decoder_v2);
+  logger_decoder_set_format_resolver(&decoder, logger_formatdb_resolve, &db);
+  logger_decoder_set_format_resolver(&decoder_v2, logger_formatdb_resolve, &db_v2);
+
+  n = logger_decoder_decode(&decoder, dst, sizeof(dst), src, strlen(src), &consumed);
+  dst[n] = 0;
+  STRCMP_EQUAL("[0x8002][T] bank 3: crc 0x0000ABCD\n", dst);
+  n = logger_decoder_decode(&decoder_v2, dst, sizeof(dst), src, strlen(src), &consumed);
+  dst[n] = 0;
+  STRCMP_EQUAL("[0x8002][T] bank 3 written, crc 0000ABCD\n", dst);
+
+  logger_set_format_resolver(logger_formatdb_resolve, &db_v2);
+  n = logger_decode(dst, sizeof(dst), src, strlen(src), &consumed);
+  dst[n] = 0;
+  STRCMP_EQUAL("[0x8002][T] bank 3 written, crc 0000ABCD\n", dst);
+  STRCMP_EQUAL("[T] bank %d written, crc %08X", logger_get_format(0x8002));
+}
+
+TEST(LOGGER_FORMATDB, LoggerFormatDb_DamagedDatabase_IsRejected) {
+  LoggerFormatDb damaged;
+  LoggerFormatDbEntry entry;
+
+  CHECK_FALSE(logger_formatdb_open(&damaged, data, length - 1));
+  CHECK_FALSE(logger_formatdb_open(&damaged, data, LOGGER_FORMATDB_HEADER_SIZE - 1));
+
+  data[length - 2] ^= 1;
+  CHECK_TRUE(logger_formatdb_open(&damaged, data, length));
+  CHECK_FALSE(logger_formatdb_verify(&damaged));
+
+  write_u32(data + LOGGER_FORMATDB_HEADER_SIZE + 8, db.pool_size); // format offset of the first id
+  CHECK_FALSE(logger_formatdb_find(&damaged, 10, &entry));
+  CHECK_TRUE(logger_formatdb_find(&damaged, 0x8001, &entry));
+
+  data[0] = 'X';
+  CHECK_FALSE(logger_formatdb_open(&damaged, data, length));
+}
@@ -0,0 +1,159 @@
+extern "C"
+{
+#include "logger.h"
+#include "logger_index.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "logger_index.c"
+}
+
+#define BUFSIZE (1024)
+
+//CppUTest includes should be after your system includes
+#include "CppUTest/TestHarness.h"
+
+
+
+TEST_GROUP(LOGGER_INDEX) {
+  LoggerIndexPacket packet;
+  LoggerIndexBuilder builder;
+  char buffer[BUFSIZE];
+
+  void setup() {
+    logger_index_packet_init(&packet);
+    logger_index_builder_init(&builder);
+  }
+
+  void teardown() {
+  }
+
+  void scan(LoggerIndexPacket *p, const char *text) {
+    logger_index_builder_scan(&builder, p, text, strlen(text));
+  }
+
+};
+
+TEST(LOGGER_INDEX, LoggerIndex_EmptyPacket_ContainsNothing) {
+  CHECK_FALSE(logger_index_packet_may_contain(&packet, 0x0000, 0xFFFF));
+}
+
+TEST(LOGGER_INDEX, LoggerIndex_AddId_ContainsTheId) {
+  logger_index_packet_add_id(&packet, 0x800C);
+  CHECK_TRUE(logger_index_packet_may_contain(&packet, 0x800C, 0x800C));
+  CHECK_TRUE(logger_index_packet_may_contain(&packet, 0x8000, 0x80FF));
+  CHECK_FALSE(logger_index_packet_may_contain(&packet, 0x0000, 0x00FF));
+  CHECK_FALSE(logger_index_packet_may_contain(&packet, 0x800D, 0x800D));
+}
+
+TEST(LOGGER_INDEX, LoggerIndex_ScanText_AddsTheIdsOfTheEntries) {
+  scan(&packet, "garbage|\n\n8017|21.49|\n\n800c|1|\nnot an entry|\n");
+  CHECK_EQUAL(2, packet.count);
+  CHECK_EQUAL(0x800C, packet.min_id);
+  CHECK_EQUAL(0x8017, packet.max_id);
+}
+
+TEST(LOGGER_INDEX, LoggerIndex_ScanHeaderSplitBetweenPackets_AddsTheIdToTheFirstPacket) {
+  LoggerIndexPacket next;
+  logger_index_packet_init(&next);
+
+  scan(&packet, "\n8017|21.49|\n\n80");
+  scan(&next, "0C|1|\n");
+  CHECK_EQUAL(2, packet.count);
+  CHECK_TRUE(logger_index_packet_may_contain(&packet, 0x800C, 0x800C));
+  CHECK_EQUAL(0, next.count);
+}
+
+TEST(LOGGER_INDEX, LoggerIndex_SelectDynamicIds_LearnsTheDefinitionsOfOtherPackets) {
+  const char *texts[] = { "\n1004|F000|n %d|\n\n8017|21.49|\n", "\nF000|5|\n" };
+  const LoggerIdRange range = { 0xF000, 0xF000 };
+  static LoggerFormats formats;
+  LoggerIndexPacket packets[2];
+  size_t s_unused_bytes, i;
+
+  logger_formats_init(&formats);
+  for(i = 0; i < 2; i ++) {
+    logger_index_packet_init(&packets[i]);
+    scan(&packets[i], texts[i]);
+  }
+  CHECK_TRUE(packets[0].has_definitions);
+  CHECK_FALSE(logger_index_packet_may_contain(&packets[0], 0xF000, 0xF000));
+  CHECK_FALSE(packets[1].has_definitions);
+
+  for(i = 0; i < 2; i ++) {
+    unsigned long long time = packets[i].time;
+    size_t len = strlen(texts[i]);
+    size_t n = logger_index_select(buffer, BUFSIZE, texts[i], len, &s_unused_bytes, len, &range, 1, &time, &formats);
+    buffer[n] = 0;
+    STRCMP_EQUAL(i == 0 ? "" : "[0xF000]n 5\n", buffer);
+  }
+}
+
+TEST(LOGGER_INDEX, LoggerIndex_SerializePacket_ReadsTheSamePacket) {
+  uint8_t record[LOGGER_INDEX_PACKET_SIZE];
+  LoggerIndexPacket copy;
+
+  logger_index_packet_add_id(&packet, 0x0004);
+  logger_index_packet_add_id(&packet, 0x8100);
+  logger_index_packet_add_id(&packet, LOGGER_DEFINE_FORMAT);
+  packet.time = 0x123456789ULL;
+  logger_index_write_packet(record, &packet);
+  logger_index_read_packet(&copy, record);
+  CHECK_TRUE(copy.has_definitions);
+  CHECK_EQUAL(packet.min_id, copy.min_id);
+  CHECK_EQUAL(packet.max_id, copy.max_id);
+  CHECK_EQUAL(packet.count, copy.count);
+  CHECK(packet.time == copy.time);
+  MEMCMP_EQUAL(packet.filter, copy.filter, sizeof(packet.filter));
+}
+
+TEST(LOGGER_INDEX, LoggerIndex_Select_DecodesOnlyOwnedEntriesInTheRanges) {
+  const char *text = "17|21.49|\n\n800C|1|\n\n8017|21.52|\n\n800C|2|\n";
+  const LoggerIdRange range = { 0x800C, 0x800C };
+  size_t s_unused_bytes;
+  size_t owned_len = strlen("17|21.49|\n\n800C|1|\n\n8017|21.52|\n");
+
+  unsigned long long time = 0;
+
+  size_t n = logger_index_select(buffer, BUFSIZE, text, strlen(text), &s_unused_bytes, owned_len, &range, 1, &time, NULL);
+  buffer[n] = 0;
+  STRCMP_EQUAL("[0x800C]1\n", buffer);
+  CHECK_EQUAL(strlen("\n800C|2|\n"), s_unused_bytes);
+}
+
+TEST(LOGGER_INDEX, LoggerIndex_SelectTimestampedEntries_GetTheTimeOfAFullDecode) {
+  const char *texts[] = { "\n8017:A|21.49|\n\n800C:A|1|\n\n8017:", "A|21.52|\n\n800C:A|2|\n" };
+  const LoggerIdRange range = { 0x800C, 0x800C };
+  LoggerIndexPacket packets[2];
+  size_t s_unused_bytes, i;
+
+  for(i = 0; i < 2; i ++) {
+    logger_index_packet_init(&packets[i]);
+    scan(&packets[i], texts[i]);
+  }
+  CHECK_EQUAL(0, packets[0].time);
+  CHECK_EQUAL(30, packets[1].time);
+
+  for(i = 0; i < 2; i ++) {
+    unsigned long long time = packets[i].time;
+    size_t len = strlen(texts[i]);
+    size_t n = logger_index_select(buffer, BUFSIZE, texts[i], len, &s_unused_bytes, len, &range, 1, &time, NULL);
+    buffer[n] = 0;
+    STRCMP_EQUAL(i == 0 ? "[0x800C][@20]1\n" : "[0x800C][@40]2\n", buffer);
+  }
+}
+
+TEST(LOGGER_INDEX, LoggerIndex_ScanAnchoredEntries_GivesThePacketsTheAbsoluteTime) {
+  const char *texts[] = { "\n8017:A|21.49|\n\n800C@1F4|1|\n\n8017", "@2BC|21.52|\n\n800C:A|2|\n" };
+  LoggerIndexPacket packets[2];
+  size_t i;
+
+  for(i = 0; i < 2; i ++) {
+    logger_index_packet_init(&packets[i]);
+    scan(&packets[i], texts[i]);
+  }
+  CHECK_EQUAL(0, packets[0].time);
+  CHECK_EQUAL(700, packets[1].time);
+  CHECK(builder.time == 710);
+}
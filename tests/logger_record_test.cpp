@@ -0,0 +1,89 @@
+extern "C"
+{
+#include "logger.h"
+#include "logger_record.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "logger_record.c"
+}
+
+#define BUFSIZE (1024)
+
+//CppUTest includes should be after your system includes
+#include "CppUTest/TestHarness.h"
+
+
+
+TEST_GROUP(LOGGER_RECORD) {
+  LoggerRecord record;
+  char buffer[BUFSIZE];
+
+  void setup() {
+    record.id = 0x8017;
+    record.format = NULL;
+    record.has_time = false;
+    record.field_count = 0;
+  }
+
+  void teardown() {
+  }
+
+  void add_field(const char *data, char specifier) {
+    LoggerField *field = &record.fields[record.field_count ++];
+    field->data = data;
+    field->length = strlen(data);
+    field->specifier = specifier;
+  }
+
+  const char *write_json() {
+    size_t n = logger_record_write_json(&record, buffer, BUFSIZE - 1);
+    buffer[n] = 0;
+    return buffer;
+  }
+
+  const char *write_csv() {
+    size_t n = logger_record_write_csv(&record, buffer, BUFSIZE - 1);
+    buffer[n] = 0;
+    return buffer;
+  }
+
+};
+
+TEST(LOGGER_RECORD, LoggerRecord_WriteJson_WritesNumbersByTheirSpecifiers) {
+  record.has_time = true;
+  record.time = 100;
+  add_field("  21.49", 'f');
+  add_field("-3", 'd');
+  add_field("327B23C6", 'X');
+  add_field("1.2.3", 'f');
+  STRCMP_EQUAL("{\"id\":32791,\"time\":100,\"fields\":[21.49,-3,\"327B23C6\",\"1.2.3\"]}\n", write_json());
+}
+
+TEST(LOGGER_RECORD, LoggerRecord_WriteJsonWithLeadingZeros_WritesThemAsStrings) {
+  add_field("00042", 'd');
+  add_field("-007.50", 'f');
+  add_field("0", 'u');
+  add_field("-0.25", 'f');
+  add_field("++3", 'd');
+  STRCMP_EQUAL("{\"id\":32791,\"fields\":[\"00042\",\"-007.50\",0,-0.25,\"++3\"]}\n", write_json());
+}
+
+TEST(LOGGER_RECORD, LoggerRecord_WriteJsonString_EscapesQuotesAndControlCharacters) {
+  add_field("a \"b\"\\\r", 's');
+  STRCMP_EQUAL("{\"id\":32791,\"fields\":[\"a \\\"b\\\"\\\\\\u000D\"]}\n", write_json());
+}
+
+TEST(LOGGER_RECORD, LoggerRecord_WriteCsv_QuotesFieldsWithSeparators) {
+  add_field("21.49", 'f');
+  add_field("a,\"b\"", 's');
+  add_field("c", 0);
+  STRCMP_EQUAL("32791,,21.49,\"a,\"\"b\"\"\",c\n", write_csv());
+}
+
+TEST(LOGGER_RECORD, LoggerRecord_WriteInSmallBuffer_WritesNothing) {
+  add_field("21.49", 'f');
+  CHECK_EQUAL(0, logger_record_write_json(&record, buffer, 10));
+  CHECK_EQUAL(0, logger_record_write_csv(&record, buffer, 10));
+}
@@ -0,0 +1,183 @@
+extern "C"
+{
+#include "logger.h"
+#include "logger_recorder.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "logger_recorder.c"
+}
+
+#define CAPACITY (1024)
+
+//CppUTest includes should be after your system includes
+#include "CppUTest/TestHarness.h"
+
+
+
+static char path[64];
+static uint8_t recovered[CAPACITY];
+
+TEST_GROUP(LOGGER_RECORDER) {
+  LoggerRecorder recorder;
+
+  void setup() {
+    strcpy(path, "/tmp/logger_recorder_XXXXXX");
+    int fd = mkstemp(path);
+    close(fd);
+    CHECK_TRUE(logger_recorder_open(&recorder, path, CAPACITY));
+  }
+
+  void teardown() {
+    logger_recorder_close(&recorder);
+    unlink(path);
+  }
+
+  size_t make_entry(char *entry, int i) {
+    return sprintf(entry, "\n8009|%d|%08X|%.*s|\n", i, (unsigned int) (i * 2654435761u), i % 40, "0123456789012345678901234567890123456789");
+  }
+
+  /*
+   * check that the recovered entries are the last entries until count.
+   */
+  void check_recovered(int count) {
+    char entry[128];
+    size_t n = logger_recorder_recover(recovered, CAPACITY, recorder.map, recorder.map_length);
+    size_t len = 0;
+    int i = count;
+
+    CHECK(n > 0);
+    while(len < n) {
+      len += make_entry(entry, -- i);
+    }
+    CHECK_EQUAL(n, len);
+    for(len = 0; i < count; i ++) {
+      size_t entry_len = make_entry(entry, i);
+      MEMCMP_EQUAL(entry, recovered + len, entry_len);
+      len += entry_len;
+    }
+  }
+};
+
+TEST(LOGGER_RECORDER, LoggerRecorder_FullFile_KeepsTheLastEntries) {
+  char entry[128];
+  int i;
+
+  CHECK_EQUAL(0, logger_recorder_recover(recovered, CAPACITY, recorder.map, recorder.map_length));
+  logger_recorder_set_active(&recorder);
+  for(i = 0; i < 500; i ++) {
+    size_t len = make_entry(entry, i);
+    logger_recorder_write((const uint8_t *) entry, len);
+    if(i == 3) {
+      check_recovered(i + 1);
+    }
+  }
+  check_recovered(i);
+  CHECK(recorder.tail - recorder.head <= CAPACITY);
+
+  CHECK_FALSE(logger_recorder_append(&recorder, recovered, CAPACITY));
+  CHECK_EQUAL(1, recorder.dropped);
+  check_recovered(i);
+}
+
+TEST(LOGGER_RECORDER, LoggerRecorder_Crash_KeepsTheCompleteFrames) {
+  char entry[128];
+  int i;
+
+  for(i = 0; i < 100; i ++) {
+    logger_recorder_append(&recorder, (const uint8_t *) entry, make_entry(entry, i));
+  }
+  // the tail was not updated after the last frame
+  *recorder_position(recorder.map, TAIL_OFFSET) -= recorder_frame_size(make_entry(entry, i - 1));
+  check_recovered(i);
+
+  // the next frame was torn: its checksum does not match the payload
+  const uint64_t tail = recorder.tail;
+  logger_recorder_append(&recorder, (const uint8_t *) entry, make_entry(entry, i));
+  recorder.frames[tail % CAPACITY + LOGGER_RECORDER_FRAME_HEADER_SIZE + 3] ^= 1;
+  check_recovered(i);
+
+  // the file is opened again after the restart and the new entries follow
+  logger_recorder_close(&recorder);
+  CHECK_TRUE(logger_recorder_open(&recorder, path, CAPACITY));
+  for(; i < 110; i ++) {
+    logger_recorder_append(&recorder, (const uint8_t *) entry, make_entry(entry, i));
+  }
+  check_recovered(i);
+}
+
+#define RECORDER_THREADS 4
+#define RECORDER_ENTRIES 500
+
+static void *append_entries(void *context) {
+  char entry[32];
+  int i;
+  for(i = 0; i < RECORDER_ENTRIES; i ++) {
+    logger_recorder_write((const uint8_t *) entry, sprintf(entry, "\n8009|%ld|%d|\n", (long) context, i));
+  }
+  return NULL;
+}
+
+TEST(LOGGER_RECORDER, LoggerRecorder_AppendFromThreads_WritesEveryFrameWhole) {
+  pthread_t threads[RECORDER_THREADS];
+  int last[RECORDER_THREADS];
+  LoggerRecorderReader reader;
+  const uint8_t *data;
+  size_t length;
+  long t;
+
+  logger_recorder_set_active(&recorder);
+  for(t = 0; t < RECORDER_THREADS; t ++) {
+    pthread_create(&threads[t], NULL, append_entries, (void *) t);
+  }
+  for(t = 0; t < RECORDER_THREADS; t ++) {
+    pthread_join(threads[t], NULL);
+    last[t] = -1;
+  }
+
+  CHECK_TRUE(logger_recorder_reader_init(&reader, recorder.map, recorder.map_length));
+  while(logger_recorder_reader_next(&reader, &data, &length)) {
+    int thread, i;
+    CHECK_EQUAL(2, sscanf((const char *) data, "\n8009|%d|%d|", &thread, &i));
+    CHECK(i > last[thread]);
+    last[thread] = i;
+  }
+  CHECK_EQUAL(recorder.tail, reader.position);
+  CHECK_EQUAL(recorder.sequence, reader.sequence);
+}
+
+static const char *resolve_reboot_entries(void *context, LogId id) {
+  return id == NIQ_LOG_DIE_OOM ? "[U] !!!DEAD END (out of memory), rebooting..."
+      : id == NIQ_LOG_CFT_RESET_DETECTED ? "[C] Watchdog reset detected" : NULL;
+}
+
+TEST(LOGGER_RECORDER, LoggerRecorder_RecoveredEntries_AreDecoded) {
+  const char *entries[] = { "\n8003|\n", "\n8013|\n" };
+  LoggerDecoder decoder;
+  char decoded[256];
+  size_t consumed, i;
+
+  for(i = 0; i < 2; i ++) {
+    logger_recorder_append(&recorder, (const uint8_t *) entries[i], strlen(entries[i]));
+  }
+  size_t n = logger_recorder_recover(recovered, CAPACITY, recorder.map, recorder.map_length);
+  logger_decoder_init(&decoder);
+  logger_decoder_set_format_resolver(&decoder, resolve_reboot_entries, NULL);
+  n = logger_decoder_decode(&decoder, decoded, sizeof(decoded) - 1, (const char *) recovered, n, &consumed);
+  decoded[n] = 0;
+  STRCMP_EQUAL("[0x8003][U] !!!DEAD END (out of memory), rebooting...\n[0x8013][C] Watchdog reset detected\n", decoded);
+}
+
+TEST(LOGGER_RECORDER, LoggerRecorder_OtherFiles_AreNotRead) {
+  LoggerRecorder other;
+
+  recorder.map[0] = 'X';
+  CHECK_EQUAL(0, logger_recorder_recover(recovered, CAPACITY, recorder.map, recorder.map_length));
+  recorder.map[0] = 'L';
+  CHECK_EQUAL(0, logger_recorder_recover(recovered, CAPACITY, recorder.map, recorder.map_length - 16));
+  CHECK_FALSE(logger_recorder_open(&other, path, CAPACITY + 8));
+  CHECK_FALSE(logger_recorder_open(&other, path, 128));
+}
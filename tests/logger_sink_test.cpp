@@ -0,0 +1,169 @@
+extern "C"
+{
+#include "logger.h"
+#include "logger_sink.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "logger_sink.c"
+}
+
+#define ENTRY_SIZE (64)
+
+//CppUTest includes should be after your system includes
+#include "CppUTest/TestHarness.h"
+
+
+
+static char directory[64];
+static char path[128];
+
+TEST_GROUP(LOGGER_SINK) {
+  LoggerSink sink;
+  LoggerSinkConfig config;
+
+  void setup() {
+    strcpy(directory, "/tmp/logger_sink_XXXXXX");
+    CHECK(mkdtemp(directory) != NULL);
+    snprintf(path, sizeof(path), "%s/log", directory);
+    memset(&config, 0, sizeof(config));
+    config.path = path;
+    config.buffer_size = 4096;
+  }
+
+  void teardown() {
+    char name[160];
+    unsigned int i;
+    unlink(path);
+    for(i = 1; i <= 4; i ++) {
+      snprintf(name, sizeof(name), "%s.%u", path, i);
+      unlink(name);
+    }
+    rmdir(directory);
+  }
+
+  size_t make_entry(char *entry, unsigned int i) {
+    return snprintf(entry, ENTRY_SIZE, "\n8009|%u|%08X|\n", i, i * 2654435761u);
+  }
+
+  void append_entries(unsigned int first, unsigned int count) {
+    char entry[ENTRY_SIZE];
+    unsigned int i;
+    for(i = first; i < first + count; i ++) {
+      while(!logger_sink_append(&sink, (const uint8_t *) entry, make_entry(entry, i))) {
+        usleep(1000); // the writer is behind
+      }
+    }
+  }
+
+  /*
+   * return the length of the file after checking that it holds consecutive
+   * entries from first and set next to the entry after the last one.
+   */
+  size_t check_file(const char *name, unsigned int first, unsigned int *next) {
+    static char content[256 * 1024];
+    char entry[ENTRY_SIZE];
+    FILE *file = fopen(name, "rb");
+    CHECK(file != NULL);
+    size_t len = fread(content, 1, sizeof(content), file), pos = 0;
+    fclose(file);
+    while(pos < len) {
+      size_t n = make_entry(entry, first ++);
+      CHECK(pos + n <= len);
+      MEMCMP_EQUAL(entry, content + pos, n);
+      pos += n;
+    }
+    *next = first;
+    return len;
+  }
+};
+
+TEST(LOGGER_SINK, LoggerSink_Entries_AreWrittenInOrder) {
+  LoggerSinkStats stats;
+  unsigned int next;
+  bool io_uring;
+
+  for(io_uring = false; ; io_uring = true) {
+    config.use_io_uring = io_uring;
+    CHECK_TRUE(logger_sink_init(&sink, &config));
+    logger_sink_set_active(&sink);
+    append_entries(0, 5000);
+    char entry[ENTRY_SIZE];
+    logger_sink_write((const uint8_t *) entry, make_entry(entry, 5000));
+    logger_sink_get_stats(&sink, &stats);
+    logger_sink_deinit(&sink);
+
+    CHECK_EQUAL(5001, stats.entries);
+    CHECK_EQUAL(0, stats.write_errors);
+    const size_t len = check_file(path, 0, &next);
+    CHECK_EQUAL(5000 + 1, next);
+    CHECK_EQUAL(stats.bytes, len);
+    unlink(path);
+    if(io_uring) {
+      break;
+    }
+  }
+}
+
+TEST(LOGGER_SINK, LoggerSink_LargeFile_IsRotated) {
+  LoggerSinkStats stats;
+  unsigned int next, first = 0;
+  size_t len;
+
+  config.max_file_size = 8192;
+  config.max_files = 2;
+  CHECK_TRUE(logger_sink_init(&sink, &config));
+  append_entries(0, 4000); // about 100 KB
+  logger_sink_flush(&sink);
+  logger_sink_get_stats(&sink, &stats);
+  logger_sink_deinit(&sink);
+
+  CHECK(stats.rotations >= 10);
+  snprintf(path + strlen(path), 8, ".3");
+  CHECK_EQUAL(-1, access(path, F_OK));
+  path[strlen(path) - 2] = 0;
+
+  char name[160];
+  snprintf(name, sizeof(name), "%s.2", path);
+  FILE *file = fopen(name, "rb");
+  CHECK_EQUAL(1, fscanf(file, "\n8009|%u|", &first)); // the first entry of the oldest file
+  fclose(file);
+
+  len = check_file(name, first, &next);
+  CHECK(len <= 8192);
+  snprintf(name, sizeof(name), "%s.1", path);
+  len = check_file(name, next, &next);
+  CHECK(len <= 8192 && len > 0);
+  len = check_file(path, next, &next);
+  CHECK(len <= 8192 && len > 0);
+  CHECK_EQUAL(4000, next);
+}
+
+TEST(LOGGER_SINK, LoggerSink_BufferThatIsNotFull_IsWrittenAfterTheLatency) {
+  unsigned int next;
+
+  config.flush_latency = 10;
+  CHECK_TRUE(logger_sink_init(&sink, &config));
+  append_entries(0, 3);
+  usleep(100 * 1000);
+  check_file(path, 0, &next);
+  CHECK_EQUAL(3, next);
+
+  append_entries(3, 2);
+  logger_sink_flush(&sink);
+  check_file(path, 0, &next);
+  CHECK_EQUAL(5, next);
+  logger_sink_deinit(&sink);
+}
+
+TEST(LOGGER_SINK, LoggerSink_InvalidConfig_IsRejected) {
+  config.max_file_size = 8192;
+  CHECK_FALSE(logger_sink_init(&sink, &config));
+  config.max_files = LOGGER_SINK_MAX_FILES + 1;
+  CHECK_FALSE(logger_sink_init(&sink, &config));
+  config.max_files = 1;
+  config.path = "/nonexistent/directory/log";
+  CHECK_FALSE(logger_sink_init(&sink, &config));
+}
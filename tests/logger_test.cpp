@@ -5,7 +5,10 @@ extern "C"
 #include <time.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
 
+#include "logger_recorder.h"
 #include "logger.c"
 }
 
@@ -286,6 +289,798 @@ TEST(LOGGER_LOG, Logger_printfWithParam_LogsTheFormattedString) {
 }
 
 
+static uint32_t test_ticks;
+
+static uint32_t test_clock(void) {
+  return test_ticks;
+}
+
+TEST_GROUP(LOGGER_TIMESTAMP) {
+  char buffer[BUFSIZE];
+  char text[BUFSIZE];
+
+  void setup() {
+    test_ticks = 100;
+    logger_set_clock(test_clock);
+  }
+
+  void teardown() {
+    logger_set_clock(NULL);
+    log_entries_count = 0;
+    log_writers_count = 0;
+  }
+
+};
+
+TEST(LOGGER_TIMESTAMP, Logger_printfWithClock_WritesTheTicksAfterTheId) {
+  logger_register_log_writer(log_writer_function_1, SEVERITY_INFO, false);
+
+  logger_printf(" this is a test");
+  logger1.read(buffer);
+  STRCMP_EQUAL("[0x1000][@100] this is a test\n", buffer);
+}
+
+TEST(LOGGER_TIMESTAMP, Logger_printfEncodedWithClock_WritesTheTicksSinceThePreviousEntry) {
+  logger_register_log_writer(log_writer_function_1, SEVERITY_INFO, true);
+
+  logger_printf("first");
+  test_ticks = 126;
+  logger_printf("second");
+  logger1.read(buffer);
+  STRCMP_EQUAL("\n1000:64|first|\n\n1000:1A|second|\n", buffer);
+}
+
+TEST(LOGGER_TIMESTAMP, LoggerDecoder_DecodeTimestampedText_WritesTheAbsoluteTicks) {
+  size_t n;
+  LogEntry entries[] = { { .id = 42, .format = " This entry has %s id" } };
+  logger_register_log_entries(entries, 1);
+  strcpy(text, "\n002A:64|a|\n\n002A|no time|\n\n002a:1a|the|\n");
+  size_t s_unused_bytes;
+  n = logger_decode(buffer, BUFSIZE, text, strlen(text), &s_unused_bytes);
+  buffer[n] = 0;
+  STRCMP_EQUAL("[0x002A][@100] This entry has a id\n[0x002A] This entry has no time id\n[0x002A][@126] This entry has the id\n", buffer);
+}
+
+TEST(LOGGER_TIMESTAMP, Logger_printfWithAnchorInterval_WritesTheAbsoluteTicks) {
+  logger_register_log_writer(log_writer_function_1, SEVERITY_INFO, true);
+  logger_set_time_anchor_interval(2);
+
+  logger_printf("first");
+  test_ticks = 126;
+  logger_printf("second");
+  test_ticks = 130;
+  logger_printf("third");
+  logger_anchor_time();
+  test_ticks = 140;
+  logger_printf("fourth");
+  logger_set_time_anchor_interval(0);
+  logger1.read(buffer);
+  STRCMP_EQUAL("\n1000@64|first|\n\n1000:1A|second|\n\n1000@82|third|\n\n1000@8C|fourth|\n", buffer);
+}
+
+TEST(LOGGER_TIMESTAMP, LoggerDecoder_DecodeLogWithoutItsBeginning_IsAbsoluteFromTheAnchor) {
+  size_t n;
+  LogEntry entries[] = { { .id = 42, .format = "%s" } };
+  logger_register_log_entries(entries, 1);
+  strcpy(text, "\n002A:10|a|\n\n002A@1F4|b|\n\n002A:A|c|\n\n002A:FFFFFFFF|d|\n");
+  size_t s_unused_bytes;
+  n = logger_decode(buffer, BUFSIZE, text, strlen(text), &s_unused_bytes);
+  buffer[n] = 0;
+  STRCMP_EQUAL("[0x002A][@16]a\n[0x002A][@500]b\n[0x002A][@510]c\n[0x002A][@509]d\n", buffer);
+}
+
+TEST(LOGGER_TIMESTAMP, LoggerDecoder_AdvanceTimeToAnAnchor_KeepsTheWrapsOfTheClock) {
+  unsigned long long time = 0x1FFFFFFF0ull;
+  logger_decode_advance_time(&time, 0x10, true);
+  CHECK(time == 0x200000010ull);
+  logger_decode_advance_time(&time, 0x0, true);
+  CHECK(time == 0x200000000ull);
+  logger_decode_advance_time(&time, 0xFFFFFFF0ul, false);
+  CHECK(time == 0x1FFFFFFF0ull);
+}
+
+#define TIMESTAMP_THREADS 4
+#define TIMESTAMP_ENTRIES 200
+
+static char timestamp_log[TIMESTAMP_THREADS * TIMESTAMP_ENTRIES * 16];
+static size_t timestamp_log_length;
+static pthread_mutex_t timestamp_log_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t counting_ticks(void) {
+  return __atomic_add_fetch(&test_ticks, 1, __ATOMIC_RELAXED);
+}
+
+static void timestamp_log_writer(const uint8_t *data, const size_t length) {
+  pthread_mutex_lock(&timestamp_log_lock);
+  memcpy(timestamp_log + timestamp_log_length, data, length);
+  timestamp_log_length += length;
+  pthread_mutex_unlock(&timestamp_log_lock);
+}
+
+static void *log_timestamped_entries(void *context) {
+  int i;
+  for(i = 0; i < TIMESTAMP_ENTRIES; i ++) {
+    logger_printf("t");
+  }
+  return NULL;
+}
+
+TEST(LOGGER_TIMESTAMP, Logger_printfFromThreads_CountsEveryTickOnce) {
+  pthread_t threads[TIMESTAMP_THREADS];
+  LoggerRecord record;
+  unsigned long long time = 0;
+  size_t s_unused_bytes, count = 0;
+  long t;
+
+  logger_register_log_writer(timestamp_log_writer, SEVERITY_INFO, true);
+  logger_set_clock(counting_ticks);
+  test_ticks = 0;
+  timestamp_log_length = 0;
+
+  for(t = 0; t < TIMESTAMP_THREADS; t ++) {
+    pthread_create(&threads[t], NULL, log_timestamped_entries, (void *) t);
+  }
+  for(t = 0; t < TIMESTAMP_THREADS; t ++) {
+    pthread_join(threads[t], NULL);
+  }
+
+  const char *pos = timestamp_log;
+  size_t len = timestamp_log_length;
+  while(logger_decode_record(&record, pos, len, &s_unused_bytes, &time, NULL)) {
+    pos += len - s_unused_bytes;
+    len = s_unused_bytes;
+    CHECK_TRUE(record.has_time);
+    count ++;
+  }
+  CHECK_EQUAL(TIMESTAMP_THREADS * TIMESTAMP_ENTRIES, count);
+  CHECK(time == TIMESTAMP_THREADS * TIMESTAMP_ENTRIES);
+}
+
+TEST(LOGGER_TIMESTAMP, LoggerDecoder_DecodeInvalidTimestamp_WritesTextAsItIs) {
+  size_t n;
+  strcpy(text, "\n002A:|a|\n");
+  size_t s_unused_bytes;
+  n = logger_decode(buffer, BUFSIZE, text, strlen(text), &s_unused_bytes);
+  buffer[n] = 0;
+  STRCMP_EQUAL("[0xFFFF][L] 002A:|a|\n", buffer);
+}
+
+
+TEST_GROUP(LOGGER_INTERNING) {
+  char buffer[BUFSIZE];
+  char text[BUFSIZE];
+
+  void setup() {
+    logger_set_printf_interning(true);
+  }
+
+  void teardown() {
+    logger_set_printf_interning(false);
+    logger_set_definition_interval(0);
+    memset(log_dynamic_formats, 0, sizeof(log_dynamic_formats));
+    log_entries_count = 0;
+    log_writers_count = 0;
+  }
+
+};
+
+TEST(LOGGER_INTERNING, Logger_printfInterned_WritesTheDefinitionOnceThenTheParameters) {
+  int i;
+  logger_register_log_writer(log_writer_function_1, SEVERITY_INFO, true);
+
+  for(i = 0; i < 2; i ++) {
+    logger_printf("temp %d|%s", i, "ok");
+  }
+  logger_printf("wide %ld", 5L);
+  logger1.read(buffer);
+  STRCMP_EQUAL("\n1004|F000|temp %d!%s|\n\nF000|0|ok|\n\nF000|1|ok|\n\n1000|wide 5|\n", buffer);
+
+  size_t s_unused_bytes;
+  size_t n = logger_decode(text, BUFSIZE, buffer, strlen(buffer), &s_unused_bytes);
+  text[n] = 0;
+  STRCMP_EQUAL("[0xF000]temp 0!ok\n[0xF000]temp 1!ok\n[0x1000]wide 5\n", text);
+}
+
+TEST(LOGGER_INTERNING, LoggerDecoder_DecodeTwoLogs_KeepsTheDefinitionsOfEachLog) {
+  const char *log1 = "\n1004|F000|temp %d|\n\nF000|21|\n";
+  const char *log2 = "\n1004|F000|speed %d|\n\nF000|7|\n";
+  LoggerDecoder decoder1, decoder2;
+  size_t n, consumed;
+
+  logger_decoder_init(&decoder1);
+  logger_decoder_init(&decoder2);
+  n = logger_decoder_decode(&decoder1, buffer, BUFSIZE, log1, strlen("\n1004|F000|temp %d|\n"), &consumed);
+  const size_t consumed1 = consumed;
+  n += logger_decoder_decode(&decoder2, buffer + n, BUFSIZE - n, log2, strlen(log2), &consumed);
+  n += logger_decoder_decode(&decoder1, buffer + n, BUFSIZE - n, log1 + consumed1, strlen(log1) - consumed1, &consumed);
+  buffer[n] = 0;
+  STRCMP_EQUAL("[0xF000]speed 7\n[0xF000]temp 21\n", buffer);
+}
+
+TEST(LOGGER_INTERNING, LoggerDecodeTimed_DecodeInChunks_KeepsTheDefinitionsBetweenCalls) {
+  static LoggerFormats formats;
+  unsigned long long time = 0;
+  size_t n, s_unused_bytes;
+
+  logger_formats_init(&formats);
+  n = logger_decode_timed(buffer, BUFSIZE, "\n1004|F000|temp %d|\n", 20, &s_unused_bytes, &time, &formats);
+  n += logger_decode_timed(buffer + n, BUFSIZE - n, "\nF000|21|\n", 11, &s_unused_bytes, &time, &formats);
+  buffer[n] = 0;
+  STRCMP_EQUAL("[0xF000]temp 21\n", buffer);
+  STRCMP_EQUAL("temp %d", logger_formats_find(&formats, 0xF000));
+  CHECK(logger_get_format(0xF000) == NULL);
+}
+
+/*
+ * log interned entries to a flight recorder that wraps many times and return
+ * the number of entries that are decoded from what it keeps.
+ */
+static size_t log_to_wrapped_recorder(char *decoded, size_t d_len) {
+  static uint8_t recovered[1024];
+  char path[] = "/tmp/logger_definitions_XXXXXX";
+  LoggerRecorder recorder;
+  LoggerDecoder decoder;
+  size_t consumed, count = 0;
+  int i;
+
+  close(mkstemp(path));
+  CHECK_TRUE(logger_recorder_open(&recorder, path, sizeof(recovered)));
+  logger_recorder_set_active(&recorder);
+  log_writers_count = 0;
+  logger_register_log_writer(logger_recorder_write, SEVERITY_INFO, true);
+  for(i = 0; i < 200; i ++) {
+    logger_printf("n %d", i);
+  }
+  size_t n = logger_recorder_recover(recovered, sizeof(recovered), recorder.map, recorder.map_length);
+  logger_recorder_close(&recorder);
+  unlink(path);
+
+  logger_decoder_init(&decoder);
+  n = logger_decoder_decode(&decoder, decoded, d_len - 1, (const char *) recovered, n, &consumed);
+  decoded[n] = 0;
+  for(const char *pos = decoded; (pos = strstr(pos, "[0xF000]n ")) != NULL; pos ++) {
+    count ++;
+  }
+  return count;
+}
+
+TEST(LOGGER_INTERNING, Logger_DefinitionInterval_WrappedRecorderIsDecoded) {
+  static char decoded[4096];
+
+  CHECK_EQUAL(0, log_to_wrapped_recorder(decoded, sizeof(decoded))); // the definition was overwritten
+
+  memset(log_dynamic_formats, 0, sizeof(log_dynamic_formats));
+  logger_set_definition_interval(8);
+  const size_t count = log_to_wrapped_recorder(decoded, sizeof(decoded));
+  CHECK(count >= 16);
+  STRCMP_EQUAL("[0xF000]n 199\n", decoded + strlen(decoded) - strlen("[0xF000]n 199\n"));
+}
+
+#define INTERNING_THREADS 4
+#define INTERNING_FORMATS 8
+
+static char interning_formats[INTERNING_THREADS][INTERNING_FORMATS][16];
+static int interning_ids[INTERNING_THREADS][INTERNING_FORMATS];
+
+static void *intern_formats(void *context) {
+  const long t = (long) context;
+  int round, i;
+  for(round = 0; round < 100; round ++) {
+    for(i = 0; i < INTERNING_FORMATS; i ++) {
+      int id = logger_intern_format(interning_formats[t][i]);
+      if(id >= 0) {
+        interning_ids[t][i] = id;
+      }
+    }
+  }
+  return NULL;
+}
+
+TEST(LOGGER_INTERNING, Logger_InternFormatsFromThreads_GivesEveryFormatItsOwnId) {
+  pthread_t threads[INTERNING_THREADS];
+  bool used[LOGGER_MAX_DYNAMIC_IDS] = { false };
+  long t;
+  int i;
+
+  for(t = 0; t < INTERNING_THREADS; t ++) {
+    for(i = 0; i < INTERNING_FORMATS; i ++) {
+      snprintf(interning_formats[t][i], 16, "t%ld f%d %%u", t, i);
+      interning_ids[t][i] = -1;
+    }
+  }
+  for(t = 0; t < INTERNING_THREADS; t ++) {
+    pthread_create(&threads[t], NULL, intern_formats, (void *) t);
+  }
+  for(t = 0; t < INTERNING_THREADS; t ++) {
+    pthread_join(threads[t], NULL);
+  }
+  for(t = 0; t < INTERNING_THREADS; t ++) {
+    for(i = 0; i < INTERNING_FORMATS; i ++) {
+      const int id = interning_ids[t][i];
+      CHECK(id >= 0);
+      CHECK_FALSE(used[id]);
+      used[id] = true;
+      CHECK_EQUAL(interning_formats[t][i], log_dynamic_formats[id].format);
+    }
+  }
+}
+
+TEST(LOGGER_INTERNING, Logger_printfInternedDouble_KeepsItsPrecision) {
+  logger_register_log_writer(log_writer_function_1, SEVERITY_INFO, true);
+
+  logger_set_printf_interning(false);
+  logger_printf("v %.2f", 16777217.25);
+  logger_set_printf_interning(true);
+  logger_printf("v %.2f", 16777217.25);
+  logger1.read(buffer);
+  STRCMP_EQUAL("\n1000|v 16777217.25|\n\n1004|F000|v %.2f|\n\nF000|16777217.25|\n", buffer);
+}
+
+TEST(LOGGER_INTERNING, Logger_printfInternedWithTextWriter_OnlyEncodedWritersGetTheDefinitionAgainAfterEnabling) {
+  int i;
+  logger_register_log_writer(log_writer_function_1, SEVERITY_INFO, false);
+  logger_register_log_writer(log_writer_function_1, SEVERITY_INFO, true);
+
+  for(i = 0; i < 2; i ++) {
+    logger_printf("count %u", 7u);
+    logger_set_printf_interning(true);
+  }
+  logger1.read(buffer);
+  STRCMP_EQUAL("[0x1000]count 7\n\n1004|F000|count %u|\n\nF000|7|\n"
+               "[0x1000]count 7\n\n1004|F000|count %u|\n\nF000|7|\n", buffer);
+}
+
+
+static char test_page[512];
+static size_t test_page_position;
+static size_t test_page_size;
+
+static uint8_t* test_page_reserve(const size_t length) {
+  if(test_page_position + length > test_page_size) {
+    return NULL;
+  }
+  return (uint8_t *) test_page + test_page_position;
+}
+
+static void test_page_commit(const size_t length) {
+  test_page_position += length;
+  test_page[test_page_position] = 0;
+}
+
+TEST_GROUP(LOGGER_RESERVE) {
+  LogStats stats;
+
+  void setup() {
+    test_page_position = 0;
+    test_page_size = sizeof(test_page) - 1;
+    logger_reset_stats();
+  }
+
+  void teardown() {
+    logger_set_printf_interning(false);
+    memset(log_dynamic_formats, 0, sizeof(log_dynamic_formats));
+    logger_reset_stats();
+    log_entries_count = 0;
+    log_writers_count = 0;
+  }
+
+};
+
+TEST(LOGGER_RESERVE, Logger_printfWithReservingWriter_FormatsIntoTheMemoryOfTheWriter) {
+  CHECK_FALSE(logger_register_log_writer_reserve(test_page_reserve, NULL, SEVERITY_INFO, false));
+  CHECK_TRUE(logger_register_log_writer_reserve(test_page_reserve, test_page_commit, SEVERITY_INFO, false));
+  CHECK_TRUE(logger_register_log_writer_reserve(test_page_reserve, test_page_commit, SEVERITY_INFO, true));
+
+  logger_printf(" this is a test");
+  logger_printf("%200s", "long");
+  STRNCMP_EQUAL("[0x1000] this is a test\n\n1000| this is a test|\n", test_page, 47);
+  CHECK_EQUAL(47 + 2 * LOG_LINE_SIZE, test_page_position);
+  STRCMP_EQUAL(".. truncated ..|\n", test_page + test_page_position - 17);
+}
+
+TEST(LOGGER_RESERVE, Logger_printfWithFullWriter_DropsTheEntryAndDefinesTheFormatLater) {
+  logger_register_log_writer_reserve(test_page_reserve, test_page_commit, SEVERITY_INFO, true);
+  logger_set_printf_interning(true);
+  test_page_size = LOG_LINE_SIZE - 1;
+
+  logger_printf("temp %d", 1);
+  logger_get_stats(&stats);
+  CHECK_EQUAL(0, test_page_position);
+  CHECK_EQUAL(0, stats.writers[0].counters.entries);
+  CHECK_EQUAL(1, stats.writers[0].counters.dropped);
+
+  test_page_size = sizeof(test_page) - 1;
+  logger_printf("temp %d", 2);
+  STRCMP_EQUAL("\n1004|F000|temp %d|\n\nF000|2|\n", test_page);
+}
+
+TEST(LOGGER_RESERVE, Logger_printfWithFullWriterAndClock_KeepsTheTimeOfTheNextEntry) {
+  char text[BUFSIZE];
+  size_t s_unused_bytes;
+  logger_register_log_writer_reserve(test_page_reserve, test_page_commit, SEVERITY_INFO, true);
+  test_ticks = 100;
+  logger_set_clock(test_clock);
+
+  logger_printf("first");
+  test_page_size = test_page_position;
+  test_ticks = 150;
+  logger_printf("dropped");
+  test_page_size = sizeof(test_page) - 1;
+  test_ticks = 175;
+  logger_printf("second");
+  logger_set_clock(NULL);
+
+  size_t n = logger_decode(text, BUFSIZE, test_page, test_page_position, &s_unused_bytes);
+  text[n] = 0;
+  STRCMP_EQUAL("[0x1000][@100]first\n[0x1000][@175]second\n", text);
+}
+
+
+
+static uint32_t test_cycles;
+
+static uint32_t test_cycle_counter(void) {
+  test_cycles += 4;
+  return test_cycles;
+}
+
+TEST_GROUP(LOGGER_STATS) {
+  char buffer[BUFSIZE];
+  LogStats stats;
+
+  void setup() {
+    logger_reset_stats();
+    logger_initialize_all_log_entries();
+  }
+
+  void teardown() {
+    logger_set_cycle_counter(NULL);
+    logger_set_stats_interval(0);
+    logger_reset_stats();
+    log_entries_count = 0;
+    log_writers_count = 0;
+  }
+
+};
+
+TEST(LOGGER_STATS, Logger_printf_CountsEntriesAndFilteredEntries) {
+  logger_register_log_writer(log_writer_function_1, SEVERITY_INFO, false);
+  logger_register_log_writer(log_writer_function_1, SEVERITY_WARNING, true);
+
+  logger_printf(" this is a test");
+  logger1.read(buffer);
+  logger_get_stats(&stats);
+
+  CHECK_EQUAL(2, stats.writer_count);
+  CHECK_EQUAL(1, stats.writers[0].counters.entries);
+  CHECK_EQUAL(strlen("[0x1000] this is a test\n"), stats.writers[0].counters.bytes);
+  CHECK_EQUAL(0, stats.writers[1].counters.entries);
+  CHECK_EQUAL(1, stats.writers[1].counters.filtered);
+  CHECK_EQUAL(1, stats.id_count);
+  CHECK_EQUAL(LOGGER_PRINTF, stats.ids[0].id);
+  CHECK_EQUAL(1, stats.ids[0].counters.entries);
+  CHECK_EQUAL(1, stats.ids[0].counters.filtered);
+}
+
+TEST(LOGGER_STATS, Logger_LogWithErrors_CountsTruncationsFormattingErrorsAndUnknownIds) {
+  LogEntry entries[] = { { .id = 42, .format = "bad %k format" } };
+  logger_register_log_entries(entries, 1);
+  logger_register_log_writer(log_writer_function_1, SEVERITY_INFO, true);
+
+  logger_printf("%200s", "long");
+  logger_log(42);
+  logger_log(43);
+  logger1.read(buffer);
+  logger_get_stats(&stats);
+
+  CHECK_EQUAL(2, stats.writers[0].counters.entries);
+  CHECK_EQUAL(1, stats.writers[0].counters.truncations);
+  CHECK_EQUAL(1, stats.writers[0].counters.formatting_errors);
+  CHECK_EQUAL(1, stats.unknown_ids);
+}
+
+TEST(LOGGER_STATS, Logger_LogMoreIdsThanTheTable_RemembersTheUntrackedIds) {
+  const unsigned int count = LOGGER_STATS_MAX_IDS + 4;
+  unsigned int i, j;
+  logger_register_log_writer(log_writer_function_1, SEVERITY_FATAL, false); // nothing is formatted
+
+  for(j = 0; j < 2; j ++) {
+    for(i = 0; i < count; i ++) {
+      logger_severity_log(SEVERITY_DEBUG, all_log_entries[i].id);
+    }
+  }
+  logger_get_stats(&stats);
+
+  CHECK_EQUAL(LOGGER_STATS_MAX_IDS, stats.id_count);
+  CHECK_EQUAL(2 * (count - LOGGER_STATS_MAX_IDS), stats.untracked_entries);
+  CHECK_TRUE(LOGGER_ID_MASK_TEST(&log_stats_untracked_ids, all_log_entries[count - 1].id));
+  CHECK_FALSE(LOGGER_ID_MASK_TEST(&log_stats_untracked_ids, all_log_entries[0].id));
+
+  logger_reset_stats();
+  CHECK_FALSE(LOGGER_ID_MASK_TEST(&log_stats_untracked_ids, all_log_entries[count - 1].id));
+}
+
+TEST(LOGGER_STATS, Logger_LogWithCycleCounter_AddsCyclesToTheHistograms) {
+  logger_register_log_writer(log_writer_function_1, SEVERITY_INFO, false);
+  logger_set_cycle_counter(test_cycle_counter);
+
+  logger_printf(" this is a test");
+  logger1.read(buffer);
+  logger_get_stats(&stats);
+
+  CHECK_EQUAL(1, stats.writers[0].format_cycles[2]);
+  CHECK_EQUAL(1, stats.writers[0].writer_cycles[2]);
+}
+
+TEST(LOGGER_STATS, Logger_StatsInterval_LogsTheStatsPeriodically) {
+  logger_register_log_writer(log_writer_function_1, SEVERITY_INFO, false);
+  logger_set_stats_interval(2);
+
+  logger_printf("1");
+  logger1.read(buffer);
+  STRCMP_EQUAL("[0x1000]1\n", buffer);
+  logger_printf("2");
+  logger1.read(buffer);
+  STRCMP_EQUAL("[0x1000]2\n"
+      "[0x1001][X] Writer 0: 2 entries, 20 bytes, 0 truncated, 0 formatting errors, 0 filtered\n"
+      "[0x1002][X] Id 0x1000: 2 entries, 20 bytes, 0 truncated, 0 formatting errors, 0 filtered\n"
+      "[0x1003][X] Untracked entries: 0, unknown ids: 0\n", buffer);
+}
+
+TEST(LOGGER_STATS, Logger_StatsIntervalFromThreads_LogsEveryIntervalOnce) {
+  pthread_t threads[TIMESTAMP_THREADS];
+  LoggerRecord record;
+  unsigned long long time = 0;
+  size_t s_unused_bytes, entries = 0, untracked = 0;
+  long t;
+
+  logger_register_log_writer(timestamp_log_writer, SEVERITY_INFO, true);
+  logger_set_stats_interval(100);
+  timestamp_log_length = 0;
+
+  for(t = 0; t < TIMESTAMP_THREADS; t ++) {
+    pthread_create(&threads[t], NULL, log_timestamped_entries, (void *) t);
+  }
+  for(t = 0; t < TIMESTAMP_THREADS; t ++) {
+    pthread_join(threads[t], NULL);
+  }
+
+  const char *pos = timestamp_log;
+  size_t len = timestamp_log_length;
+  while(logger_decode_record(&record, pos, len, &s_unused_bytes, &time, NULL)) {
+    pos += len - s_unused_bytes;
+    len = s_unused_bytes;
+    entries += record.id == LOGGER_PRINTF;
+    untracked += record.id == LOGGER_STATS_UNTRACKED;
+  }
+  CHECK_EQUAL(0, len);
+  CHECK_EQUAL(TIMESTAMP_THREADS * TIMESTAMP_ENTRIES, entries);
+  CHECK(untracked > 0 && untracked <= TIMESTAMP_THREADS * TIMESTAMP_ENTRIES / 100);
+}
+
+
+
+TEST_GROUP(LOGGER_AGGREGATION) {
+  char buffer[BUFSIZE];
+
+  void setup() {
+    logger_initialize_all_log_entries();
+    logger_register_log_writer(log_writer_function_1, SEVERITY_INFO, false);
+  }
+
+  void teardown() {
+    log_aggregations_count = 0;
+    log_entries_count = 0;
+    log_writers_count = 0;
+  }
+
+};
+
+TEST(LOGGER_AGGREGATION, Logger_LogAggregatedId_WritesASummaryPerWindowAndTheSamples) {
+  int i;
+  CHECK_TRUE(logger_set_aggregation(NIQ_LOG_CFT_PID_OTSE, 4, 3));
+
+  for(i = 1; i <= 5; i ++) {
+    logger_log(NIQ_LOG_CFT_PID_OTSE, i * 1.0, 10.0 - i);
+  }
+  logger_flush_aggregations();
+  logger1.read(buffer);
+  STRCMP_EQUAL("[0x8019][C] PID: 1.00 C\t9.00 Ohm\n"
+      "[0x1005][X] Id 0x8019 parameter 0: 4 entries, min 1.000000, max 4.000000, mean 2.500000\n"
+      "[0x1005][X] Id 0x8019 parameter 1: 4 entries, min 6.000000, max 9.000000, mean 7.500000\n"
+      "[0x8019][C] PID: 4.00 C\t6.00 Ohm\n"
+      "[0x1005][X] Id 0x8019 parameter 0: 1 entries, min 5.000000, max 5.000000, mean 5.000000\n"
+      "[0x1005][X] Id 0x8019 parameter 1: 1 entries, min 5.000000, max 5.000000, mean 5.000000\n", buffer);
+
+  logger_flush_aggregations();
+  logger1.read(buffer);
+  STRCMP_EQUAL("", buffer);
+}
+
+TEST(LOGGER_AGGREGATION, Logger_LogAggregatedIntegers_WritesExactSummariesAndCountsTheEntries) {
+  LogEntry entries[] = { { .id = 0x0042, .format = "crc %X" } };
+  LogStats stats;
+  size_t i;
+
+  logger_reset_stats();
+  logger_register_log_entries(entries, 1);
+  log_writers_count = 0;
+  logger_register_log_writer(log_writer_function_1, SEVERITY_INFO, true);
+  CHECK_TRUE(logger_set_aggregation(0x0042, 2, 0));
+
+  logger_log(0x0042, 0xFFFFFFFFu);
+  logger_log(0x0042, 0x10000001u);
+  logger1.read(buffer);
+  STRCMP_EQUAL("\n1005|0042|0|2|268435457.000000|4294967295.000000|2281701376.000000|\n", buffer);
+
+  logger_get_stats(&stats);
+  for(i = 0; i < LOGGER_STATS_MAX_IDS && stats.ids[i].id != 0x0042; i ++);
+  CHECK(i < LOGGER_STATS_MAX_IDS);
+  CHECK_EQUAL(2, stats.ids[i].counters.aggregated);
+  CHECK_EQUAL(0, stats.ids[i].counters.entries);
+  logger_reset_stats();
+}
+
+#define AGGREGATION_THREADS 4
+#define AGGREGATION_ENTRIES 1000
+
+static char aggregation_log[AGGREGATION_THREADS * AGGREGATION_ENTRIES * 16];
+static size_t aggregation_log_length;
+static pthread_mutex_t aggregation_log_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void aggregation_log_writer(const uint8_t *data, const size_t length) {
+  pthread_mutex_lock(&aggregation_log_lock);
+  memcpy(aggregation_log + aggregation_log_length, data, length);
+  aggregation_log_length += length;
+  pthread_mutex_unlock(&aggregation_log_lock);
+}
+
+static void *log_aggregated_entries(void *context) {
+  int i;
+  for(i = 0; i < AGGREGATION_ENTRIES; i ++) {
+    logger_log(0x0042, (uint32_t) (i % 10));
+  }
+  return NULL;
+}
+
+TEST(LOGGER_AGGREGATION, Logger_LogAggregatedIdFromThreads_SummarizesEveryEntryOnce) {
+  LogEntry entries[] = { { .id = 0x0042, .format = "value %u" } };
+  pthread_t threads[AGGREGATION_THREADS];
+  LoggerRecord record;
+  unsigned long long time = 0;
+  size_t s_unused_bytes, count = 0, summaries = 0;
+  double sum = 0;
+  long t;
+
+  logger_register_log_entries(entries, 1);
+  log_writers_count = 0;
+  logger_register_log_writer(aggregation_log_writer, SEVERITY_INFO, true);
+  aggregation_log_length = 0;
+  CHECK_TRUE(logger_set_aggregation(0x0042, 7, 0));
+
+  for(t = 0; t < AGGREGATION_THREADS; t ++) {
+    pthread_create(&threads[t], NULL, log_aggregated_entries, (void *) t);
+  }
+  for(t = 0; t < AGGREGATION_THREADS; t ++) {
+    pthread_join(threads[t], NULL);
+  }
+  logger_flush_aggregations();
+
+  const char *pos = aggregation_log;
+  size_t len = aggregation_log_length;
+  while(logger_decode_record(&record, pos, len, &s_unused_bytes, &time, NULL)) {
+    pos += len - s_unused_bytes;
+    len = s_unused_bytes;
+    CHECK_EQUAL(LOGGER_AGGREGATE, record.id);
+    count += strtoul(record.fields[2].data, NULL, 10);
+    sum += strtod(record.fields[5].data, NULL) * strtoul(record.fields[2].data, NULL, 10);
+    summaries ++;
+  }
+  CHECK_EQUAL(0, len);
+  CHECK_EQUAL(AGGREGATION_THREADS * AGGREGATION_ENTRIES, count);
+  CHECK_EQUAL((AGGREGATION_THREADS * AGGREGATION_ENTRIES + 6) / 7, summaries);
+  DOUBLES_EQUAL(AGGREGATION_THREADS * AGGREGATION_ENTRIES * 4.5, sum, 1e-3);
+}
+
+TEST(LOGGER_AGGREGATION, Logger_SetAggregation_OnlyAcceptsRegisteredIdsWithNumericParameters) {
+  CHECK_FALSE(logger_set_aggregation(NIQ_LOG_DIE_OOM, 10, 0)); // no parameters
+  CHECK_FALSE(logger_set_aggregation(0x7777, 10, 0));
+  CHECK_FALSE(logger_set_aggregation(LOGGER_AGGREGATE, 10, 0));
+  CHECK_TRUE(logger_set_aggregation(NIQ_LOG_CFT_OFT_DEGREES, 10, 0));
+  CHECK_TRUE(logger_set_aggregation(NIQ_LOG_CFT_OFT_DEGREES, 20, 0));
+  CHECK_EQUAL(1, log_aggregations_count);
+
+  logger_log(NIQ_LOG_CFT_OFT_DEGREES, 21.5);
+  logger1.read(buffer);
+  STRCMP_EQUAL("", buffer);
+  CHECK_TRUE(logger_set_aggregation(NIQ_LOG_CFT_OFT_DEGREES, 0, 0));
+  CHECK_EQUAL(0, log_aggregations_count);
+  logger_log(NIQ_LOG_CFT_OFT_DEGREES, 22.5);
+  logger1.read(buffer);
+  STRCMP_EQUAL("[0x1005][X] Id 0x8018 parameter 0: 1 entries, min 21.500000, max 21.500000, mean 21.500000\n"
+      "[0x8018][C] OFT: 22.50 C\n", buffer);
+}
+
+
+TEST_GROUP(LOGGER_ID_MASK) {
+  char buffer[BUFSIZE];
+  LogIdMask mask;
+
+  void setup() {
+    memset(&mask, 0, sizeof(mask));
+    logger_initialize_all_log_entries();
+  }
+
+  void teardown() {
+    logger_enable_ids(0, 0xFFFF, true);
+    log_entries_count = 0;
+    log_writers_count = 0;
+  }
+
+};
+
+TEST(LOGGER_ID_MASK, Logger_IdMaskSetRange_SetsTheBitsOfTheRange) {
+  logger_id_mask_set_range(&mask, 30, 70, true);
+  CHECK_FALSE(LOGGER_ID_MASK_TEST(&mask, 29));
+  CHECK_TRUE(LOGGER_ID_MASK_TEST(&mask, 30));
+  CHECK_EQUAL(0xFFFFFFFF, mask.words[1]);
+  CHECK_TRUE(LOGGER_ID_MASK_TEST(&mask, 70));
+  CHECK_FALSE(LOGGER_ID_MASK_TEST(&mask, 71));
+
+  logger_id_mask_set_range(&mask, 0, 0xFFFF, true);
+  logger_id_mask_set_range(&mask, 31, 32, false);
+  CHECK_TRUE(LOGGER_ID_MASK_TEST(&mask, 30));
+  CHECK_FALSE(LOGGER_ID_MASK_TEST(&mask, 31));
+  CHECK_FALSE(LOGGER_ID_MASK_TEST(&mask, 32));
+  CHECK_TRUE(LOGGER_ID_MASK_TEST(&mask, 0xFFFF));
+}
+
+TEST(LOGGER_ID_MASK, Logger_DisabledIds_AreNotWritten) {
+  logger_register_log_writer(log_writer_function_1, SEVERITY_INFO, false);
+
+  logger_enable_ids(0x8000, 0x8FFF, false);
+  logger_log(NIQ_LOG_CFT_OFT_DEGREES, 21.5);
+  logger_printf("on");
+  logger_enable_ids(NIQ_LOG_CFT_OFT_DEGREES, NIQ_LOG_CFT_OFT_DEGREES, true);
+  logger_log(NIQ_LOG_CFT_OFT_DEGREES, 22.5);
+  logger_log(NIQ_LOG_CFT_PID_OTSE, 1.0, 2.0);
+  logger1.read(buffer);
+  STRCMP_EQUAL("[0x1000]on\n[0x8018][C] OFT: 22.50 C\n", buffer);
+}
+
+static unsigned int clock_reads;
+
+static uint32_t counting_clock(void) {
+  return ++ clock_reads;
+}
+
+TEST(LOGGER_ID_MASK, Logger_DisabledIds_DoNotReadTheClock) {
+  logger_register_log_writer(log_writer_function_1, SEVERITY_INFO, false);
+  logger_set_clock(counting_clock);
+  clock_reads = 0;
+
+  logger_enable_ids(NIQ_LOG_CFT_OFT_DEGREES, NIQ_LOG_CFT_OFT_DEGREES, false);
+  logger_log(NIQ_LOG_CFT_OFT_DEGREES, 21.5);
+  CHECK_EQUAL(0, clock_reads);
+  logger_log(NIQ_LOG_CFT_FTS_DEGREES, 21.5);
+  CHECK_EQUAL(1, clock_reads);
+  logger_set_clock(NULL);
+  logger1.read(buffer);
+}
+
+TEST(LOGGER_ID_MASK, Logger_WriterIdMask_WritesTheIdsWhateverTheirSeverity) {
+  logger_register_log_writer(log_writer_function_1, SEVERITY_WARNING, false);
+  logger_register_log_writer(log_writer_function_1, SEVERITY_ERROR, true);
+  logger_id_mask_set_range(&mask, NIQ_LOG_CFT_OFT_DEGREES, NIQ_LOG_CFT_OFT_DEGREES, true);
+  CHECK_TRUE(logger_set_writer_id_mask(0, &mask));
+  CHECK_FALSE(logger_set_writer_id_mask(2, &mask));
+
+  logger_severity_log(SEVERITY_DEBUG, NIQ_LOG_CFT_OFT_DEGREES, 21.5);
+  logger_severity_log(SEVERITY_DEBUG, NIQ_LOG_CFT_PID_OTSE, 1.0, 2.0);
+  logger1.read(buffer);
+  STRCMP_EQUAL("[0x8018][C] OFT: 21.50 C\n", buffer);
+}
+
 
 TEST_GROUP(LOGGER_DECODER) {
   char buffer[BUFSIZE];
@@ -376,6 +1171,85 @@ TEST(LOGGER_DECODER, LoggerDecoder_DecodeTextInsufficientBuffer_DecodesUpToBuffe
 
 
 
+TEST_GROUP(LOGGER_STREAM_DECODER) {
+  LoggerDecoder decoder;
+  char buffer[BUFSIZE];
+  char expected[BUFSIZE];
+
+  void setup() {
+    logger_decoder_init(&decoder);
+  }
+
+  void teardown() {
+    log_entries_count = 0;
+    log_writers_count = 0;
+  }
+
+  /*
+   * decode the text with chunks of s_chunk characters and a destination of
+   * d_chunk characters.
+   */
+  size_t decode_in_chunks(const char *text, size_t s_chunk, size_t d_chunk) {
+    size_t i, n = 0, consumed, len = strlen(text);
+    for(i = 0; i < len; i += s_chunk) {
+      const char *src = text + i;
+      size_t s_len = len - i < s_chunk ? len - i : s_chunk;
+      do {
+        n += logger_decoder_decode(&decoder, buffer + n, d_chunk, src, s_len, &consumed);
+        src += consumed;
+        s_len -= consumed;
+      } while(s_len > 0 || logger_decoder_pending(&decoder) > 0);
+    }
+    buffer[n] = 0;
+    return n;
+  }
+};
+
+TEST(LOGGER_STREAM_DECODER, LoggerDecoder_DecodeInChunks_WritesTheSameAsLoggerDecode) {
+  const char *text = "garbage|\n002A|registered|\n garbage again\n\n002a:64|an|\n\n002A:1A|the|\nnot complete";
+  LogEntry entries[] = { { .id = 42, .format = " This entry has %s id" } };
+  logger_register_log_entries(entries, 1);
+  size_t s_unused_bytes;
+  size_t len = logger_decode(expected, BUFSIZE, text, strlen(text), &s_unused_bytes);
+  expected[len] = 0;
+
+  const size_t chunks[][2] = { { 1, 1 }, { 3, 7 }, { 5, BUFSIZE / 2 }, { BUFSIZE, 2 } };
+  size_t i;
+  for(i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i ++) {
+    logger_decoder_init(&decoder);
+    size_t n = decode_in_chunks(text, chunks[i][0], chunks[i][1]);
+    CHECK_EQUAL(len, n);
+    STRCMP_EQUAL(expected, buffer);
+    CHECK_EQUAL(strlen("not complete"), decoder.entry_length);
+  }
+}
+
+TEST(LOGGER_STREAM_DECODER, LoggerDecoder_DecodeInSmallDestination_ReportsThePendingOutput) {
+  const char *text = "\n002A|an|\n";
+  size_t consumed;
+  size_t n = logger_decoder_decode(&decoder, buffer, 4, text, strlen(text), &consumed);
+  CHECK_EQUAL(4, n);
+  CHECK_EQUAL(strlen(text), consumed);
+  CHECK_EQUAL(strlen("[0x002A]an\n") - 4, logger_decoder_pending(&decoder));
+
+  n += logger_decoder_decode(&decoder, buffer + n, BUFSIZE, NULL, 0, &consumed);
+  buffer[n] = 0;
+  STRCMP_EQUAL("[0x002A]an\n", buffer);
+  CHECK_EQUAL(0, logger_decoder_pending(&decoder));
+}
+
+TEST(LOGGER_STREAM_DECODER, LoggerDecoder_DecodeTooLongEntry_WritesItTruncatedAsInvalid) {
+  static char text[2 * LOGGER_DECODER_ENTRY_SIZE];
+  memset(text, 'a', sizeof(text) - 1);
+  text[0] = '\n';
+  text[sizeof(text) - 2] = '\n';
+  size_t n = decode_in_chunks(text, 16, BUFSIZE);
+  CHECK_EQUAL(strlen("[0xFFFF][L] ") + LOGGER_DECODER_ENTRY_SIZE - 1, n);
+  BYTES_EQUAL('\n', buffer[n - 1]);
+}
+
+
+
 #define TEST_LOG_ENTRIES_1 \
   LOG_ENTRY(TEST_LOG_EMPTY_STRING_1,                  "") \
   LOG_ENTRY(TEST_LOG_SOME_ENTRY_IN_THE_MIDDLE_1,      "This is not a special entry") \
@@ -503,3 +1377,89 @@ TEST(LOGGER_HELPER_FUNCTIONS, memnmcpy_CopyWithNegativeMax_CopiesNothing) {
 
 
 
+
+
+
+TEST_GROUP(LOGGER_PRESET) {
+  char text[4096];
+
+  void setup() {
+  }
+
+  void teardown() {
+  }
+};
+
+TEST(LOGGER_PRESET, Logger_GetPresetText_HasTheEncodedHeadersThenTheFormats) {
+  size_t len = logger_get_preset_text(text, sizeof(text) - 1);
+  text[len] = 0;
+  CHECK(strstr(text, "\n8001|\n8002|||||\n") != NULL);
+  CHECK(strstr(text, "[T] Test with params: p1 =  ; p2 = ") != NULL);
+  CHECK(strstr(text, "\n0000|") == NULL);
+  CHECK(strstr(text, "\nFFFF|") == NULL);
+}
+
+TEST(LOGGER_PRESET, Logger_GetPresetTextInSmallBuffer_WritesWholeHeadersOnly) {
+  size_t len = logger_get_preset_text(text, 10);
+  CHECK_EQUAL(strlen("\n1000||"), len);
+}
+
+
+
+TEST_GROUP(LOGGER_RECORD_DECODER) {
+  LoggerRecord record;
+  size_t s_unused_bytes;
+  unsigned long long time;
+
+  void setup() {
+    time = 0;
+  }
+
+  void teardown() {
+    log_entries_count = 0;
+    log_writers_count = 0;
+  }
+};
+
+TEST(LOGGER_RECORD_DECODER, LoggerDecodeRecord_ValidEntry_PointsTheFieldsIntoTheSource) {
+  LogEntry entries[] = { { .id = 42, .format = "%s and %4.2f" } };
+  logger_register_log_entries(entries, 1);
+  const char *text = "\n002A:64|some text| 21.49|\n";
+
+  CHECK_TRUE(logger_decode_record(&record, text, strlen(text), &s_unused_bytes, &time, NULL));
+  CHECK_EQUAL(0, s_unused_bytes);
+  CHECK_EQUAL(42, record.id);
+  POINTERS_EQUAL(entries[0].format, record.format);
+  CHECK_TRUE(record.has_time);
+  CHECK_EQUAL(100, record.time);
+  CHECK_EQUAL(2, record.field_count);
+  POINTERS_EQUAL(text + 9, record.fields[0].data);
+  CHECK_EQUAL(strlen("some text"), record.fields[0].length);
+  BYTES_EQUAL('s', record.fields[0].specifier);
+  CHECK_EQUAL(strlen(" 21.49"), record.fields[1].length);
+  BYTES_EQUAL('f', record.fields[1].specifier);
+}
+
+TEST(LOGGER_RECORD_DECODER, LoggerDecodeRecord_InvalidEntry_ReturnsTheTextAndKeepsTheEndNewline) {
+  const char *text = "\n\ngarbage\n\n002A|x|\n";
+
+  CHECK_TRUE(logger_decode_record(&record, text, strlen(text), &s_unused_bytes, &time, NULL));
+  CHECK_EQUAL(LOGGER_ERROR_ID, record.id);
+  CHECK_EQUAL(1, record.field_count);
+  CHECK_EQUAL(strlen("garbage"), record.fields[0].length);
+  MEMCMP_EQUAL("garbage", record.fields[0].data, record.fields[0].length);
+  CHECK_EQUAL(strlen("\n\n002A|x|\n"), s_unused_bytes);
+
+  const char *next = text + strlen(text) - s_unused_bytes;
+  CHECK_TRUE(logger_decode_record(&record, next, s_unused_bytes, &s_unused_bytes, &time, NULL));
+  CHECK_EQUAL(42, record.id);
+  CHECK_FALSE(record.has_time);
+  POINTERS_EQUAL(NULL, record.format);
+  CHECK_EQUAL(0, s_unused_bytes);
+}
+
+TEST(LOGGER_RECORD_DECODER, LoggerDecodeRecord_IncompleteEntry_ReturnsFalse) {
+  const char *text = "\n002A|x";
+  CHECK_FALSE(logger_decode_record(&record, text, strlen(text), &s_unused_bytes, &time, NULL));
+  CHECK_EQUAL(strlen(text), s_unused_bytes);
+}
@@ -0,0 +1,110 @@
+extern "C"
+{
+#include "lzss_archive.c"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+}
+
+#define BUFSIZE (65536)
+#define PACKET (256)
+
+//CppUTest includes should be after your system includes
+#include "CppUTest/TestHarness.h"
+
+
+
+static uint8_t text[BUFSIZE];
+static uint8_t compressed[BUFSIZE];
+static uint8_t archive[LZSS_ARCHIVE_MAX_SIZE(BUFSIZE)];
+static uint8_t restored[BUFSIZE];
+
+/*
+ * a log with repeated entries, random parameters and non-ASCII text.
+ */
+static size_t generate_log(uint8_t *dst, size_t d_len) {
+  unsigned long seed = 7;
+  size_t len = 0;
+  while(len + 64 < d_len) {
+    seed = seed * 1103515245 + 12345;
+    unsigned long r = (seed >> 16) & 0x7fff;
+    if(r % 2 == 0) {
+      len += sprintf((char *) dst + len, "\n8017|%lu.%02lu|\n", 18 + r % 7, r % 100);
+    } else {
+      len += sprintf((char *) dst + len, "\n1000|value %lu \xe9\xff\xff|\n", r);
+    }
+  }
+  return len;
+}
+
+/*
+ * compress like lzss_command does, with a packet size of PACKET.
+ */
+static size_t compress_packets(uint8_t *dst, const uint8_t *src, size_t s_len) {
+  Dictionary dictionary;
+  size_t len = 0, s_unused_bytes;
+  size_t packet_len = PACKET;
+
+  lzss_dictionary_init(&dictionary);
+  while(s_len > 0) {
+    size_t n = lzss_compress(&dictionary, dst + len, 64, src, s_len, &s_unused_bytes, packet_len);
+    len += n;
+    packet_len -= n;
+    if(packet_len == 0) {
+      packet_len = PACKET;
+      lzss_dictionary_init(&dictionary);
+    }
+    src += s_len - s_unused_bytes;
+    s_len = s_unused_bytes;
+  }
+  return len;
+}
+
+TEST_GROUP(LZSS_ARCHIVE) {
+  size_t text_len;
+
+  void setup() {
+    text_len = generate_log(text, BUFSIZE / 2);
+  }
+
+  void teardown() {
+  }
+
+};
+
+TEST(LZSS_ARCHIVE, LzssArchive_PacketizedStream_IsRestoredExactlyAndSmaller) {
+  size_t len = compress_packets(compressed, text, text_len);
+  size_t archive_len = lzss_archive_encode(archive, sizeof(archive), compressed, len, PACKET);
+  CHECK(archive_len > 0);
+  CHECK(archive_len < len);
+
+  size_t packet_size, stream_size;
+  CHECK_TRUE(lzss_archive_read_header(archive, archive_len, &packet_size, &stream_size));
+  CHECK_EQUAL(PACKET, packet_size);
+  CHECK_EQUAL(len, stream_size);
+
+  size_t n = lzss_archive_decode(restored, sizeof(restored), archive, archive_len);
+  CHECK_EQUAL(len, n);
+  MEMCMP_EQUAL(compressed, restored, n);
+}
+
+TEST(LZSS_ARCHIVE, LzssArchive_ArbitraryBytes_AreRestoredExactly) {
+  const uint8_t odd[] = { 0x80, 0x1f, 0xff, 0xff, 0xc3, 0x3f, 0xff, 0x00, 0x90 };
+  size_t archive_len = lzss_archive_encode(archive, sizeof(archive), odd, sizeof(odd), 4);
+  CHECK_EQUAL(LZSS_ARCHIVE_HEADER_SIZE + LZSS_ARCHIVE_BLOCK_HEADER_SIZE + sizeof(odd), archive_len);
+  BYTES_EQUAL(BLOCK_RAW, archive[LZSS_ARCHIVE_HEADER_SIZE]);
+
+  size_t n = lzss_archive_decode(restored, sizeof(restored), archive, archive_len);
+  CHECK_EQUAL(sizeof(odd), n);
+  MEMCMP_EQUAL(odd, restored, n);
+}
+
+TEST(LZSS_ARCHIVE, LzssArchive_CorruptArchive_IsRejected) {
+  size_t len = compress_packets(compressed, text, text_len);
+  size_t archive_len = lzss_archive_encode(archive, sizeof(archive), compressed, len, PACKET);
+
+  CHECK_EQUAL(0, lzss_archive_decode(restored, len - 1, archive, archive_len));
+  CHECK_EQUAL(0, lzss_archive_decode(restored, sizeof(restored), archive, archive_len - 1));
+  archive[0] = 'X';
+  CHECK_EQUAL(0, lzss_archive_decode(restored, sizeof(restored), archive, archive_len));
+}
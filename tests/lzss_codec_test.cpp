@@ -0,0 +1,146 @@
+extern "C"
+{
+#include "lzss.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+}
+
+#include "lzss.hpp"
+
+#define BUFSIZE (65536)
+
+//CppUTest includes should be after your system includes
+#include "CppUTest/TestHarness.h"
+
+
+
+static uint8_t text[BUFSIZE];
+static uint8_t expected[BUFSIZE];
+static uint8_t compressed[BUFSIZE];
+static uint8_t decompressed[BUFSIZE];
+
+/*
+ * a log with repeated entries and random parameters.
+ */
+static size_t generate_log(uint8_t *dst, size_t d_len) {
+  unsigned long seed = 1;
+  size_t len = 0;
+  while(len + 64 < d_len) {
+    seed = seed * 1103515245 + 12345;
+    unsigned long r = (seed >> 16) & 0x7fff;
+    if(r % 3 == 0) {
+      len += sprintf((char *) dst + len, "\n8017|%lu.%02lu|\n", 18 + r % 7, r % 100);
+    } else if(r % 3 == 1) {
+      len += sprintf((char *) dst + len, "\n8009|%lu|%08lX|\n", r % 10, seed);
+    } else {
+      len += sprintf((char *) dst + len, "\n1000|debug value %lu and text \xe9|\n", r);
+    }
+  }
+  return len;
+}
+
+TEST_GROUP(LZSS_CODEC) {
+  size_t text_len;
+
+  void setup() {
+    text_len = generate_log(text, 16384);
+  }
+
+  void teardown() {
+  }
+
+};
+
+TEST(LZSS_CODEC, LzssCodec_LegacyCompress_IsBitIdenticalToLzssCompress) {
+  Dictionary dictionary;
+  size_t s_unused_bytes;
+  lzss_dictionary_init(&dictionary);
+  size_t expected_len = lzss_compress(&dictionary, expected, BUFSIZE, text, text_len, &s_unused_bytes, BUFSIZE);
+
+  lzss::LegacyCodec codec;
+  size_t len = codec.compress(compressed, BUFSIZE, text, text_len, &s_unused_bytes);
+  CHECK_EQUAL(0, s_unused_bytes);
+  CHECK_EQUAL(expected_len, len);
+  MEMCMP_EQUAL(expected, compressed, len);
+}
+
+TEST(LZSS_CODEC, LzssCodec_LegacyCompressInChunks_IsBitIdenticalToLzssCompress) {
+  Dictionary dictionary;
+  lzss::LegacyCodec codec;
+  size_t s_len = text_len, expected_len = 0, len = 0, s_unused_bytes;
+  const uint8_t *src = text;
+
+  lzss_dictionary_init(&dictionary);
+  while(s_len > 0) {
+    expected_len += lzss_compress(&dictionary, expected + expected_len, 5, src, s_len, &s_unused_bytes, BUFSIZE);
+    src += s_len - s_unused_bytes;
+    s_len = s_unused_bytes;
+  }
+  src = text;
+  s_len = text_len;
+  while(s_len > 0) {
+    len += codec.compress(compressed + len, 5, src, s_len, &s_unused_bytes);
+    src += s_len - s_unused_bytes;
+    s_len = s_unused_bytes;
+  }
+  CHECK_EQUAL(expected_len, len);
+  MEMCMP_EQUAL(expected, compressed, len);
+}
+
+TEST(LZSS_CODEC, LzssCodec_LegacyDecompress_DecompressesLzssCompressOutput) {
+  const uint8_t ffff[] = { 'a', 0xff, 0xff, 'b' };
+  lzss::LegacyCodec codec;
+  size_t s_unused_bytes;
+  size_t n = codec.decompress(decompressed, BUFSIZE, ffff, sizeof(ffff), &s_unused_bytes);
+  CHECK_EQUAL(2, n);
+  MEMCMP_EQUAL("ab", decompressed, n);
+
+  Dictionary dictionary;
+  lzss_dictionary_init(&dictionary);
+  size_t len = lzss_compress(&dictionary, compressed, BUFSIZE, text, text_len, &s_unused_bytes, BUFSIZE);
+  codec.reset();
+  n = codec.decompress(decompressed, BUFSIZE, compressed, len, &s_unused_bytes);
+  CHECK_EQUAL(text_len, n);
+  MEMCMP_EQUAL(text, decompressed, n);
+}
+
+TEST(LZSS_CODEC, LzssCodec_ArchiveDecompressInSmallChunks_ReturnsTheOriginalText) {
+  const size_t d_chunk = lzss::ArchiveCodec::MAX_MATCH; // the destination must fit a copy
+  lzss::ArchiveCodec compressor, decompressor;
+  size_t s_unused_bytes, n = 0, s_len = 0;
+  size_t len = compressor.compress(compressed, BUFSIZE, text, text_len, &s_unused_bytes);
+  const uint8_t *src = compressed;
+
+  while(len > 0) {
+    s_len = s_len + 2 < len ? s_len + 2 : len; // add two bytes to the unused bytes
+    n += decompressor.decompress(decompressed + n, d_chunk, src, s_len, &s_unused_bytes);
+    src += s_len - s_unused_bytes;
+    len -= s_len - s_unused_bytes;
+    s_len = s_unused_bytes;
+  }
+  CHECK_EQUAL(text_len, n);
+  MEMCMP_EQUAL(text, decompressed, n);
+}
+
+TEST(LZSS_CODEC, LzssCodec_Archive_HasTheTagAndCompressesBetterThanLegacy) {
+  text_len = generate_log(text, BUFSIZE);
+  lzss::LegacyCodec legacy;
+  size_t s_unused_bytes;
+  size_t legacy_len = legacy.compress(compressed, BUFSIZE, text, text_len, &s_unused_bytes);
+
+  std::vector<uint8_t> archive = lzss::compress_archive<lzss::ArchiveCodec>(text, text_len);
+  CHECK(archive.size() < legacy_len);
+  BYTES_EQUAL('L', archive[0]);
+  BYTES_EQUAL('Z', archive[1]);
+  BYTES_EQUAL(16, archive[2]);
+  BYTES_EQUAL(7, archive[3]);
+
+  std::vector<uint8_t> result;
+  CHECK_TRUE(lzss::decompress_archive<lzss::ArchiveCodec>(&archive[0], archive.size(), result));
+  CHECK_EQUAL(text_len, result.size());
+  MEMCMP_EQUAL(text, &result[0], text_len);
+
+  archive[2] = 11;
+  CHECK_FALSE(lzss::decompress_archive<lzss::ArchiveCodec>(&archive[0], archive.size(), result));
+}
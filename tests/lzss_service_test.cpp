@@ -0,0 +1,154 @@
+extern "C"
+{
+#include "lzss_service.c"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+}
+
+#define STREAMS (20)
+#define TEXT_SIZE (8192)
+#define PACKET (256)
+
+//CppUTest includes should be after your system includes
+#include "CppUTest/TestHarness.h"
+
+
+
+typedef struct {
+  uint8_t text[TEXT_SIZE];
+  size_t text_len;
+  uint8_t code[2 * TEXT_SIZE];
+  size_t code_len;
+  uint8_t output[TEXT_SIZE];
+  size_t output_len;
+} TestStream;
+
+static TestStream streams[STREAMS];
+
+static void test_sink(void *context, LzssServiceStreamId id, const uint8_t *data, size_t length) {
+  TestStream *stream = &((TestStream *) context)[id & 0xffffffffu];
+  if(stream->output_len + length <= sizeof(stream->output)) {
+    memcpy(stream->output + stream->output_len, data, length);
+  }
+  stream->output_len += length;
+}
+
+/*
+ * a different log for every stream, compressed in packets.
+ */
+static void generate_stream(TestStream *stream, unsigned long seed) {
+  size_t len = 0, s_unused_bytes;
+  while(len + 64 < sizeof(stream->text)) {
+    seed = seed * 1103515245 + 12345;
+    unsigned long r = (seed >> 16) & 0x7fff;
+    len += sprintf((char *) stream->text + len, "\n%lu|value %lu|\n", 1000 + r % 5, r);
+  }
+  stream->text_len = len;
+
+  const uint8_t *src = stream->text;
+  size_t s_len = len;
+  stream->code_len = 0;
+  while(s_len > 0) {
+    stream->code_len += lzss_compress_packet(NULL, stream->code + stream->code_len, PACKET, src, s_len, &s_unused_bytes, false, NULL);
+    src += s_len - s_unused_bytes;
+    s_len = s_unused_bytes;
+  }
+  stream->output_len = 0;
+}
+
+/*
+ * submit every stream in interleaved chunks of pseudo random sizes.
+ */
+static void submit_streams(LzssService *service, const LzssServiceStreamId *ids) {
+  size_t positions[STREAMS] = { 0 };
+  unsigned long seed = 3;
+  bool submitted = true;
+  while(submitted) {
+    submitted = false;
+    for(int i = 0; i < STREAMS; i ++) {
+      seed = seed * 1103515245 + 12345;
+      size_t len = 1 + (seed >> 16) % 100;
+      if(len > streams[i].code_len - positions[i]) {
+        len = streams[i].code_len - positions[i];
+      }
+      if(len > 0) {
+        CHECK_TRUE(lzss_service_submit(service, ids[i], streams[i].code + positions[i], len));
+        positions[i] += len;
+        submitted = true;
+      }
+    }
+  }
+}
+
+TEST_GROUP(LZSS_SERVICE) {
+  LzssService service;
+  LzssServiceStreamId ids[STREAMS];
+
+  void setup() {
+    for(int i = 0; i < STREAMS; i ++) {
+      generate_stream(&streams[i], i + 1);
+    }
+  }
+
+  void teardown() {
+  }
+
+  void check_streams() {
+    for(int i = 0; i < STREAMS; i ++) {
+      CHECK_EQUAL(streams[i].text_len, streams[i].output_len);
+      MEMCMP_EQUAL(streams[i].text, streams[i].output, streams[i].text_len);
+    }
+  }
+
+};
+
+TEST(LZSS_SERVICE, LzssService_InterleavedStreams_AreDecompressedInOrder) {
+  CHECK_TRUE(lzss_service_init(&service, STREAMS, 3, 64 * 1024, test_sink, streams));
+  for(int i = 0; i < STREAMS; i ++) {
+    CHECK_TRUE(lzss_service_open(&service, NULL, PACKET, &ids[i]));
+  }
+  LzssServiceStreamId extra;
+  CHECK_FALSE(lzss_service_open(&service, NULL, PACKET, &extra));
+
+  submit_streams(&service, ids);
+  lzss_service_drain(&service);
+  check_streams();
+  lzss_service_deinit(&service);
+}
+
+TEST(LZSS_SERVICE, LzssService_SmallQueue_BlocksSubmitUntilDecoded) {
+  CHECK_TRUE(lzss_service_init(&service, STREAMS, 2, 150, test_sink, streams));
+  for(int i = 0; i < STREAMS; i ++) {
+    CHECK_TRUE(lzss_service_open(&service, NULL, PACKET, &ids[i]));
+  }
+
+  submit_streams(&service, ids);
+  CHECK(service.queued_bytes <= 150);
+  for(int i = 0; i < STREAMS; i ++) {
+    CHECK_TRUE(lzss_service_close(&service, ids[i]));
+  }
+  lzss_service_deinit(&service); // decodes what is still queued
+  check_streams();
+}
+
+TEST(LZSS_SERVICE, LzssService_ClosedStream_IdIsRejectedAndSlotReused) {
+  LzssServiceStreamId id, reopened;
+  const uint8_t data[] = { 'a' };
+
+  CHECK_TRUE(lzss_service_init(&service, 1, 1, 1024, test_sink, streams));
+  CHECK_TRUE(lzss_service_open(&service, NULL, PACKET, &id));
+  CHECK_TRUE(lzss_service_submit(&service, id, data, sizeof(data)));
+  CHECK_TRUE(lzss_service_close(&service, id));
+  lzss_service_drain(&service);
+  CHECK_EQUAL(0, service.open_streams);
+
+  CHECK_TRUE(lzss_service_open(&service, NULL, PACKET, &reopened));
+  CHECK(reopened != id);
+  CHECK_EQUAL(id & 0xffffffffu, reopened & 0xffffffffu);
+  CHECK_FALSE(lzss_service_submit(&service, id, data, sizeof(data)));
+  CHECK_FALSE(lzss_service_close(&service, id));
+  CHECK_TRUE(lzss_service_submit(&service, reopened, data, sizeof(data)));
+  lzss_service_deinit(&service);
+  CHECK_EQUAL(2, streams[0].output_len);
+}
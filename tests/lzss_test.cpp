@@ -0,0 +1,598 @@
+extern "C"
+{
+#include "lzss.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "lzss.c"
+}
+
+#define BUFSIZE (4096)
+
+//CppUTest includes should be after your system includes
+#include "CppUTest/TestHarness.h"
+
+
+
+static const char *TEXT =
+  "\n8017|21.49|\n\n8009|1|327B23C6|\n\n1000|debug value 2 and text|\n"
+  "\n8017|21.52|\n\n8009|3|74B0DC51|\n\n1000|debug value 5 and text|\n"
+  "\n8019|21.50|1100.25|\n\n8017|21.49|\n\n8036|1.00|2.00|3.00|4.00|5.00|\n";
+
+
+
+TEST_GROUP(LZSS) {
+  Dictionary dictionary;
+  uint8_t compressed[BUFSIZE];
+  uint8_t decompressed[BUFSIZE];
+
+  void setup() {
+  }
+
+  void teardown() {
+  }
+
+  size_t compress(const char *text, size_t packet_len) {
+    size_t s_unused_bytes;
+    lzss_dictionary_init(&dictionary);
+    return lzss_compress(&dictionary, compressed, BUFSIZE, (const uint8_t *) text, strlen(text), &s_unused_bytes, packet_len);
+  }
+
+};
+
+TEST(LZSS, Lzss_CompressAndDecompress_ReturnsTheOriginalText) {
+  size_t s_unused_bytes;
+  size_t len = compress(TEXT, BUFSIZE);
+  CHECK(len < strlen(TEXT));
+
+  lzss_dictionary_init(&dictionary);
+  size_t n = lzss_decompress(&dictionary, decompressed, BUFSIZE, compressed, len, &s_unused_bytes, BUFSIZE);
+  CHECK_EQUAL(strlen(TEXT), n);
+  CHECK_EQUAL(0, s_unused_bytes);
+  MEMCMP_EQUAL(TEXT, decompressed, n);
+}
+
+TEST(LZSS, Lzss_CompressNonAsciiLiteral_WritesTwoBytes) {
+  size_t len = compress("\xe9", BUFSIZE);
+  CHECK_EQUAL(2, len);
+  BYTES_EQUAL(0xe9, compressed[0]);
+  BYTES_EQUAL(0x0f, compressed[1]);
+}
+
+TEST(LZSS, Lzss_DecompressPacket_DecompressesWithAFreshDictionary) {
+  size_t len = compress(TEXT, BUFSIZE);
+  size_t n = lzss_decompress_packet(NULL, decompressed, BUFSIZE, compressed, len);
+  CHECK_EQUAL(strlen(TEXT), n);
+  MEMCMP_EQUAL(TEXT, decompressed, n);
+}
+
+TEST(LZSS, Lzss_DecompressPacketWithFiller_IgnoresTheFiller) {
+  const uint8_t packet[] = { 'a', 'b', 0xff };
+  size_t n = lzss_decompress_packet(NULL, decompressed, BUFSIZE, packet, sizeof(packet));
+  CHECK_EQUAL(2, n);
+  MEMCMP_EQUAL("ab", decompressed, n);
+}
+
+
+
+TEST_GROUP(LZSS_STREAM) {
+  Dictionary dictionary;
+  LzssStream stream;
+  uint8_t compressed[BUFSIZE];
+  uint8_t decompressed[BUFSIZE];
+
+  void setup() {
+  }
+
+  void teardown() {
+  }
+
+  /*
+   * compress the text into packets of packet_size bytes.
+   */
+  size_t compress_packets(const char *text, size_t packet_size) {
+    size_t s_len = strlen(text), s_unused_bytes, len = 0;
+    lzss_dictionary_init(&dictionary);
+    while(s_len > 0) {
+      size_t packet_len = packet_size - len % packet_size;
+      len += lzss_compress(&dictionary, compressed + len, BUFSIZE - len, (const uint8_t *) text, s_len, &s_unused_bytes, packet_len);
+      text += s_len - s_unused_bytes;
+      s_len = s_unused_bytes;
+      if(len % packet_size == 0) {
+        lzss_dictionary_init(&dictionary);
+      }
+    }
+    return len;
+  }
+
+  /*
+   * decompress with chunks of s_chunk bytes and a destination of d_chunk bytes.
+   */
+  size_t decompress_in_chunks(size_t len, size_t s_chunk, size_t d_chunk) {
+    size_t i, n = 0, consumed;
+    for(i = 0; i < len; i += s_chunk) {
+      const uint8_t *src = compressed + i;
+      size_t s_len = len - i < s_chunk ? len - i : s_chunk;
+      do {
+        n += lzss_stream_decompress(&stream, decompressed + n, d_chunk, src, s_len, &consumed);
+        src += consumed;
+        s_len -= consumed;
+      } while(s_len > 0 || lzss_stream_pending(&stream) > 0);
+    }
+    return n;
+  }
+};
+
+TEST(LZSS_STREAM, Lzss_StreamDecompressOneByteAtATime_ReturnsTheOriginalText) {
+  size_t len = compress_packets(TEXT, BUFSIZE);
+  lzss_stream_init(&stream, NULL, 0);
+  size_t n = decompress_in_chunks(len, 1, 1);
+  CHECK_EQUAL(strlen(TEXT), n);
+  MEMCMP_EQUAL(TEXT, decompressed, n);
+}
+
+TEST(LZSS_STREAM, Lzss_StreamDecompressPackets_ResetsTheDictionaryAndIgnoresFillers) {
+  const size_t packet_size = 16;
+  size_t len = compress_packets(TEXT, packet_size);
+  lzss_stream_init(&stream, NULL, packet_size);
+  size_t n = decompress_in_chunks(len, 7, 5);
+  CHECK_EQUAL(strlen(TEXT), n);
+  MEMCMP_EQUAL(TEXT, decompressed, n);
+}
+
+TEST(LZSS_STREAM, Lzss_StreamDecompressFFFFSequence_SkipsIt) {
+  const uint8_t src[] = { 'a', 0xff, 0xff, 'b' };
+  size_t consumed;
+  lzss_stream_init(&stream, NULL, 0);
+  size_t n = lzss_stream_decompress(&stream, decompressed, BUFSIZE, src, 2, &consumed);
+  n += lzss_stream_decompress(&stream, decompressed + n, BUFSIZE, src + 2, 2, &consumed);
+  CHECK_EQUAL(2, n);
+  MEMCMP_EQUAL("ab", decompressed, n);
+}
+
+TEST(LZSS_STREAM, Lzss_StreamDecompressCopyInSmallDestination_KeepsTheRestOfTheCopy) {
+  size_t consumed;
+  size_t len = compress_packets("abcabcabcabc", BUFSIZE);
+  lzss_stream_init(&stream, NULL, 0);
+  size_t n = lzss_stream_decompress(&stream, decompressed, 4, compressed, len, &consumed);
+  CHECK_EQUAL(4, n);
+  CHECK_EQUAL(5, consumed); // three literals and a copy
+  CHECK_EQUAL(2, lzss_stream_pending(&stream));
+  n += lzss_stream_decompress(&stream, decompressed + n, BUFSIZE, compressed + consumed, len - consumed, &consumed);
+  CHECK_EQUAL(0, lzss_stream_pending(&stream));
+  CHECK_EQUAL(12, n);
+  MEMCMP_EQUAL("abcabcabcabc", decompressed, n);
+}
+
+
+TEST(LZSS_STREAM, Lzss_CompressPacketOfText_IsNotStored) {
+  size_t s_unused_bytes;
+  size_t len = lzss_compress_packet(NULL, compressed, 64, (const uint8_t *) TEXT, strlen(TEXT), &s_unused_bytes, false, NULL);
+  CHECK_EQUAL(64, len);
+  CHECK(strlen(TEXT) - s_unused_bytes > 64 - LZSS_STORED_HEADER_SIZE);
+  CHECK(compressed[0] != 0xff);
+}
+
+TEST(LZSS_STREAM, Lzss_CompressPacketOfBinaryData_WritesAStoredPacket) {
+  uint8_t data[100];
+  size_t i, s_unused_bytes;
+  for(i = 0; i < sizeof(data); i ++) {
+    data[i] = (uint8_t) (128 + i * 7);
+  }
+  size_t len = lzss_compress_packet(NULL, compressed, 64, data, sizeof(data), &s_unused_bytes, false, NULL);
+  CHECK_EQUAL(64, len);
+  CHECK_EQUAL(sizeof(data) - 58, s_unused_bytes);
+  BYTES_EQUAL(0xff, compressed[0]);
+  BYTES_EQUAL(0xff, compressed[1]);
+  BYTES_EQUAL('S', compressed[2]);
+  BYTES_EQUAL(LZSS_STORED_VERSION, compressed[3]);
+
+  size_t n = lzss_decompress_packet(NULL, decompressed, BUFSIZE, compressed, len);
+  CHECK_EQUAL(58, n);
+  MEMCMP_EQUAL(data, decompressed, n);
+}
+
+TEST(LZSS_STREAM, Lzss_StreamDecompressStoredPackets_CopiesThemThrough) {
+  const size_t packet_size = 32;
+  uint8_t text[300];
+  size_t i, s_unused_bytes, len = 0;
+  memcpy(text, TEXT, 150);
+  for(i = 150; i < sizeof(text); i ++) {
+    text[i] = (uint8_t) (128 + i * 13);
+  }
+
+  const uint8_t *src = text;
+  size_t s_len = sizeof(text);
+  while(s_len > 0) {
+    len += lzss_compress_packet(NULL, compressed + len, packet_size, src, s_len, &s_unused_bytes, false, NULL);
+    src += s_len - s_unused_bytes;
+    s_len = s_unused_bytes;
+  }
+  lzss_stream_init(&stream, NULL, packet_size);
+  size_t n = decompress_in_chunks(len, 3, 5);
+  CHECK_EQUAL(sizeof(text), n);
+  MEMCMP_EQUAL(text, decompressed, n);
+}
+
+TEST(LZSS_STREAM, Lzss_StreamRestoredFromCheckpointAfterEveryByte_ReturnsTheOriginalText) {
+  const size_t packet_size = 16;
+  uint8_t checkpoint[LZSS_CHECKPOINT_SIZE];
+  size_t i, n = 0, consumed;
+  size_t len = compress_packets(TEXT, packet_size);
+
+  lzss_stream_init(&stream, NULL, packet_size);
+  for(i = 0; i < len; i ++) {
+    n += lzss_stream_decompress(&stream, decompressed + n, 1, compressed + i, 1, &consumed);
+    CHECK_EQUAL(LZSS_CHECKPOINT_SIZE, lzss_stream_save(&stream, checkpoint, sizeof(checkpoint)));
+    memset(&stream, 0xaa, sizeof(stream));
+    CHECK_TRUE(lzss_stream_restore(&stream, NULL, checkpoint, sizeof(checkpoint)));
+    while(lzss_stream_pending(&stream) > 0) {
+      n += lzss_stream_decompress(&stream, decompressed + n, 1, NULL, 0, &consumed);
+    }
+  }
+  CHECK_EQUAL(strlen(TEXT), n);
+  MEMCMP_EQUAL(TEXT, decompressed, n);
+}
+
+TEST(LZSS_STREAM, Lzss_StreamRestoreWithOtherPresetOrDamagedCheckpoint_Fails) {
+  uint8_t checkpoint[LZSS_CHECKPOINT_SIZE];
+  LzssPreset preset;
+  lzss_preset_init(&preset, (const uint8_t *) TEXT, strlen(TEXT));
+
+  lzss_stream_init(&stream, NULL, 16);
+  lzss_stream_save(&stream, checkpoint, sizeof(checkpoint));
+  CHECK_FALSE(lzss_stream_restore(&stream, &preset, checkpoint, sizeof(checkpoint)));
+  CHECK_FALSE(lzss_stream_restore(&stream, NULL, checkpoint, sizeof(checkpoint) - 1));
+  checkpoint[LZSS_CHECKPOINT_HEADER_SIZE] ^= 1;
+  CHECK_FALSE(lzss_stream_restore(&stream, NULL, checkpoint, sizeof(checkpoint)));
+  CHECK_EQUAL(0, lzss_stream_save(&stream, checkpoint, sizeof(checkpoint) - 1));
+}
+
+TEST(LZSS_STREAM, Lzss_ConcatenateStreams_PadsTheLastPacketOfEveryStream) {
+  const size_t packet_size = 16;
+  uint8_t joined[BUFSIZE];
+  const char *a = "\n8017|21.49|\n\n8009|1|327B23C6|\n";
+  const char *b = "\n1000|debug value 2 and text|\n";
+  size_t a_len = compress_packets(a, packet_size);
+  memcpy(joined, compressed, a_len);
+  size_t b_len = compress_packets(b, packet_size);
+  CHECK(a_len % packet_size != 0);
+
+  LzssConstSegment streams[] = { { joined, a_len }, { compressed, b_len } };
+  size_t len = lzss_concatenate(joined, BUFSIZE, streams, 2, packet_size);
+  CHECK_EQUAL((a_len / packet_size + 1) * packet_size + b_len, len);
+  memcpy(compressed, joined, len);
+
+  lzss_stream_init(&stream, NULL, packet_size);
+  size_t n = decompress_in_chunks(len, 5, 7);
+  CHECK_EQUAL(strlen(a) + strlen(b), n);
+  MEMCMP_EQUAL(a, decompressed, strlen(a));
+  MEMCMP_EQUAL(b, decompressed + strlen(a), strlen(b));
+
+  LzssConstSegment slice;
+  CHECK_TRUE(lzss_slice_packets(compressed, len, packet_size, a_len / packet_size + 1, 100, &slice));
+  CHECK_EQUAL(b_len, slice.length);
+  CHECK_FALSE(lzss_slice_packets(compressed, len, packet_size, len / packet_size + 1, 1, &slice));
+  n = lzss_decompress_packet(NULL, decompressed, BUFSIZE, slice.data, packet_size);
+  MEMCMP_EQUAL(b, decompressed, n);
+}
+
+TEST(LZSS_STREAM, Lzss_CompressPacketsWithSyncMarkers_AreFoundAndDecompressed) {
+  const size_t packet_size = 32;
+  size_t s_unused_bytes, len = 0;
+  const uint8_t *src = (const uint8_t *) TEXT;
+  size_t s_len = strlen(TEXT);
+  while(s_len > 0) {
+    len += lzss_compress_packet(NULL, compressed + len, packet_size, src, s_len, &s_unused_bytes, true, NULL);
+    src += s_len - s_unused_bytes;
+    s_len = s_unused_bytes;
+  }
+  BYTES_EQUAL(0xff, compressed[3]);
+  CHECK(compressed[4] != 0xff);
+
+  lzss_stream_init(&stream, NULL, packet_size);
+  size_t n = decompress_in_chunks(len, 3, 5);
+  CHECK_EQUAL(strlen(TEXT), n);
+  MEMCMP_EQUAL(TEXT, decompressed, n);
+
+  CHECK_EQUAL(0, lzss_find_packet(compressed, len, packet_size));
+  CHECK_EQUAL(packet_size - 7, lzss_find_packet(compressed + 7, len - 7, packet_size));
+  compressed[2 * packet_size + 1] = 0; // a damaged marker
+  CHECK_EQUAL(3 * packet_size - 7, lzss_find_packet(compressed + 7, len - 7, packet_size));
+
+  size_t first_len = lzss_decompress_packet(NULL, decompressed, BUFSIZE, compressed, packet_size);
+  n = lzss_decompress_packet(NULL, decompressed, BUFSIZE, compressed + packet_size, packet_size);
+  CHECK(n > 0);
+  MEMCMP_EQUAL(TEXT + first_len, decompressed, n);
+}
+
+
+TEST_GROUP(LZSS_SEGMENTS) {
+  Dictionary dictionary;
+  uint8_t compressed[BUFSIZE];
+  uint8_t expected[BUFSIZE];
+  uint8_t decompressed[BUFSIZE];
+
+  void setup() {
+  }
+
+  void teardown() {
+  }
+
+  /*
+   * split the buffer into segments of the given lengths and a last segment
+   * with the rest.
+   */
+  size_t split(const uint8_t *data, size_t len, const size_t *lengths, size_t count, LzssConstSegment *segments) {
+    size_t i;
+    for(i = 0; i < count && len > 0; i ++) {
+      segments[i].data = data;
+      segments[i].length = lengths[i] < len ? lengths[i] : len;
+      data += segments[i].length;
+      len -= segments[i].length;
+    }
+    segments[i].data = data;
+    segments[i].length = len;
+    return i + 1;
+  }
+};
+
+TEST(LZSS_SEGMENTS, Lzss_CompressvWithScatteredSource_IsTheSameAsLzssCompress) {
+  const size_t lengths[] = { 1, 5, 0, 16, 17, 2, 40 };
+  LzssConstSegment src[8];
+  size_t s_unused_bytes;
+  size_t s_count = split((const uint8_t *) TEXT, strlen(TEXT), lengths, 7, src);
+
+  lzss_dictionary_init(&dictionary);
+  size_t expected_len = lzss_compress(&dictionary, expected, BUFSIZE, (const uint8_t *) TEXT, strlen(TEXT), &s_unused_bytes, BUFSIZE);
+
+  LzssSegment dst = { compressed, BUFSIZE };
+  lzss_dictionary_init(&dictionary);
+  size_t len = lzss_compressv(&dictionary, &dst, 1, src, s_count, &s_unused_bytes, BUFSIZE);
+  CHECK_EQUAL(0, s_unused_bytes);
+  CHECK_EQUAL(expected_len, len);
+  MEMCMP_EQUAL(expected, compressed, len);
+}
+
+TEST(LZSS_SEGMENTS, Lzss_CompressvWithScatteredDestination_FillsEverySegment) {
+  LzssConstSegment src = { (const uint8_t *) "\xe9\xe9" "abc\xe9" "abcabc\xe9", 14 };
+  LzssSegment dst[] = { { compressed, 1 }, { compressed + 1, 2 }, { compressed + 3, 1 }, { compressed + 4, BUFSIZE - 4 } };
+  size_t s_unused_bytes;
+
+  lzss_dictionary_init(&dictionary);
+  size_t len = lzss_compressv(&dictionary, dst, 4, &src, 1, &s_unused_bytes, BUFSIZE);
+  CHECK_EQUAL(0, s_unused_bytes);
+
+  lzss_dictionary_init(&dictionary);
+  size_t n = lzss_decompress(&dictionary, decompressed, BUFSIZE, compressed, len, &s_unused_bytes, BUFSIZE);
+  CHECK_EQUAL(14, n);
+  MEMCMP_EQUAL(src.data, decompressed, n);
+}
+
+TEST(LZSS_SEGMENTS, Lzss_DecompressvWithScatteredSourceAndDestination_ReturnsTheOriginalText) {
+  const size_t s_lengths[] = { 1, 1, 3, 2, 5 };
+  LzssConstSegment src[6];
+  LzssSegment dst[] = { { decompressed, 1 }, { decompressed + 1, 4 }, { decompressed + 5, 16 }, { decompressed + 21, BUFSIZE - 21 } };
+  size_t s_unused_bytes;
+
+  lzss_dictionary_init(&dictionary);
+  size_t len = lzss_compress(&dictionary, compressed, BUFSIZE, (const uint8_t *) TEXT, strlen(TEXT), &s_unused_bytes, BUFSIZE);
+  size_t s_count = split(compressed, len, s_lengths, 5, src);
+
+  lzss_dictionary_init(&dictionary);
+  size_t n = lzss_decompressv(&dictionary, dst, 4, src, s_count, &s_unused_bytes, BUFSIZE);
+  CHECK_EQUAL(0, s_unused_bytes);
+  CHECK_EQUAL(strlen(TEXT), n);
+  MEMCMP_EQUAL(TEXT, decompressed, n);
+}
+
+TEST(LZSS_SEGMENTS, Lzss_DecompressStoredPacket_StopsBeforeItsHeader) {
+  uint8_t data[40];
+  size_t i, s_unused_bytes;
+  for(i = 0; i < sizeof(data); i ++) {
+    data[i] = (uint8_t) (128 + i * 7);
+  }
+  lzss_dictionary_init(&dictionary);
+  size_t len = lzss_compress(&dictionary, compressed, BUFSIZE, (const uint8_t *) "abcabcabcabc", 12, &s_unused_bytes, BUFSIZE);
+  const size_t stored_len = lzss_compress_packet(NULL, compressed + len, 64, data, sizeof(data), &s_unused_bytes, false, NULL);
+  CHECK_EQUAL(LZSS_STORED_HEADER_SIZE + sizeof(data), stored_len);
+
+  lzss_dictionary_init(&dictionary);
+  size_t n = lzss_decompress(&dictionary, decompressed, BUFSIZE, compressed, len + stored_len, &s_unused_bytes, BUFSIZE);
+  CHECK_EQUAL(12, n);
+  CHECK_EQUAL(stored_len, s_unused_bytes);
+
+  // the header is split between the segments
+  for(i = 1; i <= 3; i ++) {
+    const size_t lengths[] = { len + i };
+    LzssConstSegment src[2];
+    LzssSegment dst[] = { { decompressed, BUFSIZE } };
+    size_t s_count = split(compressed, len + stored_len, lengths, 1, src);
+    lzss_dictionary_init(&dictionary);
+    n = lzss_decompressv(&dictionary, dst, 1, src, s_count, &s_unused_bytes, BUFSIZE);
+    CHECK_EQUAL(12, n);
+    CHECK_EQUAL(stored_len, s_unused_bytes);
+  }
+}
+
+
+TEST_GROUP(LZSS_PRESET) {
+  Dictionary dictionary;
+  LzssPreset preset;
+  uint8_t compressed[BUFSIZE];
+  uint8_t decompressed[BUFSIZE];
+
+  void setup() {
+    lzss_preset_init(&preset, (const uint8_t *) TEXT, strlen(TEXT));
+  }
+
+  void teardown() {
+  }
+
+  size_t compress(const LzssPreset *p, const char *text) {
+    size_t s_unused_bytes;
+    lzss_dictionary_init_preset(&dictionary, p);
+    return lzss_compress(&dictionary, compressed, BUFSIZE, (const uint8_t *) text, strlen(text), &s_unused_bytes, BUFSIZE);
+  }
+};
+
+TEST(LZSS_PRESET, Lzss_CompressWithPreset_IsSmallerAndDecompressesWithThePreset) {
+  const char *text = "\n8017|21.50|\n\n8009|2|327B23C6|\n";
+  size_t plain_len = compress(NULL, text);
+  size_t len = compress(&preset, text);
+  CHECK(len < plain_len / 2);
+
+  size_t n = lzss_decompress_packet(&preset, decompressed, BUFSIZE, compressed, len);
+  CHECK_EQUAL(strlen(text), n);
+  MEMCMP_EQUAL(text, decompressed, n);
+}
+
+TEST(LZSS_PRESET, Lzss_CompressRecords_CompressesEveryRecordLikeAFreshDictionary) {
+  const char *lines[] = { "\n8017|21.50|\n", "\n8009|2|327B23C6|\n", "", "\n1000|debug \xe9\xe9 value 7|\n" };
+  LzssConstSegment records[4];
+  size_t offsets[5], i;
+  Dictionary snapshot;
+  for(i = 0; i < 4; i ++) {
+    records[i].data = (const uint8_t *) lines[i];
+    records[i].length = strlen(lines[i]);
+  }
+  lzss_dictionary_init_preset(&snapshot, &preset);
+
+  CHECK_EQUAL(4, lzss_compress_records(&snapshot, decompressed, BUFSIZE, records, 4, offsets));
+  for(i = 0; i < 4; i ++) {
+    size_t len = compress(&preset, lines[i]);
+    CHECK_EQUAL(len, offsets[i + 1] - offsets[i]);
+    MEMCMP_EQUAL(compressed, decompressed + offsets[i], len);
+  }
+}
+
+TEST(LZSS_PRESET, Lzss_DecompressRecord_ReturnsOnlyThatRecord) {
+  const char *lines[] = { "\n8017|21.50|\n", "\n8009|2|327B23C6|\n8009|2|327B23C6|\n" };
+  LzssConstSegment records[2] = { { (const uint8_t *) lines[0], strlen(lines[0]) }, { (const uint8_t *) lines[1], strlen(lines[1]) } };
+  size_t offsets[3];
+  Dictionary snapshot;
+  lzss_dictionary_init_preset(&snapshot, &preset);
+
+  CHECK_EQUAL(2, lzss_compress_records(&snapshot, compressed, BUFSIZE, records, 2, offsets));
+  CHECK(offsets[2] - offsets[1] < strlen(lines[1]) / 2);
+  size_t n = lzss_decompress_record(&snapshot, decompressed, BUFSIZE, compressed + offsets[1], offsets[2] - offsets[1]);
+  CHECK_EQUAL(strlen(lines[1]), n);
+  MEMCMP_EQUAL(lines[1], decompressed, n);
+
+  CHECK_EQUAL(1, lzss_compress_records(&snapshot, compressed, offsets[2] - 1, records, 2, offsets));
+}
+
+TEST(LZSS_PRESET, Lzss_InitPresetWithLongData_KeepsTheLastBytes) {
+  static uint8_t data[DICTIONARY_SIZE + 10];
+  data[sizeof(data) - 1] = 'z';
+  lzss_preset_init(&preset, data, sizeof(data));
+  CHECK_EQUAL(DICTIONARY_SIZE, preset.length);
+  BYTES_EQUAL('z', preset.data[DICTIONARY_SIZE - 1]);
+}
+
+TEST(LZSS_PRESET, Lzss_WriteAndReadPreset_ReturnsTheSamePreset) {
+  static uint8_t buffer[LZSS_PRESET_MAX_SERIALIZED_SIZE];
+  static LzssPreset read;
+  size_t len = lzss_preset_write(&preset, buffer, sizeof(buffer));
+  CHECK_EQUAL(LZSS_PRESET_HEADER_SIZE + strlen(TEXT), len);
+  CHECK_TRUE(lzss_preset_read(&read, buffer, len));
+  CHECK_EQUAL(preset.id, read.id);
+  CHECK_EQUAL(preset.length, read.length);
+  MEMCMP_EQUAL(preset.data, read.data, preset.length);
+
+  buffer[LZSS_PRESET_HEADER_SIZE] ^= 1; // the id no longer matches
+  CHECK_FALSE(lzss_preset_read(&read, buffer, len));
+}
+
+TEST(LZSS_PRESET, Lzss_BuildPresetFromSamples_SelectsFrequentText) {
+  static uint8_t samples[16 * DICTIONARY_SIZE];
+  size_t i, len = 0;
+  for(i = 0; len + strlen(TEXT) < sizeof(samples); i ++) {
+    memcpy(samples + len, TEXT, strlen(TEXT));
+    len += strlen(TEXT);
+  }
+  CHECK_TRUE(lzss_preset_build(&preset, samples, len));
+  CHECK(preset.length > 0 && preset.length <= DICTIONARY_SIZE);
+
+  size_t c_len = compress(&preset, TEXT);
+  CHECK(c_len < strlen(TEXT) / 4);
+}
+
+
+
+TEST_GROUP(LZSS_STATS) {
+  Dictionary dictionary;
+  LzssStats stats;
+  uint8_t compressed[BUFSIZE];
+
+  void setup() {
+    memset(&stats, 0, sizeof(stats));
+    lzss_dictionary_init(&dictionary);
+  }
+
+};
+
+TEST(LZSS_STATS, LzssStats_Compress_CountsLiteralsAndCopies) {
+  size_t s_unused_bytes;
+  const char *text = "abcdefabcdef\xe9xy";
+
+  lzss_compress_with_stats(&dictionary, compressed, BUFSIZE, (const uint8_t *) text, strlen(text), &s_unused_bytes, BUFSIZE, &stats);
+
+  CHECK_EQUAL(9, stats.literals);
+  CHECK_EQUAL(1, stats.escaped_literals);
+  CHECK_EQUAL(1, stats.copies);
+  CHECK_EQUAL(1, stats.copies_by_length[6 - 3]);
+  CHECK_EQUAL(1, stats.copies_by_distance[3]); // the copy starts 5 bytes before the tail
+  CHECK_EQUAL(0, stats.packets);
+  CHECK(stats.searches > 0);
+}
+
+TEST(LZSS_STATS, LzssStats_CompressTwoBytesMatch_CountsARejectedMatch) {
+  size_t s_unused_bytes;
+  const char *text = "ab-ab";
+
+  lzss_compress_with_stats(&dictionary, compressed, BUFSIZE, (const uint8_t *) text, strlen(text), &s_unused_bytes, BUFSIZE, &stats);
+
+  CHECK_EQUAL(1, stats.rejected_matches);
+  CHECK_EQUAL(5, stats.literals);
+}
+
+TEST(LZSS_STATS, LzssStats_FillPacket_CountsTheFillerAndThePacket) {
+  size_t s_unused_bytes;
+  const char *text = "ab\xe9";
+
+  size_t len = lzss_compress_with_stats(&dictionary, compressed, BUFSIZE, (const uint8_t *) text, strlen(text), &s_unused_bytes, 3, &stats);
+
+  CHECK_EQUAL(3, len);
+  BYTES_EQUAL(0xff, compressed[2]);
+  CHECK_EQUAL(1, stats.fillers);
+  CHECK_EQUAL(1, stats.packets);
+}
+
+TEST(LZSS_STATS, LzssStats_CompressWithoutStats_CountsNothing) {
+  size_t s_unused_bytes;
+  const char *text = "abcdefabcdef";
+
+  lzss_compress(&dictionary, compressed, BUFSIZE, (const uint8_t *) text, strlen(text), &s_unused_bytes, BUFSIZE);
+
+  CHECK_EQUAL(0, stats.literals);
+  CHECK_EQUAL(0, stats.searches);
+}
+
+TEST(LZSS_STATS, LzssStats_StoredPacket_KeepsTheCountsOfThePreviousPackets) {
+  size_t s_unused_bytes;
+  uint8_t data[64];
+
+  lzss_compress_packet(NULL, compressed, 64, (const uint8_t *) "abcabcabcabc", 12, &s_unused_bytes, false, &stats);
+  const unsigned long literals = stats.literals;
+  for(size_t i = 0; i < sizeof(data); i++) {
+    data[i] = (uint8_t) (0x80 + i * 7);
+  }
+  lzss_compress_packet(NULL, compressed, 64, data, sizeof(data), &s_unused_bytes, false, &stats);
+
+  CHECK_EQUAL(3, literals);
+  CHECK_EQUAL(literals, stats.literals);
+  CHECK_EQUAL(1, stats.stored_packets);
+  CHECK_EQUAL(1, stats.packets); // the first packet is not filled
+}
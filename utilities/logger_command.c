@@ -0,0 +1,620 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "logger.h"
+#include "logger_columnar.h"
+#include "logger_formatdb.h"
+#include "logger_index.h"
+#include "logger_record.h"
+#include "logger_recorder.h"
+#include "lzss.h"
+
+// must be the same as the packet size used by lzss_command
+#define PACKET_SIZE (1024)
+#define TEXT_SIZE LZSS_MAX_DECOMPRESSED_SIZE(PACKET_SIZE)
+#define OUTPUT_SIZE (16 * TEXT_SIZE)
+#define MAX_RANGES (16)
+
+static const struct {
+  const char *name;
+  LogId id;
+} log_ids[] = {
+#define LOG_ENTRY(_id_, _value_, _format_) { #_id_, _value_ },
+#include "logger.defs"
+#undef LOG_ENTRY
+};
+
+static LzssPreset preset_buffer;
+static const LzssPreset *preset = NULL;
+static LoggerFormatDb format_db;
+static bool has_format_db = false;
+static uint8_t packets[2 * PACKET_SIZE];
+static char text[2 * TEXT_SIZE];
+static char output[OUTPUT_SIZE];
+
+static void usage(void) {
+  printf("Usage: logger [-p presetfile] [-d dbfile] index infile indexfile\n");
+  printf("       logger [-p presetfile] [-d dbfile] query infile indexfile id[-id] ...\n");
+  printf("       logger [-p presetfile] [-d dbfile] json|csv infile\n");
+  printf("       logger [-p presetfile] [-d dbfile] columnar infile archivefile\n");
+  printf("       logger restore archivefile outfile\n");
+  printf("       logger [-d dbfile] scan archivefile id parameter\n");
+  printf("       logger preset presetfile\n");
+  printf("       logger formatdb defsfile firmware dbfile\n");
+  printf("       logger [-d dbfile] recover recorderfile\n");
+  printf("\tinfile is a compressed log, ids are names or hexadecimal values\n");
+  printf("\tjson and csv write a record per entry\n");
+  printf("\tcolumnar writes a columnar archive of the log, restore writes the log back\n");
+  printf("\tscan writes the values of a parameter (from 0) of an id in an archive\n");
+  printf("\tpreset writes a compression preset built from the log entries\n");
+  printf("\tformatdb writes a format database of the ids of a logger.defs, -d decodes with it\n");
+  printf("\trecover decodes the entries that are left in a flight recorder file\n\n");
+}
+
+/*
+ * initialize the logger and decode with the format database if there is one.
+ */
+static void initialize_logger(void) {
+  logger_initialize();
+  if(has_format_db) {
+    logger_set_format_resolver(logger_formatdb_resolve, &format_db);
+  }
+}
+
+static bool read_preset(const char *path, LzssPreset *preset) {
+  uint8_t buffer[LZSS_PRESET_MAX_SERIALIZED_SIZE];
+  FILE *file;
+  size_t len;
+
+  if((file = fopen(path, "rb")) == NULL) {
+    return false;
+  }
+  len = fread(buffer, 1, sizeof(buffer), file);
+  fclose(file);
+  return lzss_preset_read(preset, buffer, len);
+}
+
+static int write_preset(const char *path) {
+  uint8_t buffer[LZSS_PRESET_MAX_SERIALIZED_SIZE];
+  char preset_text[DICTIONARY_SIZE];
+  FILE *file;
+
+  size_t len = logger_get_preset_text(preset_text, sizeof(preset_text));
+  lzss_preset_init(&preset_buffer, (const uint8_t *) preset_text, len);
+
+  if((file = fopen(path, "wb")) == NULL) {
+    printf("cannot open presetfile %s\n", path);
+    return 1;
+  }
+  fwrite(buffer, 1, lzss_preset_write(&preset_buffer, buffer, sizeof(buffer)), file);
+  fclose(file);
+  printf("preset: %lu bytes, id %08lX\n", (unsigned long) preset_buffer.length, (unsigned long) preset_buffer.id);
+  return 0;
+}
+
+/*
+ * read the whole file into a buffer that the caller frees.
+ * return NULL if there is not enough memory.
+ */
+static uint8_t *read_file(FILE *file, size_t *len) {
+  uint8_t *data = NULL;
+  size_t capacity = 0, bytes_read;
+
+  *len = 0;
+  do {
+    if(*len == capacity) {
+      capacity = capacity ? 2 * capacity : 65536;
+      uint8_t *p = (uint8_t *) realloc(data, capacity);
+      if(p == NULL) {
+        free(data);
+        return NULL;
+      }
+      data = p;
+    }
+    bytes_read = fread(data + *len, 1, capacity - *len, file);
+    *len += bytes_read;
+  } while(bytes_read > 0);
+  return data;
+}
+
+static int write_format_db(const char *defs_path, const char *firmware, const char *path) {
+  size_t defs_len, db_len, error_line;
+  FILE *file;
+
+  if((file = fopen(defs_path, "rb")) == NULL) {
+    printf("cannot open defsfile %s\n", defs_path);
+    return 1;
+  }
+  uint8_t *defs = read_file(file, &defs_len);
+  fclose(file);
+  if(defs == NULL) {
+    printf("out of memory\n");
+    return 1;
+  }
+  uint8_t *db = logger_formatdb_build((const char *) defs, defs_len, (uint32_t) strtoul(firmware, NULL, 0), &db_len, &error_line);
+  free(defs);
+  if(db == NULL) {
+    if(error_line > 0) {
+      printf("%s:%lu: invalid entry\n", defs_path, (unsigned long) error_line);
+    } else {
+      printf("out of memory\n");
+    }
+    return 1;
+  }
+
+  if((file = fopen(path, "wb")) == NULL) {
+    printf("cannot open dbfile %s\n", path);
+    free(db);
+    return 1;
+  }
+  fwrite(db, 1, db_len, file);
+  fclose(file);
+  LoggerFormatDb opened;
+  logger_formatdb_open(&opened, db, db_len);
+  printf("format database: %lu ids, %lu bytes\n", (unsigned long) opened.id_count, (unsigned long) db_len);
+  free(db);
+  return 0;
+}
+
+static bool parse_id(const char *s, LogId *id) {
+  size_t i;
+  char *end;
+
+  for(i = 0; i < sizeof(log_ids) / sizeof(log_ids[0]); i ++) {
+    if(!strcmp(s, log_ids[i].name)) {
+      *id = log_ids[i].id;
+      return true;
+    }
+  }
+  unsigned long value = strtoul(s, &end, 16);
+  if(end == s || *end != 0 || value > 0xFFFF) {
+    return false;
+  }
+  *id = (LogId) value;
+  return true;
+}
+
+static bool parse_range(const char *s, LoggerIdRange *range) {
+  char first[128];
+  const char *dash = strchr(s, '-');
+
+  if(dash == NULL) {
+    if(!parse_id(s, &range->first)) {
+      return false;
+    }
+    range->last = range->first;
+    return true;
+  }
+  if((size_t) (dash - s) >= sizeof(first)) {
+    return false;
+  }
+  memcpy(first, s, dash - s);
+  first[dash - s] = 0;
+  return parse_id(first, &range->first) && parse_id(dash + 1, &range->last) && range->first <= range->last;
+}
+
+static int build_index(FILE *s_file, FILE *i_file) {
+  uint8_t record[LOGGER_INDEX_PACKET_SIZE > LOGGER_INDEX_HEADER_SIZE ? LOGGER_INDEX_PACKET_SIZE : LOGGER_INDEX_HEADER_SIZE];
+  LoggerIndexBuilder builder;
+  LoggerIndexPacket packet[2]; // a header split between two packets is added to the first one
+  uint32_t packet_count = 0;
+  size_t bytes_read;
+
+  logger_index_builder_init(&builder);
+  logger_index_write_header(record, PACKET_SIZE, 0);
+  fwrite(record, 1, LOGGER_INDEX_HEADER_SIZE, i_file);
+
+  while((bytes_read = fread(packets, 1, PACKET_SIZE, s_file)) > 0) {
+    size_t len = lzss_decompress_packet(preset, (uint8_t *) text, TEXT_SIZE, packets, bytes_read);
+    LoggerIndexPacket *current = &packet[packet_count % 2];
+
+    logger_index_packet_init(current);
+    logger_index_builder_scan(&builder, current, text, len);
+    if(packet_count > 0) { // the previous packet is complete now
+      logger_index_write_packet(record, &packet[(packet_count - 1) % 2]);
+      fwrite(record, 1, LOGGER_INDEX_PACKET_SIZE, i_file);
+    }
+    packet_count ++;
+  }
+  if(packet_count > 0) {
+    logger_index_write_packet(record, &packet[(packet_count - 1) % 2]);
+    fwrite(record, 1, LOGGER_INDEX_PACKET_SIZE, i_file);
+  }
+
+  logger_index_write_header(record, PACKET_SIZE, packet_count);
+  fseek(i_file, 0, SEEK_SET);
+  fwrite(record, 1, LOGGER_INDEX_HEADER_SIZE, i_file);
+
+  printf("packets: %lu\n", (unsigned long) packet_count);
+  return 0;
+}
+
+static bool packet_may_contain(const LoggerIndexPacket *packet, const LoggerIdRange *ranges, size_t range_count) {
+  size_t i;
+  for(i = 0; i < range_count; i ++) {
+    if(logger_index_packet_may_contain(packet, ranges[i].first, ranges[i].last)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool ranges_contain_dynamic_ids(const LoggerIdRange *ranges, size_t range_count) {
+  size_t i;
+  for(i = 0; i < range_count; i ++) {
+    if(ranges[i].first < LOGGER_DYNAMIC_ID_FIRST + LOGGER_MAX_DYNAMIC_IDS && ranges[i].last >= LOGGER_DYNAMIC_ID_FIRST) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+ * decode the entries of the ranges from the packets whose summary may contain
+ * them. the packets with definitions of dynamic ids are decoded as well when
+ * dynamic ids are queried, only to learn their formats.
+ */
+static int query_index(FILE *s_file, FILE *i_file, const LoggerIdRange *ranges, size_t range_count) {
+  uint8_t record[LOGGER_INDEX_PACKET_SIZE > LOGGER_INDEX_HEADER_SIZE ? LOGGER_INDEX_PACKET_SIZE : LOGGER_INDEX_HEADER_SIZE];
+  static LoggerFormats formats;
+  LoggerIndexPacket packet;
+  size_t packet_size;
+  uint32_t packet_count, k, decoded = 0;
+
+  if(fread(record, 1, LOGGER_INDEX_HEADER_SIZE, i_file) != LOGGER_INDEX_HEADER_SIZE
+      || !logger_index_read_header(record, &packet_size, &packet_count)
+      || packet_size != PACKET_SIZE) {
+    printf("invalid index file\n");
+    return 1;
+  }
+
+  initialize_logger();
+  logger_formats_init(&formats);
+  const bool dynamic = ranges_contain_dynamic_ids(ranges, range_count);
+
+  for(k = 0; k < packet_count; k ++) {
+    if(fread(record, 1, LOGGER_INDEX_PACKET_SIZE, i_file) != LOGGER_INDEX_PACKET_SIZE) {
+      printf("truncated index file\n");
+      return 1;
+    }
+    logger_index_read_packet(&packet, record);
+    if(!packet_may_contain(&packet, ranges, range_count) && !(dynamic && packet.has_definitions)) {
+      continue;
+    }
+
+    // decompress the packet and the next one, where its last entry may end
+    fseek(s_file, (long) k * PACKET_SIZE, SEEK_SET);
+    size_t bytes_read = fread(packets, 1, 2 * PACKET_SIZE, s_file);
+    size_t s_len = bytes_read < PACKET_SIZE ? bytes_read : PACKET_SIZE;
+    size_t owned_len = lzss_decompress_packet(preset, (uint8_t *) text, TEXT_SIZE, packets, s_len);
+    size_t len = owned_len + lzss_decompress_packet(preset, (uint8_t *) text + owned_len, TEXT_SIZE, packets + s_len, bytes_read - s_len);
+    decoded ++;
+
+    const char *src = text;
+    unsigned long long time = packet.time;
+    while(owned_len > 0) { // repeat if the output fills up
+      size_t s_unused_bytes;
+      size_t n = logger_index_select(output, OUTPUT_SIZE, src, len, &s_unused_bytes, owned_len, ranges, range_count, &time, &formats);
+      size_t used = len - s_unused_bytes;
+      fwrite(output, 1, n, stdout);
+      if(used == 0) {
+        break;
+      }
+      src += used;
+      len -= used;
+      owned_len = used < owned_len ? owned_len - used : 0;
+    }
+  }
+
+  fprintf(stderr, "decoded %lu of %lu packets\n", (unsigned long) decoded, (unsigned long) packet_count);
+  return 0;
+}
+
+/*
+ * write the records of a compressed log to the standard output.
+ */
+static int export_records(FILE *s_file, bool json) {
+  static LzssStream stream;
+  static LoggerFormats formats;
+  LoggerRecord record;
+  unsigned long long time = 0;
+  size_t t_len = 0, bytes_read, consumed, s_unused_bytes;
+  unsigned long records = 0;
+
+  initialize_logger();
+  logger_formats_init(&formats);
+  lzss_stream_init(&stream, preset, PACKET_SIZE);
+
+  while((bytes_read = fread(packets, 1, PACKET_SIZE, s_file)) > 0) {
+    const uint8_t *src = packets;
+    do {
+      t_len += lzss_stream_decompress(&stream, (uint8_t *) text + t_len, sizeof(text) - t_len, src, bytes_read, &consumed);
+      src += consumed;
+      bytes_read -= consumed;
+
+      const char *pos = text;
+      while(logger_decode_record(&record, pos, text + t_len - pos, &s_unused_bytes, &time, &formats)) {
+        size_t n = json ? logger_record_write_json(&record, output, OUTPUT_SIZE) : logger_record_write_csv(&record, output, OUTPUT_SIZE);
+        fwrite(output, 1, n, stdout);
+        pos = text + t_len - s_unused_bytes;
+        records ++;
+      }
+      if(pos == text && t_len == sizeof(text)) { // drop an entry that does not fit
+        pos = text + t_len;
+      }
+      t_len -= pos - text;
+      memmove(text, pos, t_len);
+    } while(bytes_read > 0 || lzss_stream_pending(&stream) > 0);
+  }
+
+  fprintf(stderr, "%lu records\n", records);
+  return 0;
+}
+
+/*
+ * write a columnar archive of a compressed log.
+ */
+static int write_columnar(FILE *s_file, FILE *a_file) {
+  size_t bytes_read, t_len = 0, archive_len;
+  char *log = NULL;
+
+  while((bytes_read = fread(packets, 1, PACKET_SIZE, s_file)) > 0) {
+    char *p = (char *) realloc(log, t_len + TEXT_SIZE);
+    if(p == NULL) {
+      printf("out of memory\n");
+      free(log);
+      return 1;
+    }
+    log = p;
+    t_len += lzss_decompress_packet(preset, (uint8_t *) log + t_len, TEXT_SIZE, packets, bytes_read);
+  }
+
+  initialize_logger();
+  uint8_t *archive = logger_columnar_encode(log ? log : "", t_len, &archive_len);
+  free(log);
+  if(archive == NULL) {
+    printf("out of memory\n");
+    return 1;
+  }
+  fwrite(archive, 1, archive_len, a_file);
+  free(archive);
+  printf("log:     %lu bytes\n", (unsigned long) t_len);
+  printf("archive: %lu bytes\n", (unsigned long) archive_len);
+  return 0;
+}
+
+/*
+ * write the log of a columnar archive.
+ */
+static int restore_columnar(FILE *a_file, FILE *d_file) {
+  size_t archive_len, t_len;
+
+  uint8_t *archive = read_file(a_file, &archive_len);
+  if(archive == NULL) {
+    printf("out of memory\n");
+    return 1;
+  }
+  if(!logger_columnar_read_header(archive, archive_len, &t_len)) {
+    printf("invalid archive\n");
+    free(archive);
+    return 1;
+  }
+  char *log = (char *) malloc(t_len ? t_len : 1);
+  if(log == NULL || (logger_columnar_decode(log, t_len, archive, archive_len) != t_len)) {
+    printf(log == NULL ? "out of memory\n" : "invalid archive\n");
+    free(log);
+    free(archive);
+    return 1;
+  }
+  fwrite(log, 1, t_len, d_file);
+  free(log);
+  free(archive);
+  return 0;
+}
+
+/*
+ * write the values of one parameter of an id, reading only its column.
+ */
+static int scan_columnar(FILE *a_file, LogId id, size_t field) {
+  LoggerColumnarCursor cursor;
+  LoggerColumnarValue value;
+  unsigned long count = 0;
+  size_t archive_len;
+
+  uint8_t *archive = read_file(a_file, &archive_len);
+  if(archive == NULL) {
+    printf("out of memory\n");
+    return 1;
+  }
+  if(!logger_columnar_cursor_init(&cursor, archive, archive_len, id, field)) {
+    printf("no parameter %lu of id 0x%04X\n", (unsigned long) field, (unsigned int) id);
+    free(archive);
+    return 1;
+  }
+  while(logger_columnar_cursor_next(&cursor, &value)) {
+    if(!value.is_number) {
+      printf("%.*s\n", (int) value.length, value.string);
+    } else if(value.decimals > 0) {
+      double scale = 1;
+      unsigned int i;
+      for(i = 0; i < value.decimals; i ++) {
+        scale *= 10;
+      }
+      printf("%.*f\n", (int) value.decimals, value.number / scale);
+    } else {
+      printf("%lld\n", value.number);
+    }
+    count ++;
+  }
+  fprintf(stderr, "%lu values\n", count);
+  free(archive);
+  return 0;
+}
+
+/*
+ * decode the valid entries of a flight recorder file from the oldest one.
+ */
+static int recover_entries(FILE *r_file) {
+  LoggerDecoder decoder;
+  size_t len, n, consumed;
+
+  uint8_t *file = read_file(r_file, &len);
+  uint8_t *recovered = (uint8_t *) malloc(len > 0 ? len : 1);
+  if(file == NULL || recovered == NULL) {
+    printf("out of memory\n");
+    free(file);
+    free(recovered);
+    return 1;
+  }
+  LoggerRecorderReader reader;
+  if(!logger_recorder_reader_init(&reader, file, len)) {
+    printf("invalid recorder file\n");
+    free(file);
+    free(recovered);
+    return 1;
+  }
+  const size_t r_len = logger_recorder_recover(recovered, len, file, len);
+  free(file);
+
+  initialize_logger();
+  logger_decoder_init(&decoder);
+  const char *src = (const char *) recovered;
+  size_t s_len = r_len;
+  do {
+    n = logger_decoder_decode(&decoder, output, OUTPUT_SIZE, src, s_len, &consumed);
+    fwrite(output, 1, n, stdout);
+    src += consumed;
+    s_len -= consumed;
+  } while(n > 0 || s_len > 0);
+  fprintf(stderr, "%lu bytes recovered\n", (unsigned long) r_len);
+  free(recovered);
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  LoggerIdRange ranges[MAX_RANGES];
+  size_t range_count = 0;
+  FILE *s_file, *i_file;
+  int result;
+  int i;
+
+  if(argc == 3 && !strcmp(argv[1], "preset")) {
+    return write_preset(argv[2]);
+  }
+
+  if(argc == 5 && !strcmp(argv[1], "formatdb")) {
+    return write_format_db(argv[2], argv[3], argv[4]);
+  }
+
+  if(argc > 2 && !strcmp(argv[1], "-p")) {
+    if(!read_preset(argv[2], &preset_buffer)) {
+      printf("invalid preset %s\n", argv[2]);
+      return 1;
+    }
+    preset = &preset_buffer;
+    argc -= 2;
+    argv += 2;
+  }
+
+  if(argc > 2 && !strcmp(argv[1], "-d")) {
+    if(!logger_formatdb_map(&format_db, argv[2])) {
+      printf("invalid format database %s\n", argv[2]);
+      return 1;
+    }
+    has_format_db = true;
+    argc -= 2;
+    argv += 2;
+  }
+
+  if(argc == 4 && (!strcmp(argv[1], "columnar") || !strcmp(argv[1], "restore"))) {
+    const bool columnar = !strcmp(argv[1], "columnar");
+    if((s_file = fopen(argv[2], "rb")) == NULL) {
+      printf("cannot open infile %s\n", argv[2]);
+      return 1;
+    }
+    if((i_file = fopen(argv[3], "wb")) == NULL) {
+      printf("cannot open outfile %s\n", argv[3]);
+      fclose(s_file);
+      return 1;
+    }
+    result = columnar ? write_columnar(s_file, i_file) : restore_columnar(s_file, i_file);
+    fclose(i_file);
+    fclose(s_file);
+    return result;
+  }
+
+  if(argc == 3 && !strcmp(argv[1], "recover")) {
+    if((s_file = fopen(argv[2], "rb")) == NULL) {
+      printf("cannot open recorderfile %s\n", argv[2]);
+      return 1;
+    }
+    result = recover_entries(s_file);
+    fclose(s_file);
+    return result;
+  }
+
+  if(argc == 5 && !strcmp(argv[1], "scan")) {
+    LogId id;
+    initialize_logger();
+    if(!parse_id(argv[3], &id)) {
+      printf("invalid id %s\n", argv[3]);
+      return 1;
+    }
+    if((s_file = fopen(argv[2], "rb")) == NULL) {
+      printf("cannot open archivefile %s\n", argv[2]);
+      return 1;
+    }
+    result = scan_columnar(s_file, id, strtoul(argv[4], NULL, 10));
+    fclose(s_file);
+    return result;
+  }
+
+  const int exporting = argc == 3 && (!strcmp(argv[1], "json") || !strcmp(argv[1], "csv"));
+  if(exporting) {
+    if((s_file = fopen(argv[2], "rb")) == NULL) {
+      printf("cannot open infile %s\n", argv[2]);
+      return 1;
+    }
+    result = export_records(s_file, !strcmp(argv[1], "json"));
+    fclose(s_file);
+    return result;
+  }
+
+  const int indexing = argc == 4 && !strcmp(argv[1], "index");
+  const int querying = argc >= 5 && !strcmp(argv[1], "query");
+
+  if(!indexing && !querying) {
+    usage();
+    return 1;
+  }
+
+  for(i = 4; querying && i < argc; i ++) {
+    if(range_count == MAX_RANGES || !parse_range(argv[i], &ranges[range_count])) {
+      printf("invalid id or range %s\n", argv[i]);
+      return 1;
+    }
+    range_count ++;
+  }
+
+  if((s_file = fopen(argv[2], "rb")) == NULL) {
+    printf("cannot open infile %s\n", argv[2]);
+    return 1;
+  }
+  if((i_file = fopen(argv[3], indexing ? "wb" : "rb")) == NULL) {
+    printf("cannot open indexfile %s\n", argv[3]);
+    fclose(s_file);
+    return 1;
+  }
+
+  if(indexing) {
+    result = build_index(s_file, i_file);
+  } else {
+    result = query_index(s_file, i_file, ranges, range_count);
+  }
+
+  fclose(i_file);
+  fclose(s_file);
+  return result;
+}
@@ -5,6 +5,7 @@
 #include <sys/time.h>
 
 #include "lzss.h"
+#include "lzss_archive.h"
 
 struct Dictionary;
 
@@ -13,17 +14,369 @@ struct Dictionary;
 // set it to zero to disable this behavior.
 #define PACKET_SIZE (8*BUFFER_SIZE)
 
+static void print_stats(const LzssStats *stats) {
+  int i;
+  printf("literals:         %lu (%lu escaped)\n", stats->literals, stats->escaped_literals);
+  printf("copies:           %lu\n", stats->copies);
+  printf("rejected matches: %lu\n", stats->rejected_matches);
+  printf("fillers:          %lu\n", stats->fillers);
+  printf("packets:          %lu (%lu stored)\n", stats->packets, stats->stored_packets);
+  printf("probes:           %lu in %lu searches (%.1f per search)\n", stats->probes, stats->searches,
+      stats->searches ? (double) stats->probes / stats->searches : 0.0);
+  printf("copies by length:\n");
+  for(i = 0; i < LZSS_STATS_LENGTH_BUCKETS; i ++) {
+    printf("  %2d: %lu\n", i + 3, stats->copies_by_length[i]);
+  }
+  printf("copies by distance:\n");
+  for(i = 0; i < LZSS_STATS_DISTANCE_BUCKETS; i ++) {
+    printf("  < %4d: %lu\n", 1 << i, stats->copies_by_distance[i]);
+  }
+}
+
+static bool read_preset(const char *path, LzssPreset *preset) {
+  uint8_t buffer[LZSS_PRESET_MAX_SERIALIZED_SIZE];
+  FILE *file;
+  size_t len;
+
+  if((file = fopen(path, "rb")) == NULL) {
+    return false;
+  }
+  len = fread(buffer, 1, sizeof(buffer), file);
+  fclose(file);
+  return lzss_preset_read(preset, buffer, len);
+}
+
+/*
+ * read the whole file into a buffer that the caller frees.
+ * return NULL if there is not enough memory.
+ */
+static uint8_t *read_file(FILE *file, size_t *len) {
+  uint8_t *data = NULL;
+  size_t capacity = 0, bytes_read;
+
+  *len = 0;
+  do {
+    if(*len == capacity) {
+      capacity = capacity ? 2 * capacity : 65536;
+      uint8_t *p = (uint8_t *) realloc(data, capacity);
+      if(p == NULL) {
+        free(data);
+        return NULL;
+      }
+      data = p;
+    }
+    bytes_read = fread(data + *len, 1, capacity - *len, file);
+    *len += bytes_read;
+  } while(bytes_read > 0);
+  return data;
+}
+
+/*
+ * build a preset from a file of sample logs.
+ */
+static int build_preset(FILE *s_file, FILE *d_file) {
+  uint8_t buffer[LZSS_PRESET_MAX_SERIALIZED_SIZE];
+  static LzssPreset preset;
+  size_t s_len;
+
+  uint8_t *samples = read_file(s_file, &s_len);
+  if(samples == NULL) {
+    printf("out of memory\n");
+    return 1;
+  }
+  bool built = lzss_preset_build(&preset, samples, s_len);
+  free(samples);
+  if(!built) {
+    printf("out of memory\n");
+    return 1;
+  }
+  fwrite(buffer, 1, lzss_preset_write(&preset, buffer, sizeof(buffer)), d_file);
+  printf("preset: %lu bytes, id %08lX\n", (unsigned long) preset.length, (unsigned long) preset.id);
+  return 0;
+}
+
+/*
+ * transcode a compressed file into an archive or an archive back into the
+ * compressed file.
+ */
+static int transcode_archive(FILE *s_file, FILE *d_file, bool archiving) {
+  size_t s_len, d_len = 0, packet_size, len;
+  struct timeval t1, t2;
+
+  uint8_t *src = read_file(s_file, &s_len);
+  if(src == NULL) {
+    printf("out of memory\n");
+    return 1;
+  }
+  if(archiving) {
+    d_len = LZSS_ARCHIVE_MAX_SIZE(s_len);
+  } else if(!lzss_archive_read_header(src, s_len, &packet_size, &d_len)) {
+    printf("invalid archive\n");
+    free(src);
+    return 1;
+  }
+  uint8_t *dst = (uint8_t *) malloc(d_len ? d_len : 1);
+  if(dst == NULL) {
+    printf("out of memory\n");
+    free(src);
+    return 1;
+  }
+
+  gettimeofday(&t1, NULL);
+  if(archiving) {
+    len = lzss_archive_encode(dst, d_len, src, s_len, PACKET_SIZE);
+  } else {
+    len = lzss_archive_decode(dst, d_len, src, s_len);
+  }
+  gettimeofday(&t2, NULL);
+
+  int result = 0;
+  if(len == 0 && (archiving || d_len > 0)) {
+    printf(archiving ? "out of memory\n" : "invalid archive\n");
+    result = 1;
+  } else {
+    fwrite(dst, 1, len, d_file);
+    fprintf(stderr, "Finished in about %.0f milliseconds. \n", (t2.tv_sec - t1.tv_sec) * 1000.0 + (t2.tv_usec - t1.tv_usec) / 1000.0);
+    printf("in:   %lu bytes\n", (unsigned long) s_len);
+    printf("out:  %lu bytes\n", (unsigned long) len);
+  }
+  free(dst);
+  free(src);
+  return result;
+}
+
+/*
+ * concatenate compressed files packet by packet without decompressing them.
+ */
+static int join_streams(FILE *d_file, char *paths[], int count) {
+  uint8_t buffer[PACKET_SIZE];
+  size_t bytes_read, packet_len = 0;
+  int i;
+
+  for(i = 0; i < count; i ++) {
+    FILE *s_file = fopen(paths[i], "rb");
+    if(s_file == NULL) {
+      printf("cannot open infile %s\n", paths[i]);
+      return 1;
+    }
+    // the packets of this file start at a packet boundary of the output
+    fwrite(buffer, 1, lzss_pad_packet(buffer, packet_len, PACKET_SIZE), d_file);
+    packet_len = 0;
+    while((bytes_read = fread(buffer, 1, PACKET_SIZE - packet_len, s_file)) > 0) {
+      fwrite(buffer, 1, bytes_read, d_file);
+      packet_len = (packet_len + bytes_read) % PACKET_SIZE;
+    }
+    fclose(s_file);
+  }
+  return 0;
+}
+
+/*
+ * copy count packets of a compressed file starting from packet first.
+ */
+static int slice_stream(FILE *s_file, FILE *d_file, unsigned long first, unsigned long count) {
+  uint8_t buffer[PACKET_SIZE];
+  size_t bytes_read;
+
+  if(fseek(s_file, (long) (first * PACKET_SIZE), SEEK_SET) != 0) {
+    printf("cannot seek to packet %lu\n", first);
+    return 1;
+  }
+  while(count > 0 && (bytes_read = fread(buffer, 1, PACKET_SIZE, s_file)) > 0) {
+    fwrite(buffer, 1, bytes_read, d_file);
+    count --;
+  }
+  return 0;
+}
+
+/*
+ * decompress the packets of a damaged stream that has sync markers. the
+ * packets are decompressed independently and the bytes between the last good
+ * packet and the next packet that is found are skipped.
+ */
+static int recover_stream(FILE *s_file, FILE *d_file, const LzssPreset *preset) {
+  static uint8_t text[LZSS_MAX_DECOMPRESSED_SIZE(PACKET_SIZE) + 1];
+  size_t s_len, position = 0, skipped = 0;
+  unsigned long packets = 0;
+
+  uint8_t *src = read_file(s_file, &s_len);
+  if(src == NULL) {
+    printf("out of memory\n");
+    return 1;
+  }
+  while(position < s_len) {
+    size_t offset = position + lzss_find_packet(src + position, s_len - position, PACKET_SIZE);
+    skipped += offset - position;
+    position = offset;
+    if(position == s_len) {
+      break;
+    }
+    // decompress the packets that follow one another
+    do {
+      size_t packet_len = s_len - position < PACKET_SIZE ? s_len - position : PACKET_SIZE;
+      fwrite(text, 1, lzss_decompress_packet(preset, text, sizeof(text), src + position, packet_len), d_file);
+      position += packet_len;
+      packets ++;
+    } while(position + LZSS_SYNC_MARKER_SIZE <= s_len && src[position] == 0xff && src[position + 1] == 0xff);
+  }
+  free(src);
+  printf("packets: %lu\n", packets);
+  printf("skipped: %lu bytes\n", (unsigned long) skipped);
+  return 0;
+}
+
+/*
+ * decompress what was appended to a growing file since the last call. the
+ * checkpoint file has the offset in the file (LE) and the state of the stream,
+ * and the output is appended.
+ */
+static int follow_stream(FILE *s_file, FILE *d_file, const char *checkpoint_path, const LzssPreset *preset) {
+  static LzssStream stream;
+  uint8_t checkpoint[8 + LZSS_CHECKPOINT_SIZE];
+  uint8_t s_buffer[BUFFER_SIZE], d_buffer[BUFFER_SIZE];
+  unsigned long offset = 0, textcount = 0;
+  size_t bytes_read, consumed, len, i;
+  FILE *file;
+
+  lzss_stream_init(&stream, preset, PACKET_SIZE);
+  if((file = fopen(checkpoint_path, "rb")) != NULL) {
+    len = fread(checkpoint, 1, sizeof(checkpoint), file);
+    fclose(file);
+    if(len < 8 || !lzss_stream_restore(&stream, preset, checkpoint + 8, len - 8)) {
+      printf("invalid checkpoint %s\n", checkpoint_path);
+      return 1;
+    }
+    for(i = 0; i < 8; i ++) {
+      offset |= (unsigned long) checkpoint[i] << (8 * i);
+    }
+    if(fseek(s_file, (long) offset, SEEK_SET) != 0) {
+      printf("cannot seek to %lu\n", offset);
+      return 1;
+    }
+  }
+
+  while((bytes_read = fread(s_buffer, 1, BUFFER_SIZE, s_file)) > 0) {
+    const uint8_t *src = s_buffer;
+    offset += bytes_read;
+    do {
+      len = lzss_stream_decompress(&stream, d_buffer, BUFFER_SIZE, src, bytes_read, &consumed);
+      fwrite(d_buffer, 1, len, d_file);
+      textcount += len;
+      src += consumed;
+      bytes_read -= consumed;
+    } while(bytes_read > 0 || lzss_stream_pending(&stream) > 0);
+  }
+
+  for(i = 0; i < 8; i ++) {
+    checkpoint[i] = (uint8_t) (offset >> (8 * i));
+  }
+  len = 8 + lzss_stream_save(&stream, checkpoint + 8, sizeof(checkpoint) - 8);
+  if((file = fopen(checkpoint_path, "wb")) == NULL || fwrite(checkpoint, 1, len, file) != len) {
+    printf("cannot write checkpoint %s\n", checkpoint_path);
+    if(file != NULL) {
+      fclose(file);
+    }
+    return 1;
+  }
+  fclose(file);
+  printf("offset: %lu\n", offset);
+  printf("text:   %lu bytes\n", textcount);
+  return 0;
+}
+
 int main(int argc, char *argv[]) {
 
-  Dictionary dictionary;
+  static LzssStream stream;
+  static LzssPreset preset_buffer;
+  const LzssPreset *preset = NULL;
+  LzssStats stats;
   uint8_t s_buffer[BUFFER_SIZE];
   uint8_t d_buffer[BUFFER_SIZE];
+  static uint8_t p_source[LZSS_MAX_DECOMPRESSED_SIZE(PACKET_SIZE) + 1];
+  static uint8_t p_buffer[PACKET_SIZE + 1];
   unsigned long codecount = 0, textcount = 0;
   struct timeval t1, t2;
   FILE *s_file, *d_file;
 
-  if(argc != 4 || (!strcmp(argv[1], "c") && !strcmp(argv[1], "d"))) {
-    printf("Usage: lzss c/d infile outfile\n\tc = compress\td = decompress\n\n");
+  const int verbose = argc > 1 && !strcmp(argv[1], "-v");
+  if(verbose) {
+    argc --;
+    argv ++;
+  }
+
+  const int sync = argc > 1 && !strcmp(argv[1], "-s");
+  if(sync) {
+    argc --;
+    argv ++;
+  }
+
+  if(argc > 2 && !strcmp(argv[1], "-p")) {
+    if(!read_preset(argv[2], &preset_buffer)) {
+      printf("invalid preset %s\n", argv[2]);
+      return 1;
+    }
+    preset = &preset_buffer;
+    argc -= 2;
+    argv += 2;
+  }
+
+  if(argc > 3 && !strcmp(argv[1], "j")) {
+    if((d_file = fopen(argv[2], "wb")) == NULL) {
+      printf("cannot open outfile %s\n", argv[2]);
+      return 1;
+    }
+    int result = join_streams(d_file, argv + 3, argc - 3);
+    fclose(d_file);
+    return result;
+  }
+
+  if(argc == 6 && !strcmp(argv[1], "s")) {
+    if((s_file = fopen(argv[2], "rb")) == NULL) {
+      printf("cannot open infile %s\n", argv[2]);
+      return 1;
+    }
+    if((d_file = fopen(argv[3], "wb")) == NULL) {
+      printf("cannot open outfile %s\n", argv[3]);
+      fclose(s_file);
+      return 1;
+    }
+    int result = slice_stream(s_file, d_file, strtoul(argv[4], NULL, 10), strtoul(argv[5], NULL, 10));
+    fclose(d_file);
+    fclose(s_file);
+    return result;
+  }
+
+  if(argc == 5 && !strcmp(argv[1], "f")) {
+    if((s_file = fopen(argv[2], "rb")) == NULL) {
+      printf("cannot open infile %s\n", argv[2]);
+      return 1;
+    }
+    if((d_file = fopen(argv[3], "ab")) == NULL) {
+      printf("cannot open outfile %s\n", argv[3]);
+      fclose(s_file);
+      return 1;
+    }
+    int result = follow_stream(s_file, d_file, argv[4], preset);
+    fclose(d_file);
+    fclose(s_file);
+    return result;
+  }
+
+  if(argc != 4 || (strcmp(argv[1], "c") && strcmp(argv[1], "d") && strcmp(argv[1], "p")
+      && strcmp(argv[1], "a") && strcmp(argv[1], "x") && strcmp(argv[1], "r"))) {
+    printf("Usage: lzss [-v] [-s] [-p presetfile] c/d/r infile outfile\n"
+           "       lzss p samplefile presetfile\n"
+           "       lzss a/x infile outfile\n"
+           "       lzss j outfile infile ...\n"
+           "       lzss s infile outfile first count\n"
+           "       lzss [-p presetfile] f infile outfile checkpointfile\n"
+           "\tc = compress\td = decompress\tp = build a preset from sample logs\n"
+           "\ta = archive a compressed file\tx = extract a compressed file from an archive\n"
+           "\tj = join compressed files\ts = copy count packets starting from packet first\n"
+           "\tr = decompress the packets that can be found in a damaged file\n"
+           "\tf = append what was added to a growing file since the checkpoint\n"
+           "\t-v = print compression statistics\t-p = start every packet from the preset\n"
+           "\t-s = start every packet with a sync marker\n\n");
     return 1;
   }
 
@@ -37,13 +390,33 @@ int main(int argc, char *argv[]) {
     return 1;
   }
 
-  gettimeofday(&t1, NULL);
+  if(!strcmp(argv[1], "p")) {
+    int result = build_preset(s_file, d_file);
+    fclose(d_file);
+    fclose(s_file);
+    return result;
+  }
 
-  lzss_dictionary_init(&dictionary);
+  if(!strcmp(argv[1], "a") || !strcmp(argv[1], "x")) {
+    int result = transcode_archive(s_file, d_file, !strcmp(argv[1], "a"));
+    fclose(d_file);
+    fclose(s_file);
+    return result;
+  }
+
+  if(!strcmp(argv[1], "r")) {
+    int result = recover_stream(s_file, d_file, preset);
+    fclose(d_file);
+    fclose(s_file);
+    return result;
+  }
+
+  memset(&stats, 0, sizeof(stats));
+
+  gettimeofday(&t1, NULL);
 
   size_t s_len = 0;
   size_t len;
-  long packet_len = PACKET_SIZE;
 
   size_t bytes_read;
 
@@ -51,40 +424,45 @@ int main(int argc, char *argv[]) {
 
   size_t s_unused_bytes = 0;
 
-  while((bytes_read = fread(s_buffer + s_unused_bytes, 1, BUFFER_SIZE - s_unused_bytes, s_file)) > 0 || s_len > 0) {
-    s_len = bytes_read + s_unused_bytes;
-
-    if(PACKET_SIZE == 0) { // disable packeting
-      packet_len = BUFFER_SIZE;
-    }
-
-    if(compressing) {
-      len = lzss_compress(&dictionary, d_buffer, BUFFER_SIZE, s_buffer, s_len, &s_unused_bytes, packet_len);
-      packet_len -= len;
-    } else {
-      len = lzss_decompress(&dictionary, d_buffer, BUFFER_SIZE, s_buffer, s_len, &s_unused_bytes, packet_len);
-      packet_len -= s_len - s_unused_bytes;
-    }
+  // a whole packet is compressed at once so that it can be stored if it does not compress
+  while(compressing && PACKET_SIZE > 0 && ((bytes_read = fread(p_source + s_len, 1, sizeof(p_source) - s_len, s_file)) > 0 || s_len > 0)) {
+    s_len += bytes_read;
 
-    fwrite(d_buffer, 1, len, d_file);
+    len = lzss_compress_packet(preset, p_buffer, PACKET_SIZE, p_source, s_len, &s_unused_bytes, sync, verbose ? &stats : NULL);
+    fwrite(p_buffer, 1, len, d_file);
 
     textcount += bytes_read;
     codecount += len;
 
-    assert(packet_len >= 0);
+    memmove(p_source, p_source + s_len - s_unused_bytes, s_unused_bytes);
+    s_len = s_unused_bytes;
+  }
 
-    if(packet_len == 0) {
-      packet_len = PACKET_SIZE;
-      lzss_dictionary_init(&dictionary);
-    }
+  if(!compressing) {
+    lzss_stream_init(&stream, preset, PACKET_SIZE);
+  }
 
-    memmove(s_buffer, s_buffer + s_len - s_unused_bytes, s_unused_bytes); // copy unused bytes to be decompressed next
+  while(!compressing && (bytes_read = fread(s_buffer, 1, BUFFER_SIZE, s_file)) > 0) {
+    const uint8_t *src = s_buffer;
+    size_t consumed;
+    textcount += bytes_read;
+
+    do { // the stream keeps what does not fit in the output
+      len = lzss_stream_decompress(&stream, d_buffer, BUFFER_SIZE, src, bytes_read, &consumed);
+      fwrite(d_buffer, 1, len, d_file);
+      codecount += len;
+      src += consumed;
+      bytes_read -= consumed;
+    } while(bytes_read > 0 || lzss_stream_pending(&stream) > 0);
   }
 
   gettimeofday(&t2, NULL);
   fprintf(stderr, "Finished in about %.0f milliseconds. \n", (t2.tv_sec - t1.tv_sec) * 1000.0 + (t2.tv_usec - t1.tv_usec) / 1000.0);
   printf("text:  %ld bytes\n", textcount);
   printf("code:  %ld bytes (%ld%%)\n", codecount, (codecount * 100) / textcount);
+  if(verbose && compressing) {
+    print_stats(&stats);
+  }
 
   fclose(d_file);
   fclose(s_file);
@@ -0,0 +1,214 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/time.h>
+
+#include "lzss.h"
+#include "lzss_service.h"
+
+#define PACKET_SIZE (1024)
+#define MAX_CHUNK_SIZE (512)
+#define MAX_QUEUED_BYTES (4 * 1024 * 1024)
+
+/*
+ * every device sends the same compressed file in chunks of random size, and
+ * the devices are interleaved like the connections of a server. the output of
+ * every stream is checked against the file.
+ */
+
+typedef struct {
+  size_t received;  // decompressed bytes
+  uint32_t hash;
+} Device;
+
+typedef struct {
+  Device *devices;
+  const LzssServiceStreamId *ids; // of the devices
+  size_t *slot_devices;           // device of every slot of a stream id
+  size_t slot_count;
+} Load;
+
+static uint32_t hash_update(uint32_t hash, const uint8_t *data, size_t length) {
+  size_t i;
+  for(i = 0; i < length; i ++) {
+    hash = (hash ^ data[i]) * 16777619u;
+  }
+  return hash;
+}
+
+/*
+ * the slot of the id, which the service chooses, is mapped back to the device
+ * that opened the stream.
+ */
+static void load_sink(void *context, LzssServiceStreamId id, const uint8_t *data, size_t length) {
+  const Load *load = (const Load *) context;
+  const size_t slot = (size_t) (id & 0xffffffffu);
+  assert(slot < load->slot_count && load->ids[load->slot_devices[slot]] == id);
+  Device *device = &load->devices[load->slot_devices[slot]];
+  device->hash = hash_update(device->hash, data, length);
+  device->received += length;
+}
+
+static bool read_preset(const char *path, LzssPreset *preset) {
+  uint8_t buffer[LZSS_PRESET_MAX_SERIALIZED_SIZE];
+  FILE *file;
+  size_t len;
+
+  if((file = fopen(path, "rb")) == NULL) {
+    return false;
+  }
+  len = fread(buffer, 1, sizeof(buffer), file);
+  fclose(file);
+  return lzss_preset_read(preset, buffer, len);
+}
+
+/*
+ * read the whole file into a buffer that the caller frees.
+ * return NULL if there is not enough memory.
+ */
+static uint8_t *read_file(FILE *file, size_t *len) {
+  uint8_t *data = NULL;
+  size_t capacity = 0, bytes_read;
+
+  *len = 0;
+  do {
+    if(*len == capacity) {
+      capacity = capacity ? 2 * capacity : 65536;
+      uint8_t *p = (uint8_t *) realloc(data, capacity);
+      if(p == NULL) {
+        free(data);
+        return NULL;
+      }
+      data = p;
+    }
+    bytes_read = fread(data + *len, 1, capacity - *len, file);
+    *len += bytes_read;
+  } while(bytes_read > 0);
+  return data;
+}
+
+static size_t compress_file(const LzssPreset *preset, uint8_t *dst, const uint8_t *src, size_t s_len) {
+  size_t len = 0, s_unused_bytes;
+
+  while(s_len > 0) {
+    len += lzss_compress_packet(preset, dst + len, PACKET_SIZE, src, s_len, &s_unused_bytes, false, NULL);
+    src += s_len - s_unused_bytes;
+    s_len = s_unused_bytes;
+  }
+  return len;
+}
+
+int main(int argc, char *argv[]) {
+  static LzssPreset preset_buffer;
+  const LzssPreset *preset = NULL;
+  static LzssService service;
+  struct timeval t1, t2;
+  FILE *file;
+  size_t i, text_len;
+
+  if(argc > 2 && !strcmp(argv[1], "-p")) {
+    if(!read_preset(argv[2], &preset_buffer)) {
+      printf("invalid preset %s\n", argv[2]);
+      return 1;
+    }
+    preset = &preset_buffer;
+    argc -= 2;
+    argv += 2;
+  }
+
+  if(argc != 4) {
+    printf("Usage: lzss_load [-p presetfile] streams workers textfile\n"
+           "\tdecompress the compressed textfile from streams devices with workers threads\n\n");
+    return 1;
+  }
+  const size_t stream_count = strtoul(argv[1], NULL, 10);
+  const size_t worker_count = strtoul(argv[2], NULL, 10);
+
+  if((file = fopen(argv[3], "rb")) == NULL) {
+    printf("cannot open textfile %s\n", argv[3]);
+    return 1;
+  }
+  uint8_t *text = read_file(file, &text_len);
+  fclose(file);
+  uint8_t *code = text ? (uint8_t *) malloc(text_len + text_len / (PACKET_SIZE - LZSS_STORED_HEADER_SIZE) * PACKET_SIZE + PACKET_SIZE) : NULL;
+  size_t *positions = (size_t *) calloc(stream_count ? stream_count : 1, sizeof(size_t));
+  LzssServiceStreamId *ids = (LzssServiceStreamId *) calloc(stream_count ? stream_count : 1, sizeof(LzssServiceStreamId));
+  Load load = { (Device *) calloc(stream_count ? stream_count : 1, sizeof(Device)), ids, NULL, 0 };
+  if(code == NULL || positions == NULL || ids == NULL || load.devices == NULL) {
+    printf("out of memory\n");
+    return 1;
+  }
+  const size_t code_len = compress_file(preset, code, text, text_len);
+  const uint32_t text_hash = hash_update(2166136261u, text, text_len);
+
+  if(!lzss_service_init(&service, stream_count, worker_count, MAX_QUEUED_BYTES, load_sink, &load)) {
+    printf("cannot start %lu workers\n", (unsigned long) worker_count);
+    return 1;
+  }
+
+  gettimeofday(&t1, NULL);
+  for(i = 0; i < stream_count; i ++) {
+    load.devices[i].hash = 2166136261u;
+    if(!lzss_service_open(&service, preset, PACKET_SIZE, &ids[i])) {
+      printf("cannot open stream %lu\n", (unsigned long) i);
+      return 1;
+    }
+    if((size_t) (ids[i] & 0xffffffffu) >= load.slot_count) {
+      load.slot_count = (size_t) (ids[i] & 0xffffffffu) + 1;
+    }
+  }
+  if((load.slot_devices = (size_t *) calloc(load.slot_count ? load.slot_count : 1, sizeof(size_t))) == NULL) {
+    printf("out of memory\n");
+    return 1;
+  }
+  for(i = 0; i < stream_count; i ++) {
+    load.slot_devices[ids[i] & 0xffffffffu] = i;
+  }
+
+  unsigned long seed = 1;
+  size_t remaining = stream_count;
+  while(remaining > 0) {
+    for(i = 0; i < stream_count; i ++) {
+      if(positions[i] == code_len) {
+        continue;
+      }
+      seed = seed * 1103515245 + 12345;
+      size_t len = 1 + (seed >> 16) % MAX_CHUNK_SIZE;
+      if(len > code_len - positions[i]) {
+        len = code_len - positions[i];
+      }
+      lzss_service_submit(&service, ids[i], code + positions[i], len);
+      positions[i] += len;
+      if(positions[i] == code_len) {
+        lzss_service_close(&service, ids[i]);
+        remaining --;
+      }
+    }
+  }
+  lzss_service_drain(&service);
+  gettimeofday(&t2, NULL);
+  lzss_service_deinit(&service);
+
+  size_t failed = 0;
+  for(i = 0; i < stream_count; i ++) {
+    if(load.devices[i].received != text_len || load.devices[i].hash != text_hash) {
+      failed ++;
+    }
+  }
+
+  const double seconds = (t2.tv_sec - t1.tv_sec) + (t2.tv_usec - t1.tv_usec) / 1000000.0;
+  printf("streams: %lu with %lu workers, %lu failed\n", (unsigned long) stream_count, (unsigned long) worker_count, (unsigned long) failed);
+  printf("code:    %lu bytes per stream\n", (unsigned long) code_len);
+  printf("text:    %lu bytes per stream\n", (unsigned long) text_len);
+  printf("time:    %.0f milliseconds, %.1f MB/s of text\n", seconds * 1000.0,
+      seconds > 0 ? (double) text_len * stream_count / seconds / 1000000.0 : 0.0);
+
+  free(load.slot_devices);
+  free(load.devices);
+  free(ids);
+  free(positions);
+  free(code);
+  free(text);
+  return failed ? 1 : 0;
+}